@@ -14,17 +14,57 @@ SOURCES+= src/main.cpp \
     src/NGLDraw.cpp \
     src/PhysicsWorld.cpp \
     src/CollisionShape.cpp \
-    src/Text.cpp
+    src/Text.cpp \
+    src/PerfStats.cpp \
+    src/MetricsExport.cpp \
+    src/Benchmark.cpp \
+    src/HeadlessContext.cpp \
+    src/Simulation.cpp \
+    src/StepGovernor.cpp \
+    src/MaterialTable.cpp \
+    src/VecEnv.cpp \
+    src/NavGrid.cpp \
+    src/Autopilot.cpp \
+    src/MazeSdf.cpp \
+    src/SdfCollision.cpp \
+    src/BallSwarm.cpp \
+    src/MazeGenerator.cpp \
+    src/MazeChunks.cpp \
+    src/Frustum.cpp \
+    src/LevelPack.cpp \
+    src/ShaderCache.cpp
 
 HEADERS+= \
     include/NGLDraw.h \
     include/PhysicsWorld.h \
     include/CollisionShape.h \
-    include/Text.h
+    include/Text.h \
+    include/PerfStats.h \
+    include/MetricsExport.h \
+    include/MetricsLayout.h \
+    include/Benchmark.h \
+    include/HeadlessContext.h \
+    include/Simulation.h \
+    include/Snapshot.h \
+    include/StepGovernor.h \
+    include/MaterialTable.h \
+    include/VecEnv.h \
+    include/NavGrid.h \
+    include/Autopilot.h \
+    include/MazeSdf.h \
+    include/SdfCollision.h \
+    include/BallSwarm.h \
+    include/MazeGenerator.h \
+    include/MazeChunks.h \
+    include/Frustum.h \
+    include/LevelPack.h \
+    include/ShaderCache.h
 INCLUDEPATH +=./include
 
 DESTDIR=./
 OTHER_FILES+= \
+    benchmark/tiltpath.txt \
+    levels/pack.txt \
     shaders/PhongFragment.glsl \
     shaders/PhongVertex.glsl \
     shaders/TextureFrag.glsl \
@@ -44,6 +84,10 @@ message(output from sdl2-config --cflags added to CXXFLAGS= $$QMAKE_CXXFLAGS)
 LIBS+=$$system($$(HOME)/SDL2.0/bin/sdl2-config  --libs)
 message(output from sdl2-config --libs added to LIB=$$LIBS)
 LIBS+=-L/usr/local/lib -lSDL2_ttf
+# shm_open for the metrics export
+linux-*:LIBS+=-lrt
+# EGL for the headless benchmark context (Mesa's llvmpipe on machines without a GPU)
+linux-*:LIBS+=-lEGL
 
 unix:QMAKE_CXXFLAGS+= -msse -msse2 -msse3
 macx:QMAKE_CXXFLAGS+= -arch x86_64
@@ -0,0 +1,61 @@
+# microbenchmarks for the engine building blocks, run from the Labyrinth directory
+# so the obj / font paths resolve, e.g. bench/LabyrinthBench
+TARGET=LabyrinthBench
+OBJECTS_DIR=obj
+CONFIG-=app_bundle
+CONFIG+=console
+QT+=gui opengl core
+SOURCES+= main.cpp \
+    ../src/PhysicsWorld.cpp \
+    ../src/MaterialTable.cpp \
+    ../src/VecEnv.cpp \
+    ../src/NavGrid.cpp \
+    ../src/Autopilot.cpp \
+    ../src/MazeSdf.cpp \
+    ../src/SdfCollision.cpp \
+    ../src/BallSwarm.cpp \
+    ../src/MazeGenerator.cpp \
+    ../src/MazeChunks.cpp \
+    ../src/LevelPack.cpp \
+    ../src/CollisionShape.cpp \
+    ../src/Text.cpp
+
+HEADERS+= \
+    ../include/PhysicsWorld.h \
+    ../include/MaterialTable.h \
+    ../include/VecEnv.h \
+    ../include/NavGrid.h \
+    ../include/Autopilot.h \
+    ../include/MazeSdf.h \
+    ../include/SdfCollision.h \
+    ../include/BallSwarm.h \
+    ../include/MazeGenerator.h \
+    ../include/MazeChunks.h \
+    ../include/LevelPack.h \
+    ../include/CollisionShape.h \
+    ../include/Text.h
+INCLUDEPATH +=../include
+DESTDIR=./
+
+INCLUDEPATH+=/usr/local/include/bullet
+INCLUDEPATH+=/usr/local/include
+LIBS+= -L/usr/local/lib -lBulletDynamics  -lBulletCollision -lLinearMath
+unix:QMAKE_CXXFLAGS_WARN_ON += "-Wno-unused-parameter"
+
+QMAKE_CXXFLAGS+=$$system($$(HOME)/SDL2.0/bin/sdl2-config  --cflags)
+LIBS+=$$system($$(HOME)/SDL2.0/bin/sdl2-config  --libs)
+LIBS+=-L/usr/local/lib -lSDL2_ttf
+
+unix:QMAKE_CXXFLAGS+= -msse -msse2 -msse3
+macx:QMAKE_CXXFLAGS+= -arch x86_64
+linux-*:QMAKE_CXXFLAGS +=  -march=native
+# benchmarks want an optimised build even from a debug kit
+QMAKE_CXXFLAGS+= -O2
+
+unix:LIBS +=  -L/$(HOME)/NGL/lib -l NGL
+linux-*{
+		linux-*:DEFINES+=GL42
+		DEFINES += LINUX
+}
+macx:DEFINES += DARWIN
+INCLUDEPATH += $$(HOME)/NGL/include/
@@ -0,0 +1,650 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file main.cpp
+/// @brief microbenchmarks for the engine building blocks, reports ns/op and allocations/op
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <SDL.h>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <ngl/NGLInit.h>
+#include "PhysicsWorld.h"
+#include "CollisionShape.h"
+#include "Text.h"
+#include "VecEnv.h"
+#include "NavGrid.h"
+#include "Autopilot.h"
+#include "MazeSdf.h"
+#include "MazeGenerator.h"
+#include "MazeChunks.h"
+#include "LevelPack.h"
+#include <cstdio>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief allocations made through new and through bullet's aligned allocator, atomic as the
+/// VecEnv worker threads allocate too
+//----------------------------------------------------------------------------------------------------------------------
+static SDL_atomic_t s_allocations={0};
+
+void *operator new(std::size_t _size)
+{
+  SDL_AtomicAdd(&s_allocations,1);
+  void *mem=malloc(_size);
+  if(mem==0)
+  {
+    throw std::bad_alloc();
+  }
+  return mem;
+}
+
+void *operator new[](std::size_t _size)
+{
+  return operator new(_size);
+}
+
+void operator delete(void *_mem) throw()
+{
+  free(_mem);
+}
+
+void operator delete[](void *_mem) throw()
+{
+  free(_mem);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief bullet allocates most of its memory through btAlignedAlloc so count that too
+//----------------------------------------------------------------------------------------------------------------------
+static void *countedAlignedAlloc(size_t _size, int _alignment)
+{
+  SDL_AtomicAdd(&s_allocations,1);
+  void *mem=0;
+  if(posix_memalign(&mem,_alignment < (int)sizeof(void *) ? sizeof(void *) : _alignment,_size)!=0)
+  {
+    return 0;
+  }
+  return mem;
+}
+
+static void countedAlignedFree(void *_mem)
+{
+  free(_mem);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief start of a timed section
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  Uint64 start;
+  unsigned int allocations;
+}Sample;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Sample begin()
+{
+  Sample s;
+  s.allocations=SDL_AtomicGet(&s_allocations);
+  s.start=SDL_GetPerformanceCounter();
+  return s;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief print ns/op and allocations/op since the sample began
+/// @param[in] _s the sample from begin
+/// @param[in] _name name of the benchmark
+/// @param[in] _ops number of operations done in the timed section
+//----------------------------------------------------------------------------------------------------------------------
+void end(const Sample &_s, const std::string &_name, unsigned long _ops)
+{
+  Uint64 ticks=SDL_GetPerformanceCounter()-_s.start;
+  // unsigned so the difference still holds if the counter wraps
+  unsigned int allocations=(unsigned int)SDL_AtomicGet(&s_allocations)-_s.allocations;
+  double ns=ticks*1.0e9/SDL_GetPerformanceFrequency()/_ops;
+  std::cout<<std::left<<std::setw(40)<<_name
+           <<std::right<<std::setw(14)<<std::fixed<<std::setprecision(1)<<ns<<" ns/op"
+           <<std::setw(12)<<std::setprecision(2)<<double(allocations)/_ops<<" allocs/op\n";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief build the same world the game uses with a grid of balls dropped over the maze
+/// @param[in] _ball name of the collision shape to use for the balls
+/// @param[in] _balls number of balls
+/// @param[in] _broadphase broadphase to use, sized to the maze as Simulation does
+//----------------------------------------------------------------------------------------------------------------------
+PhysicsWorld *makeWorld(const std::string &_ball, unsigned int _balls, BroadphaseType _broadphase=BROADPHASE_DBVT)
+{
+  ngl::Vec3 worldMin, worldMax;
+  PhysicsWorld::mazeBounds(CollisionShape::instance()->getShape("maze"), ngl::Vec3(0,20,0), worldMin, worldMax);
+  PhysicsWorld *world=new PhysicsWorld(_broadphase, worldMin, worldMax);
+  world->setGravity(0,-100,0);
+  // as Simulation does, half the thickness of the maze walls
+  world->setMaxDisplacement(1.0);
+  world->addGroundPlane(ngl::Vec3(0,0,0), ngl::Vec3(50,0.01,50));
+  world->addMaze("maze", ngl::Vec3(0,20,0), 0.3);
+  world->addCube("cube", ngl::Vec3(0,17,0));
+  for(unsigned int i=0; i<_balls; ++i)
+  {
+    float x=-18.0+(i%30)*1.2;
+    float z=-18.0+((i/30)%30)*1.2;
+    float y=26.0+(i/900)*1.2;
+    world->addSphere(_ball, ngl::Vec3(x,y,z), 0.3);
+  }
+  return world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void benchStep(const std::string &_ball, unsigned int _balls, bool _ballsCollide=true,
+               BroadphaseType _broadphase=BROADPHASE_DBVT)
+{
+  PhysicsWorld *world=makeWorld(_ball,_balls,_broadphase);
+  world->setBallsCollide(_ballsCollide);
+  // let the balls land so we measure resting contacts as well as falling
+  for(unsigned int i=0; i<60; ++i)
+  {
+    world->step(1.0f/60.0f,10);
+  }
+  const unsigned int steps=300;
+  Sample s=begin();
+  for(unsigned int i=0; i<steps; ++i)
+  {
+    world->step(1.0f/60.0f,10);
+  }
+  std::stringstream name;
+  name<<"step "<<_ball<<" x"<<_balls<<(_ballsCollide ? "" : " no ball-ball");
+  name<<" "<<PhysicsWorld::broadphaseName(_broadphase)<<" ("<<world->getNumContacts()<<" contacts, "<<world->getNumBroadphasePairs()<<" pairs)";
+  end(s,name.str(),steps);
+  delete world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief step a pile of balls once it has come to rest
+/// @param[in] _balls number of balls
+/// @param[in] _tilting true to nudge the maze every step, which keeps everything on it awake
+//----------------------------------------------------------------------------------------------------------------------
+void benchResting(unsigned int _balls, bool _tilting)
+{
+  PhysicsWorld *world=makeWorld("ball",_balls);
+  // long enough to land and for bullet's 2 second sleep timer to run out
+  for(unsigned int i=0; i<300; ++i)
+  {
+    world->tilt(0.0,0.0);
+    world->step(1.0f/60.0f,10);
+  }
+  const unsigned int steps=300;
+  Sample s=begin();
+  for(unsigned int i=0; i<steps; ++i)
+  {
+    // tilt back and forth so the maze ends up where it started
+    world->tilt(_tilting ? ((i&1) ? -0.001 : 0.001) : 0.0,0.0);
+    world->step(1.0f/60.0f,10);
+  }
+  std::stringstream name;
+  unsigned int active, sleeping, islands;
+  world->countBodies(active,sleeping,islands);
+  name<<"resting ball x"<<_balls<<(_tilting ? " tilting" : " still")<<" ("<<sleeping<<" asleep, "<<islands<<" islands)";
+  end(s,name.str(),steps);
+  delete world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief build a maze's distance field without the cache
+//----------------------------------------------------------------------------------------------------------------------
+void benchSdfBuild(const std::string &_file)
+{
+  MazeSdf sdf;
+  Sample s=begin();
+  sdf.build(_file);
+  std::stringstream name;
+  name<<"distance field "<<_file<<" "<<sdf.getWidth()<<"x"<<sdf.getHeight()<<"x"<<sdf.getDepth()
+      <<" ("<<sdf.getMemoryUsage()/1024<<"KB)";
+  end(s,name.str(),1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief balls without ball-ball contacts against whichever maze shape is loaded, so the maze
+/// contacts are most of the step
+/// @param[in] _maze what the maze shape is, for the report
+/// @param[in] _balls number of balls
+//----------------------------------------------------------------------------------------------------------------------
+void benchMazeCollision(const std::string &_maze, unsigned int _balls)
+{
+  PhysicsWorld *world=makeWorld("ball",_balls);
+  world->setBallsCollide(false);
+  for(unsigned int i=0; i<60; ++i)
+  {
+    world->step(1.0f/60.0f,10);
+  }
+  const unsigned int steps=300;
+  // count the balls still on the maze so a field that lets them fall through shows up
+  Sample s=begin();
+  for(unsigned int i=0; i<steps; ++i)
+  {
+    world->tilt(0.002*sin(i*0.05),0.002*cos(i*0.03));
+    world->step(1.0f/60.0f,10);
+  }
+  unsigned int onMaze=0;
+  for(unsigned int i=4; i<world->getNumCollisionObjects(); ++i)
+  {
+    onMaze+= world->getPosition(i).m_y>21.0 ? 1 : 0;
+  }
+  std::stringstream name;
+  name<<"maze contacts "<<_maze<<" x"<<_balls<<" ("<<onMaze<<" on the maze, "<<world->getNumContacts()<<" contacts)";
+  end(s,name.str(),steps);
+  delete world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief party balls rolling on a tilting maze, with one ball in bullet pushing through them
+/// @param[in] _sdf distance field of the maze
+/// @param[in] _balls number of party balls
+//----------------------------------------------------------------------------------------------------------------------
+void benchSwarm(const MazeSdf &_sdf, unsigned int _balls)
+{
+  PhysicsWorld *world=makeWorld("ball",1);
+  world->setSwarm(_balls,&_sdf);
+  // let them land and pile up
+  for(unsigned int i=0; i<120; ++i)
+  {
+    world->step(1.0f/60.0f,10);
+  }
+  const unsigned int steps=300;
+  Sample s=begin();
+  for(unsigned int i=0; i<steps; ++i)
+  {
+    world->tilt(0.002*sin(i*0.05),0.002*cos(i*0.03));
+    world->step(1.0f/60.0f,10);
+  }
+  std::stringstream name;
+  name<<"party balls x"<<_balls<<" ("<<world->getSwarm()->getNumContacts()<<" contacts)";
+  end(s,name.str(),steps);
+  delete world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief step a batch of environments with a slow sweep of tilts
+/// @param[in] _envs number of environments
+/// @param[in] _threads threads to step them on, 0 for one per core
+//----------------------------------------------------------------------------------------------------------------------
+void benchVecEnv(unsigned int _envs, unsigned int _threads)
+{
+  VecEnv env(_envs,_threads);
+  std::vector <EnvAction> actions(_envs);
+  const unsigned int steps=300;
+  Sample s=begin();
+  for(unsigned int i=0; i<steps; ++i)
+  {
+    for(unsigned int e=0; e<_envs; ++e)
+    {
+      actions[e].tiltX=0.002*sin(i*0.05+e);
+      actions[e].tiltZ=0.002*cos(i*0.03+e);
+    }
+    env.step(&actions[0]);
+  }
+  std::stringstream name;
+  name<<"vecenv x"<<_envs<<" "<<env.getNumThreads()<<" threads ("<<std::fixed<<std::setprecision(0)
+      <<env.getStepsPerSecondPerCore()<<" steps/s/core)";
+  end(s,name.str(),steps*_envs);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns the goal's bounds in the maze's space, as the game places them
+//----------------------------------------------------------------------------------------------------------------------
+void goalBounds(ngl::Vec3 &o_min, ngl::Vec3 &o_max)
+{
+  btTransform goal;
+  goal.setIdentity();
+  goal.setOrigin(btVector3(0,17-20,0));
+  btVector3 goalMin, goalMax;
+  CollisionShape::instance()->getShape("cube")->getAabb(goal,goalMin,goalMax);
+  o_min.set(goalMin.getX(),goalMin.getY(),goalMin.getZ());
+  o_max.set(goalMax.getX(),goalMax.getY(),goalMax.getZ());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief build a maze's nav grid without the cache and check the goal can be reached from the start
+//----------------------------------------------------------------------------------------------------------------------
+void benchNavGrid(const std::string &_file)
+{
+  ngl::Vec3 goalMin, goalMax;
+  goalBounds(goalMin,goalMax);
+  NavGrid grid;
+  Sample s=begin();
+  grid.build(_file,goalMin,goalMax);
+  std::stringstream name;
+  name<<"nav grid "<<_file<<" "<<grid.getWidth()<<"x"<<grid.getDepth()
+      <<(grid.reachable(ngl::Vec3(-15,5,-15)) ? " solvable" : " NOT solvable");
+  end(s,name.str(),1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief let the autopilot play a batch of games and count how they end
+/// @param[in] _envs number of environments
+/// @param[in] _steps steps to run for
+//----------------------------------------------------------------------------------------------------------------------
+void benchAutopilot(unsigned int _envs, unsigned int _steps)
+{
+  ngl::Vec3 goalMin, goalMax;
+  goalBounds(goalMin,goalMax);
+  NavGrid grid;
+  grid.build("obj/mazev3.obj",goalMin,goalMax);
+  Autopilot pilot(&grid);
+  VecEnv env(_envs,0);
+  std::vector <EnvAction> actions(_envs);
+  const EnvObservation *obs=env.getObservations();
+  unsigned int wins=0;
+  unsigned int losses=0;
+  Sample s=begin();
+  for(unsigned int i=0; i<_steps; ++i)
+  {
+    for(unsigned int e=0; e<_envs; ++e)
+    {
+      const EnvObservation &o=obs[e];
+      pilot.act(ngl::Vec3(o.position[0],o.position[1],o.position[2]),ngl::Vec3(o.velocity[0],o.velocity[1],o.velocity[2]),
+                btQuaternion(o.tilt[0],o.tilt[1],o.tilt[2],o.tilt[3]),ngl::Vec3(0,20,0),actions[e].tiltX,actions[e].tiltZ);
+    }
+    obs=env.step(&actions[0]);
+    for(unsigned int e=0; e<_envs; ++e)
+    {
+      wins+= obs[e].outcome>0.0 ? 1 : 0;
+      losses+= obs[e].outcome<0.0 ? 1 : 0;
+    }
+  }
+  std::stringstream name;
+  name<<"autopilot x"<<_envs<<" ("<<wins<<" wins, "<<losses<<" losses)";
+  end(s,name.str(),_steps*_envs);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void benchTransforms()
+{
+  PhysicsWorld *world=makeWorld("ball",1000);
+  world->step(1.0f/60.0f,10);
+  unsigned int bodies=world->getNumCollisionObjects();
+  const unsigned int passes=100;
+  // stop the optimiser throwing the matrices away
+  float sum=0.0;
+  Sample s=begin();
+  for(unsigned int p=0; p<passes; ++p)
+  {
+    for(unsigned int i=1; i<bodies; ++i)
+    {
+      sum+=world->getTransformMatrix(i).m_m[3][1];
+    }
+  }
+  end(s,"getTransformMatrix",passes*(bodies-1));
+  if(sum==0.0)
+  {
+    std::cout<<"\n";
+  }
+  delete world;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void benchMazeLoad(const std::string &_file)
+{
+  const unsigned int loads=5;
+  CollisionShape *shapes=CollisionShape::instance();
+  Sample s=begin();
+  for(unsigned int i=0; i<loads; ++i)
+  {
+    std::stringstream name;
+    name<<_file<<i;
+    shapes->addMaze(name.str(),_file);
+  }
+  end(s,"CollisionShape::addMaze "+_file,loads);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief generate mazes from fresh, then make a collision shape from the last one
+/// @param[in] _cells cells along each side
+//----------------------------------------------------------------------------------------------------------------------
+void benchMazeGenerate(unsigned int _cells)
+{
+  const unsigned int mazes=5;
+  Sample s=begin();
+  for(unsigned int i=0; i<mazes; ++i)
+  {
+    MazeGenerator maze;
+    maze.generate(i+1,_cells,_cells);
+  }
+  std::stringstream name;
+  name<<"generate maze "<<_cells<<"x"<<_cells;
+  end(s,name.str(),mazes);
+
+  // the shape reads the generator's arrays so like the shapes it is never freed
+  MazeGenerator *shapeMaze=new MazeGenerator;
+  shapeMaze->generate(1,_cells,_cells);
+  std::stringstream shapeName;
+  shapeName<<"generated"<<_cells;
+  s=begin();
+  CollisionShape::instance()->addGeneratedMaze(shapeName.str(),*shapeMaze);
+  std::stringstream bvhName;
+  bvhName<<"CollisionShape::addGeneratedMaze "<<_cells<<"x"<<_cells<<" ("<<shapeMaze->getIndices().size()/3
+         <<" triangles, "<<shapeMaze->getMemoryUsage()/1024<<"KB)";
+  end(s,bvhName.str(),1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a ball rolling corner to corner across a streamed maze, the chunks in and the time an
+/// update takes should be the same however big the maze is
+/// @param[in] _cells cells along each side
+//----------------------------------------------------------------------------------------------------------------------
+void benchMazeStream(unsigned int _cells)
+{
+  MazeGenerator maze;
+  Sample s=begin();
+  maze.generate(1,_cells,_cells,false);
+  std::stringstream carveName;
+  carveName<<"carve maze "<<_cells<<"x"<<_cells<<" ("<<maze.getMemoryUsage()/1024<<"KB)";
+  end(s,carveName.str(),1);
+
+  MazeMesh mesh;
+  const unsigned int builds=100;
+  s=begin();
+  for(unsigned int i=0; i<builds; ++i)
+  {
+    maze.buildChunk(i%maze.getNumChunks(),mesh);
+  }
+  end(s,"MazeGenerator::buildChunk",builds);
+
+  MazeChunks chunks(&maze);
+  btTransform identity;
+  identity.setIdentity();
+  std::vector <btVector3> ball(1);
+  const unsigned int updates=10000;
+  unsigned int mostIn=0;
+  unsigned long mostBytes=0;
+  float corner=0.5f*_cells*MazeGenerator::getCellSize();
+  s=begin();
+  for(unsigned int i=0; i<updates; ++i)
+  {
+    float t=float(i)/updates;
+    ball[0].setValue(-corner+2.0f*corner*t,3.0,-corner+2.0f*corner*t);
+    chunks.update(identity,ball);
+    mostIn=std::max(mostIn,chunks.getNumResident());
+    mostBytes=std::max(mostBytes,chunks.getMemoryUsage());
+  }
+  std::stringstream name;
+  name<<"MazeChunks::update "<<_cells<<"x"<<_cells<<" ("<<chunks.getNumChunks()<<" chunks, at most "<<mostIn
+      <<" in, "<<mostBytes/1024<<"KB, "<<chunks.getNumBuilt()<<" built)";
+  end(s,name.str(),updates);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief prepare a level with its caches missing and then with them written, the second is the
+/// work a prefetch does while the level before is played
+/// @param[in] _info the level, its caches go in levels/
+//----------------------------------------------------------------------------------------------------------------------
+void benchLevelPrepare(const LevelInfo &_info)
+{
+  std::remove(("levels/"+_info.name+".mesh").c_str());
+  std::remove(("levels/"+_info.name+".bvh").c_str());
+  Sample s=begin();
+  Level *cold=new Level;
+  cold->prepare(_info,"levels/");
+  end(s,"Level::prepare "+_info.name+" without caches",1);
+  delete cold;
+
+  const unsigned int prepares=5;
+  unsigned long bytes=0;
+  bool cached=true;
+  s=begin();
+  for(unsigned int i=0; i<prepares; ++i)
+  {
+    Level level;
+    level.prepare(_info,"levels/");
+    bytes=level.getMemoryUsage();
+    cached=cached && level.bvhFromCache();
+  }
+  std::stringstream name;
+  name<<"Level::prepare "<<_info.name<<(cached ? " from caches (" : " caches not read (")<<bytes/1024<<"KB)";
+  end(s,name.str(),prepares);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void benchText()
+{
+  // Text builds textures so needs a GL context, use a hidden window
+  if (SDL_Init(SDL_INIT_VIDEO) < 0 )
+  {
+    std::cout<<"Text glyph setup skipped, no video : "<<SDL_GetError()<<"\n";
+    return;
+  }
+  SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
+  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+  SDL_Window *window=SDL_CreateWindow("LabyrinthBench",0,0,64,64,SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  SDL_GLContext context= window ? SDL_GL_CreateContext(window) : 0;
+  if(!context)
+  {
+    std::cout<<"Text glyph setup skipped, no GL context : "<<SDL_GetError()<<"\n";
+    SDL_Quit();
+    return;
+  }
+  SDL_GL_MakeCurrent(window,context);
+  ngl::NGLInit::instance();
+
+  const unsigned int fonts=5;
+  Sample s=begin();
+  for(unsigned int i=0; i<fonts; ++i)
+  {
+    Text *text=new Text("font/arial.ttf",24);
+    delete text;
+  }
+  // glyph setup is mostly driver work so finish it before stopping the clock
+  glFinish();
+  end(s,"Text glyph setup (95 glyphs)",fonts);
+
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+  btAlignedAllocSetCustomAligned(countedAlignedAlloc,countedAlignedFree);
+
+  CollisionShape *shapes=CollisionShape::instance();
+  shapes->addSphere("ball", "obj/sphere.obj");
+  // radius of obj/sphere.obj
+  shapes->addPrimitiveSphere("primitiveBall", 0.54);
+  shapes->addMaze("maze", "obj/mazev3.obj");
+  shapes->addBox("cube", "obj/cubev2.obj");
+
+  benchStep("ball",1);
+  benchStep("ball",10);
+  benchStep("ball",100);
+  benchStep("ball",1000);
+
+  benchMazeLoad("obj/mazev1.obj");
+  benchMazeLoad("obj/mazev2.obj");
+  benchMazeLoad("obj/mazev3.obj");
+  // the game's size of generated maze and a big one
+  benchMazeGenerate(7);
+  benchMazeGenerate(100);
+  // streamed mazes ten and a hundred times as big as that
+  benchMazeStream(100);
+  benchMazeStream(1000);
+
+  // levels from a pack, an obj one and a generated one
+  LevelInfo level;
+  level.name="benchObj";
+  level.mesh="obj/mazev3.obj";
+  level.seed=0;
+  level.cells=0;
+  level.gravity=-100;
+  level.friction=0.3;
+  level.surface=MATERIAL_WOOD;
+  level.ballCollisions=true;
+  level.broadphase=BROADPHASE_DBVT;
+  level.wallThickness=MazeGenerator::getWallThickness();
+  benchLevelPrepare(level);
+  level.name="benchGenerated";
+  level.mesh.clear();
+  level.seed=1;
+  level.cells=12;
+  benchLevelPrepare(level);
+
+  // same scene with the hull from the obj and an analytic sphere
+  benchStep("ball",100);
+  benchStep("primitiveBall",100);
+
+  // balls passing through each other
+  benchStep("ball",1000,false);
+
+  // broadphases against each other as the maze fills up
+  const unsigned int counts[]={10,100,1000,3000};
+  for(unsigned int c=0; c<4; ++c)
+  {
+    for(int b=0; b<BROADPHASE_TYPES; ++b)
+    {
+      benchStep("ball",counts[c],true,BroadphaseType(b));
+    }
+  }
+
+  // a settled pile with the maze still, where it can sleep, and being tilted
+  benchResting(1000,false);
+  benchResting(1000,true);
+
+  // batch environments on one thread and on every core
+  benchVecEnv(64,1);
+  benchVecEnv(64,0);
+
+  // maze solvability and the autopilot playing, a minute of game time each
+  benchNavGrid("obj/mazev1.obj");
+  benchNavGrid("obj/mazev2.obj");
+  benchNavGrid("obj/mazev3.obj");
+  benchAutopilot(16,3600);
+
+  benchTransforms();
+
+  // ball against maze through the triangles and then through the distance field, which replaces
+  // the maze shape so has to come after everything else stepping a world
+  benchSdfBuild("obj/mazev3.obj");
+  benchMazeCollision("mesh",100);
+  benchMazeCollision("mesh",1000);
+  // party mode solves its balls itself against the same field
+  MazeSdf sdf;
+  sdf.loadOrBuild("obj/mazev3.obj");
+  benchSwarm(sdf,1000);
+  benchSwarm(sdf,10000);
+  shapes->addMazeSdf("maze", "obj/mazev3.obj");
+  benchMazeCollision("distance field",100);
+  benchMazeCollision("distance field",1000);
+
+  benchText();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#ifndef AUTOPILOT_H__
+#define AUTOPILOT_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Autopilot.h
+/// @brief plays the maze by following a NavGrid's distance field
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <btBulletDynamicsCommon.h>
+#include <ngl/Vec3.h>
+#include "NavGrid.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Autopilot "include/Autopilot.h"
+/// @brief Class that works out the tilt for a tick from where the ball is and how it is moving.
+/// The grid gives the way to go from the ball's cell, the ball is steered towards a steady speed
+/// that way by leaning the maze in proportion to the speed still needed, and the tilt moves
+/// towards that lean a little each tick as a player's would. Each tick is a lookup and a handful
+/// of sums so it can drive soak tests and batches of environments without costing anything.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class Autopilot
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _grid grid of the maze being played, not owned
+  //----------------------------------------------------------------------------------------------------------------------
+  Autopilot(const NavGrid *_grid=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the grid of the maze being played
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setGrid(const NavGrid *_grid) {m_grid=_grid;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the tilt for the next tick
+  /// @param[in] _ballPos _ballVelocity the ball in world space
+  /// @param[in] _mazeRotation _mazePos the maze's transform
+  /// @param[out] o_tiltX o_tiltZ angles to tilt the maze by this tick, as passed to PhysicsWorld::tilt
+  //----------------------------------------------------------------------------------------------------------------------
+  void act(const ngl::Vec3 &_ballPos, const ngl::Vec3 &_ballVelocity, const btQuaternion &_mazeRotation,
+           const ngl::Vec3 &_mazePos, float &o_tiltX, float &o_tiltZ) const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the grid being followed
+  //----------------------------------------------------------------------------------------------------------------------
+  const NavGrid *m_grid;
+};
+
+#endif
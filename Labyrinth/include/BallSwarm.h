@@ -0,0 +1,195 @@
+#ifndef BALLSWARM_H__
+#define BALLSWARM_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BallSwarm.h
+/// @brief thousands of identical balls solved outside bullet for party mode
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <algorithm>
+#include <btBulletDynamicsCommon.h>
+#include "MazeSdf.h"
+#include "MaterialTable.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class BallSwarm "include/BallSwarm.h"
+/// @brief Class that moves many balls of one size far more cheaply than a rigid body each. The
+/// positions and velocities are kept as separate arrays of floats so gravity and the move are done
+/// four balls at a time with SSE. Balls find each other through a uniform grid of cells the width
+/// of a ball, rebuilt each step with a counting sort. Contacts are solved on positions, a few
+/// passes pushing overlapping balls apart and out of the maze, and the velocities are then taken
+/// from how far each ball moved, which keeps deep piles from sinking without stiff impulses. The
+/// maze is a lookup in its MazeSdf and the player's balls are obstacles that push swarm balls aside
+/// without being pushed back. The balls slide rather than roll, which is not noticeable at this
+/// many. Balls that fall off the maze are dropped back in from above. PhysicsWorld owns one while
+/// party mode is on and steps it after the rigid bodies.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class BallSwarm
+{
+public :
+  BT_DECLARE_ALIGNED_ALLOCATOR();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _radius radius of every ball
+  /// @param[in] _gridMin _gridMax region the grid covers, balls outside still collide but share the edge cells
+  /// @param[in] _sdf field of the maze, not owned
+  //----------------------------------------------------------------------------------------------------------------------
+  BallSwarm(float _radius, const btVector3 &_gridMin, const btVector3 &_gridMax, const MazeSdf *_sdf);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the number of balls and drop them all in at random over a box
+  /// @param[in] _count number of balls
+  /// @param[in] _spawnMin _spawnMax box the balls are dropped from, and dropped back from later
+  /// @param[in] _killHeight balls below this go back to the box
+  //----------------------------------------------------------------------------------------------------------------------
+  void spawn(unsigned int _count, const btVector3 &_spawnMin, const btVector3 &_spawnMax, float _killHeight);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief forget the obstacles from the last step
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void clearObstacles() {m_obstacles.clear();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a sphere that pushes the swarm balls aside for the next step
+  /// @param[in] _pos _radius the sphere
+  //----------------------------------------------------------------------------------------------------------------------
+  void addObstacle(const btVector3 &_pos, float _radius);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief move every ball on by a step
+  /// @param[in] _dt length of the step
+  /// @param[in] _gravity gravity
+  /// @param[in] _maze the maze's transform now, the last step's is kept to work out how fast it moves
+  /// @param[in] _mazeMaterial what the maze is made of, the ball / maze pair in the MaterialTable is used
+  //----------------------------------------------------------------------------------------------------------------------
+  void step(float _dt, const btVector3 &_gravity, const btTransform &_maze, int _mazeMaterial);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief forget where the maze was, for when it is put back rather than tilted there
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void forgetMaze() {m_haveMaze=false;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the ball positions as x y z triples
+  //----------------------------------------------------------------------------------------------------------------------
+  void getPositions(std::vector <float> &o_xyz) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of balls
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int size() const {return m_px.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the contacts resolved in the last step, ball against ball, maze and obstacles
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumContacts() const {return m_contacts;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the radius of the balls
+  //----------------------------------------------------------------------------------------------------------------------
+  inline float getRadius() const {return m_radius;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a sphere the swarm is pushed out of
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    float pos[3];
+    float radius;
+  }Obstacle;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief gravity, speed limit and the move, four balls at a time where SSE is there. The
+  /// positions before the move are kept for working out the velocities afterwards
+  //----------------------------------------------------------------------------------------------------------------------
+  void integrate(float _dt, const btVector3 &_gravity);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sort the balls into the grid cells, the arrays are put in cell order so the balls
+  /// in a run of cells are next to each other in memory
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildGrid();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief move apart every pair of balls that overlap, returns the number of pairs
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int solvePairs();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief move the balls out of the maze and the obstacles, returns the number of balls touching
+  /// @param[in] _maze the maze's transform
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int solveMaze(const btTransform &_maze);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief take the velocities from how far the balls moved, then bounce and slow the ones on the maze
+  /// @param[in] _dt length of the step
+  /// @param[in] _maze the maze's transform
+  /// @param[in] _material friction and bounce of a ball on the maze
+  //----------------------------------------------------------------------------------------------------------------------
+  void updateVelocities(float _dt, const btTransform &_maze, const MaterialPair &_material);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief put a ball somewhere random in the spawn box, not moving
+  //----------------------------------------------------------------------------------------------------------------------
+  void respawn(unsigned int _ball);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the cell a point is in, points off the grid are in the nearest edge cell
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void cellOf(float _x, float _y, float _z, int &o_x, int &o_y, int &o_z) const
+  {
+    o_x=std::max(0,std::min(int((_x-m_gridMin[0])*m_invCell),m_dims[0]-1));
+    o_y=std::max(0,std::min(int((_y-m_gridMin[1])*m_invCell),m_dims[1]-1));
+    o_z=std::max(0,std::min(int((_z-m_gridMin[2])*m_invCell),m_dims[2]-1));
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ball radius
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_radius;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief positions and velocities, one array for each component
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <float> m_px;
+  std::vector <float> m_py;
+  std::vector <float> m_pz;
+  std::vector <float> m_vx;
+  std::vector <float> m_vy;
+  std::vector <float> m_vz;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief positions at the start of the step
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <float> m_ox;
+  std::vector <float> m_oy;
+  std::vector <float> m_oz;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the grid, its corner, cell counts along each axis and one over the cell size
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_gridMin[3];
+  int m_dims[3];
+  float m_invCell;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief first ball of each cell once sorted, with one more on the end for the total
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <unsigned int> m_cellStart;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the cell each ball is in, where each ball goes in cell order and room to reorder an array
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <unsigned int> m_ballCell;
+  std::vector <unsigned int> m_order;
+  std::vector <float> m_scratch;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the maze, and its transform at the last step
+  //----------------------------------------------------------------------------------------------------------------------
+  const MazeSdf *m_sdf;
+  btTransform m_mazePrev;
+  bool m_haveMaze;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief where lost balls go back to and how low they can go first
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_spawnMin[3];
+  float m_spawnMax[3];
+  float m_killHeight;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief spheres pushing the swarm this step
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Obstacle> m_obstacles;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief state of the random numbers for spawning, the same every run
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_random;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief contacts in the last step
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_contacts;
+};
+
+#endif
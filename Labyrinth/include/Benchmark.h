@@ -0,0 +1,196 @@
+#ifndef BENCHMARK_H__
+#define BENCHMARK_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Benchmark.h
+/// @brief scripted benchmark run, replays a tilt / ball spawn timeline and writes a JSON report
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <map>
+#include "PerfStats.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Benchmark "include/Benchmark.h"
+/// @brief Class to drive the game from a script for a fixed number of frames and report timings.
+/// The script is read like config.txt, one command per line
+///   Frames 1800              number of frames to run
+///   Output report.json       where to write the report
+///   Baseline base.json       optional report to compare against
+///   Threshold 10             allowed regression against the baseline in percent
+///   Tilt 60 up 0.003         from frame 60 set the up tilt speed (up, down, left or right)
+///   Ball 300                 spawn a ball at frame 300
+///   Size 1280 720            framebuffer size when running headless
+///   Capture 600 frame.ppm    write the frame drawn at frame 600 to an image
+///   Hash 60                  record a hash of every 60th frame in the report
+/// lines starting with # are comments
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class Benchmark
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  //----------------------------------------------------------------------------------------------------------------------
+  Benchmark();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read the script
+  /// @param[in] _fileName the script to load
+  /// @returns false if the script couldn't be read
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(const std::string &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of frames to run
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getFrames() const {return m_frames;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief apply the script commands for a frame to the tilt speeds
+  /// @param[in] _frame the frame about to be drawn
+  /// @param[in,out] io_up up tilt speed
+  /// @param[in,out] io_down down tilt speed
+  /// @param[in,out] io_left left tilt speed
+  /// @param[in,out] io_right right tilt speed
+  /// @returns number of balls to spawn this frame
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int apply(unsigned int _frame, float &io_up, float &io_down, float &io_left, float &io_right);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief record the timings of a frame
+  /// @param[in] _frameMs whole frame time
+  /// @param[in] _physicsMs time in Simulation::tick
+  /// @param[in] _drawMs time in NGLDraw::draw
+  //----------------------------------------------------------------------------------------------------------------------
+  void record(float _frameMs, float _physicsMs, float _drawMs);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the JSON report to the Output file
+  /// @returns false if the file couldn't be written
+  //----------------------------------------------------------------------------------------------------------------------
+  bool writeReport() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compare against the Baseline report if one was given
+  /// @returns false if any metric regressed by more than the threshold
+  //----------------------------------------------------------------------------------------------------------------------
+  bool compareBaseline() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief width of the framebuffer for headless runs
+  //----------------------------------------------------------------------------------------------------------------------
+  inline int getWidth() const {return m_width;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief height of the framebuffer for headless runs
+  //----------------------------------------------------------------------------------------------------------------------
+  inline int getHeight() const {return m_height;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the GL renderer written into the report
+  /// @param[in] _renderer the GL_RENDERER string
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setRenderer(const std::string &_renderer) {m_renderer=_renderer;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the frame should be written to an image
+  /// @param[in] _frame the frame just drawn
+  /// @param[out] o_file the image file name
+  //----------------------------------------------------------------------------------------------------------------------
+  bool captureFile(unsigned int _frame, std::string &o_file) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the frame should be hashed
+  /// @param[in] _frame the frame just drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool wantsHash(unsigned int _frame) const {return m_hashInterval>0 && _frame%m_hashInterval==0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief store a frame hash for the report
+  /// @param[in] _frame the frame just drawn
+  /// @param[in] _hash hash of the frame's pixels
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void recordHash(unsigned int _frame, unsigned int _hash) {m_hashes[_frame]=_hash;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a scripted command
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    unsigned int frame;
+    //0 up, 1 down, 2 left, 3 right, 4 ball
+    int type;
+    float value;
+  }Command;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief timings for one metric over the whole run
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    double sum;
+    float max;
+  }Totals;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sort order for the commands
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool commandBefore(const Command &_a, const Command &_b);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a metric to the report
+  //----------------------------------------------------------------------------------------------------------------------
+  void writeMetric(std::ostream &_out, const std::string &_name, const PerfHistogram &_h, const Totals &_t, bool _last) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the script commands sorted by frame
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Command> m_commands;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief next command to apply
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_next;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of frames to run
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_frames;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief script file name (written into the report)
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_script;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief report file name
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_output;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief baseline report file name
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_baseline;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allowed regression in percent
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_threshold;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief headless framebuffer size
+  //----------------------------------------------------------------------------------------------------------------------
+  int m_width;
+  int m_height;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the GL renderer
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_renderer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief frames to write as images
+  //----------------------------------------------------------------------------------------------------------------------
+  std::map <unsigned int,std::string> m_captures;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hash every nth frame, 0 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_hashInterval;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recorded frame hashes
+  //----------------------------------------------------------------------------------------------------------------------
+  std::map <unsigned int,unsigned int> m_hashes;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief histograms over the whole run, 10us buckets up to 100ms
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram m_frameTime;
+  PerfHistogram m_physicsTime;
+  PerfHistogram m_drawTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sums and maximums for the means
+  //----------------------------------------------------------------------------------------------------------------------
+  Totals m_frameTotals;
+  Totals m_physicsTotals;
+  Totals m_drawTotals;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include <btBulletDynamicsCommon.h>
 #include <map>
 #include <string>
+#include "MazeGenerator.h"
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @class CollisionShape "include/CollisionShape.h"
@@ -35,12 +36,66 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void addSphere(const std::string & _name, const std::string &_objFilePath);
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create an analytic sphere collision shape (cheaper contacts than the hull from the obj)
+  /// @param[in] name of shape as a string
+  /// @param[in] radius of the sphere
+  //----------------------------------------------------------------------------------------------------------------------
+  void addPrimitiveSphere(const std::string & _name, float _radius);
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief create collision shape for maze
   /// @param[in] name of shape as a string
   /// @param[in] file path to the obj mesh as a string
   //----------------------------------------------------------------------------------------------------------------------
   void addMaze(const std::string & _name, const std::string &_objFilePath);
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create collision shape for maze that balls collide with through its signed distance
+  /// field (see SdfCollision.h), falls back to the plain mesh if the field can't be made
+  /// @param[in] name of shape as a string
+  /// @param[in] file path to the obj mesh as a string, the field is cached next to it
+  /// @returns false if the plain mesh is used
+  //----------------------------------------------------------------------------------------------------------------------
+  bool addMazeSdf(const std::string & _name, const std::string &_objFilePath);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create collision shape for a generated maze straight from its vertex and index arrays,
+  /// nothing is copied so the MazeGenerator must not change or go away while the shape is used
+  /// @param[in] name of shape as a string
+  /// @param[in] _maze the generated maze
+  //----------------------------------------------------------------------------------------------------------------------
+  void addGeneratedMaze(const std::string & _name, const MazeGenerator &_maze);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create collision shape for a generated maze that balls collide with through its signed
+  /// distance field, which is built each time as generated mazes aren't cached. Falls back to the
+  /// plain mesh if the field can't be made
+  /// @param[in] name of shape as a string
+  /// @param[in] _maze the generated maze, kept to as in addGeneratedMaze
+  /// @returns false if the plain mesh is used
+  //----------------------------------------------------------------------------------------------------------------------
+  bool addGeneratedMazeSdf(const std::string & _name, const MazeGenerator &_maze);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief keep a shape made elsewhere under a name, it is owned by whoever made it
+  /// @param[in] name of shape as a string
+  /// @param[in] _shape the shape
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void addShape(const std::string & _name, btCollisionShape *_shape) {m_shapes[_name]=_shape;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief free a maze shape made by addMaze, addGeneratedMaze or their Sdf versions once nothing
+  /// uses it, with the mesh interface and field made for it. A generated maze's arrays are left alone
+  /// @param[in] _shape the shape, may be 0
+  //----------------------------------------------------------------------------------------------------------------------
+  static void deleteMazeShape(btCollisionShape *_shape);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make a triangle mesh shape that reads a generated mesh where it is, the caller deletes
+  /// the shape and its mesh interface and keeps the arrays alive until then
+  /// @param[in] _vertices _indices the mesh
+  /// @param[in] _buildBvh false when the caller sets a bvh it already has with setOptimizedBvh
+  //----------------------------------------------------------------------------------------------------------------------
+  static btBvhTriangleMeshShape *makeMeshShape(const std::vector <MazeVertex> &_vertices, const std::vector <unsigned int> &_indices,
+                                               bool _buildBvh=true);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns approximate bytes used by the triangles and bvh of a triangle mesh shape
+  //----------------------------------------------------------------------------------------------------------------------
+  static unsigned long meshShapeBytes(const btBvhTriangleMeshShape *_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief create collision shape for box
   /// @param[in] name of shape as a string
   /// @param[in] file path to the obj mesh as a string
@@ -51,6 +106,10 @@ public :
   /// @param[in] name of shape as a string
   //----------------------------------------------------------------------------------------------------------------------
   btCollisionShape* getShape(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns approximate bytes used by all the shapes (hull points, triangles, bvh nodes and fields)
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long getMemoryUsage() const;
 
 protected :
   //----------------------------------------------------------------------------------------------------------------------
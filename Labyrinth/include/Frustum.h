@@ -0,0 +1,47 @@
+#ifndef FRUSTUM_H__
+#define FRUSTUM_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Frustum.h
+/// @brief the six planes of a camera's view for throwing away boxes that can't be seen
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Frustum "include/Frustum.h"
+/// @brief Class that takes the planes of the view straight out of a model view projection matrix
+/// (Gribb and Hartmann's method) so boxes can be tested in whatever space the matrix starts from.
+/// Passing the maze's full transform lets its chunks be tested in the maze's own space without
+/// moving their boxes each frame. A box is only thrown away when it is wholly outside one plane, so
+/// a few boxes near the corners are kept that needn't be, which is fine for culling.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class Frustum
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, everything is inside until set is called
+  //----------------------------------------------------------------------------------------------------------------------
+  Frustum();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief take the planes from a matrix, ngl's row vector order as used for the shaders
+  /// @param[in] _mvp model view projection matrix
+  //----------------------------------------------------------------------------------------------------------------------
+  void set(const ngl::Mat4 &_mvp);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns false if a box is certainly out of view
+  /// @param[in] _min _max corners of the box
+  //----------------------------------------------------------------------------------------------------------------------
+  bool intersects(const ngl::Vec3 &_min, const ngl::Vec3 &_max) const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief left, right, bottom, top, near and far as a b c d, inside is a*x+b*y+c*z+d>=0
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_planes[6][4];
+};
+
+#endif
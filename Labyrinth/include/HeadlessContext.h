@@ -0,0 +1,54 @@
+#ifndef HEADLESSCONTEXT_H__
+#define HEADLESSCONTEXT_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file HeadlessContext.h
+/// @brief OpenGL context without a window or display for headless benchmark runs
+//----------------------------------------------------------------------------------------------------------------------
+
+// keep Xlib's macros (None, Bool, Status ...) out of the game, we never use the X11 platform
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class HeadlessContext "include/HeadlessContext.h"
+/// @brief Class to create a desktop OpenGL context through EGL with no surface, so the game can be
+/// rendered on machines without X / Wayland (on build servers this will be Mesa's llvmpipe software
+/// rasterizer). There is no default framebuffer so NGLDraw must render into its offscreen target.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class HeadlessContext
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the context isn't created until create is called
+  //----------------------------------------------------------------------------------------------------------------------
+  HeadlessContext();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor releases the context and display
+  //----------------------------------------------------------------------------------------------------------------------
+  ~HeadlessContext();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create a core profile context and make it current
+  /// @returns false if EGL or a suitable context isn't available
+  //----------------------------------------------------------------------------------------------------------------------
+  bool create();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the GL_RENDERER string so reports say what rendered them
+  //----------------------------------------------------------------------------------------------------------------------
+  const char *getRenderer() const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief EGL display connection
+  //----------------------------------------------------------------------------------------------------------------------
+  EGLDisplay m_display;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the GL context
+  //----------------------------------------------------------------------------------------------------------------------
+  EGLContext m_context;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef LEVELPACK_H__
+#define LEVELPACK_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file LevelPack.h
+/// @brief a list of levels read from a manifest, each prepared (mesh, bvh and texture) ahead of being played
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <ngl/Vec3.h>
+#include <ngl/Texture.h>
+#include <btBulletCollisionCommon.h>
+#include "MazeGenerator.h"
+#include "MaterialTable.h"
+#include "PhysicsWorld.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a level as the manifest describes it
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  // names the level's cache files so must be unique in the pack
+  std::string name;
+  // obj the maze is read from, empty for a generated maze
+  std::string mesh;
+  // seed and cells along each side of a generated maze
+  unsigned int seed;
+  unsigned int cells;
+  // image drawn on the maze, empty for the texture the game started with
+  std::string texture;
+  // where the ball starts and the middle of the top of the goal hole, in the maze's space. Generated
+  // mazes work these out themselves
+  ngl::Vec3 start;
+  ngl::Vec3 goal;
+  int gravity;
+  float friction;
+  MaterialId surface;
+  bool ballCollisions;
+  // the axis sweeps are sized to the level's maze when it is played
+  BroadphaseType broadphase;
+  // thinnest wall of the maze, steps are split so balls move at most half of it. Generated mazes
+  // fill in their own
+  float wallThickness;
+}LevelInfo;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Level "include/LevelPack.h"
+/// @brief Class that holds everything a level needs once it has been prepared: its mesh in the
+/// layout the renderer and bullet both read, the maze's collision shape with its bvh and the
+/// decoded texture. Preparing does all the slow work (reading files, building the bvh, decoding the
+/// image) without touching GL so it can run on any thread, what is left for the render thread is
+/// uploading. The mesh of an obj level is cached next to the manifest so the obj isn't parsed again,
+/// and every level's bvh is cached there too so it is read rather than built. Both caches carry a
+/// hash of what they were made from and are made again when it changes.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class Level
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the level is empty until it is prepared
+  //----------------------------------------------------------------------------------------------------------------------
+  Level();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor frees the shape and the bvh it reads from, the maze body must be gone by now
+  //----------------------------------------------------------------------------------------------------------------------
+  ~Level();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load the level's mesh, bvh and texture, reading the caches where they are good and
+  /// writing them where they are not
+  /// @param[in] _info the level from the manifest
+  /// @param[in] _cacheDir directory the mesh and bvh caches live in, ending in a /
+  /// @returns false if the maze couldn't be loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  bool prepare(const LevelInfo &_info, const std::string &_cacheDir);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true once the level has been prepared
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isValid() const {return m_shape!=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the level as the manifest describes it, start and goal filled in for generated mazes
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const LevelInfo &getInfo() const {return m_info;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the mesh, the shape reads its triangles from here so it lives as long as the level
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const MazeMesh &getMesh() const {return m_mesh;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the maze's collision shape
+  //----------------------------------------------------------------------------------------------------------------------
+  inline btBvhTriangleMeshShape *getShape() const {return m_shape;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the decoded texture to upload, 0 to keep the one the game started with
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const ngl::Texture *getTexture() const {return m_texture;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the bvh was read from the cache rather than built
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool bvhFromCache() const {return m_bvhBuffer!=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the mesh as a list of triangles, three points each
+  /// @param[out] o_triangles the triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  void getTriangles(std::vector <ngl::Vec3> &o_triangles) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns approximate bytes used by the mesh and bvh
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long getMemoryUsage() const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy ctor and assignment not allowed, the shape points into our arrays
+  //----------------------------------------------------------------------------------------------------------------------
+  Level(const Level &);
+  Level &operator=(const Level &);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief turn an obj into our mesh, one vertex for each corner of each face and bigger faces split into a fan
+  /// @param[in] _objFile the obj
+  /// @returns false if it has no faces
+  //----------------------------------------------------------------------------------------------------------------------
+  bool convertObj(const std::string &_objFile);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read and write the binary mesh cache
+  /// @param[in] _file the cache
+  /// @param[in] _key hash of the obj it was made from
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadMesh(const std::string &_file, uint32_t _key);
+  bool saveMesh(const std::string &_file, uint32_t _key) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read the bvh cache into an aligned buffer and lay the bvh out in place, on success the
+  /// buffer and bvh are kept in m_bvhBuffer and m_bvh
+  /// @param[in] _file the cache
+  /// @param[in] _key hash of the mesh it was made from
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadBvh(const std::string &_file, uint32_t _key);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the shape's bvh to the cache
+  //----------------------------------------------------------------------------------------------------------------------
+  bool saveBvh(const std::string &_file, uint32_t _key) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns a hash of the mesh, the key for its bvh
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t meshKey() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the level
+  //----------------------------------------------------------------------------------------------------------------------
+  LevelInfo m_info;
+  MazeMesh m_mesh;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief collision shape of the maze and the bvh read from the cache, the bvh is laid out in
+  /// m_bvhBuffer. Both are 0 when the shape built its own
+  //----------------------------------------------------------------------------------------------------------------------
+  btBvhTriangleMeshShape *m_shape;
+  btOptimizedBvh *m_bvh;
+  void *m_bvhBuffer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the decoded texture, 0 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::Texture *m_texture;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class LevelPack "include/LevelPack.h"
+/// @brief Class that reads a level pack manifest and hands out prepared Levels. While one level is
+/// played the next is prepared on a thread of its own (prefetch) so winning moves straight on to
+/// it, take waits for the thread if it hasn't finished and prepares the level there and then if it
+/// wasn't the one prefetched. The manifest has a Level line naming each level followed by the lines
+/// that set it up, anything a level leaves out comes from the config file
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class LevelPack
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  //----------------------------------------------------------------------------------------------------------------------
+  LevelPack();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor waits for a prefetch to finish and frees the level it prepared
+  //----------------------------------------------------------------------------------------------------------------------
+  ~LevelPack();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read the manifest, the caches go in the directory it is in
+  /// @param[in] _manifest the manifest file
+  /// @param[in] _defaults settings for anything a level doesn't set
+  /// @returns false if it couldn't be read or has no levels
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(const std::string &_manifest, const LevelInfo &_defaults);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of levels
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int size() const {return m_levels.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns a level as the manifest describes it
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const LevelInfo &getInfo(unsigned int _level) const {return m_levels[_level];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start preparing a level in the background, waits for any prefetch already running
+  /// @param[in] _level the level
+  //----------------------------------------------------------------------------------------------------------------------
+  void prefetch(unsigned int _level);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the prefetched level is ready to take without waiting
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isReady() {return SDL_AtomicGet(&m_done)!=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hand over a prepared level, the caller owns it
+  /// @param[in] _level the level
+  /// @returns the level, 0 if it couldn't be prepared
+  //----------------------------------------------------------------------------------------------------------------------
+  Level *take(unsigned int _level);
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief entry point for the prefetch thread
+  //----------------------------------------------------------------------------------------------------------------------
+  static int prefetchMain(void *_pack);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wait for the prefetch thread if there is one
+  //----------------------------------------------------------------------------------------------------------------------
+  void wait();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the levels and the directory the caches go in
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <LevelInfo> m_levels;
+  std::string m_cacheDir;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the prefetch, m_prefetched is owned by the thread until m_done is set
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_Thread *m_thread;
+  SDL_atomic_t m_done;
+  int m_prefetchLevel;
+  Level *m_prefetched;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef MATERIALTABLE_H__
+#define MATERIALTABLE_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MaterialTable.h
+/// @brief surface materials and the table of combined contact properties for each pair of them
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief material ids, stored in each body's user index
+//----------------------------------------------------------------------------------------------------------------------
+enum MaterialId
+{
+  MATERIAL_DEFAULT=0,
+  MATERIAL_BALL,
+  MATERIAL_GROUND,
+  MATERIAL_GOAL,
+  MATERIAL_WOOD,
+  MATERIAL_ICE,
+  MATERIAL_CARPET,
+  MATERIALS
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief contact properties used when two materials touch
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  float friction;
+  float restitution;
+  float rollingFriction;
+}MaterialPair;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MaterialTable "include/MaterialTable.h"
+/// @brief Class holding the combined friction, restitution and rolling friction for every pair of
+/// materials. The contact added callback PhysicsWorld installs looks each new contact up here, so
+/// tuning a surface is a table entry rather than a friction baked into each body. This is a
+/// singleton as bullet's callback is a global.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MaterialTable
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the table
+  //----------------------------------------------------------------------------------------------------------------------
+  static MaterialTable *instance();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill the table with the game's surfaces
+  /// @param[in] _friction friction from the config file, the ball and maze surfaces are scaled by it
+  //----------------------------------------------------------------------------------------------------------------------
+  void setDefaults(float _friction);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the properties for a pair of materials (either way round)
+  //----------------------------------------------------------------------------------------------------------------------
+  void setPair(int _a, int _b, float _friction, float _restitution, float _rollingFriction);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the properties for a pair of materials, ids out of range are treated as the default
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const MaterialPair &get(int _a, int _b) const
+  {
+    return m_pairs[(unsigned int)_a<MATERIALS ? _a : 0][(unsigned int)_b<MATERIALS ? _b : 0];
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the name of a material as used in the config file
+  //----------------------------------------------------------------------------------------------------------------------
+  static const char *materialName(int _material);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief look up a material from its name
+  /// @param[in] _name the name
+  /// @param[out] o_material the material
+  /// @returns false if the name isn't known
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool materialFromName(const std::string &_name, MaterialId &o_material);
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor fills the table with setDefaults(0.3)
+  //----------------------------------------------------------------------------------------------------------------------
+  MaterialTable();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the table, symmetric
+  //----------------------------------------------------------------------------------------------------------------------
+  MaterialPair m_pairs[MATERIALS][MATERIALS];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the instance
+  //----------------------------------------------------------------------------------------------------------------------
+  static MaterialTable *s_instance;
+};
+
+#endif
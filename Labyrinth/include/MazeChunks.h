@@ -0,0 +1,180 @@
+#ifndef MAZECHUNKS_H__
+#define MAZECHUNKS_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeChunks.h
+/// @brief collision for big generated mazes, only the chunks near the balls are kept in
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <SDL.h>
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+#include "MazeGenerator.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MazeChunkShape "include/MazeChunks.h"
+/// @brief Compound of the chunks in at the moment that always reports the whole maze's bounds, so
+/// the maze's broadphase entry stays put as chunks come and go and a ball over a chunk that is
+/// about to come in is already paired with the maze
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MazeChunkShape : public btCompoundShape
+{
+public :
+  BT_DECLARE_ALIGNED_ALLOCATOR();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _min _max bounds of the whole maze in its own space
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeChunkShape(const btVector3 &_min, const btVector3 &_max);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the whole maze's bounds moved by a transform
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual void getAabb(const btTransform &_t, btVector3 &o_min, btVector3 &o_max) const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bounds of the whole maze
+  //----------------------------------------------------------------------------------------------------------------------
+  btVector3 m_boundsMin;
+  btVector3 m_boundsMax;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MazeChunks "include/MazeChunks.h"
+/// @brief Class that keeps the collision of a maze too big to hold whole to the chunks the balls
+/// are on or near. Each chunk is built from the MazeGenerator when a ball comes within a cell of it
+/// and becomes a triangle mesh child of a MazeChunkShape, and is thrown away once every ball is more
+/// than two cells from it, so balls moving along a chunk edge don't keep building the same chunks.
+/// Chunks a ball is heading for are built ahead on a thread of its own, the way LevelPack prefetches
+/// levels, so bringing one in is usually just adding the child and the bvh build stays out of the
+/// step. A chunk that isn't ready when it is needed is built there and then.
+/// The work each tick and the memory held depend on the number of balls, not the size of the maze.
+/// The Simulation owns it and updates it before each step.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MazeChunks
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _maze the maze, generated without its whole mesh, not owned and must outlive us
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeChunks(const MazeGenerator *_maze);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor waits for a prefetch to finish and deletes the shape and every chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  ~MazeChunks();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the shape to collide with, the same one for as long as we live
+  //----------------------------------------------------------------------------------------------------------------------
+  inline MazeChunkShape *getShape() {return m_shape;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bring in the chunks near the balls and throw out the ones nowhere near any
+  /// @param[in] _maze the maze's transform
+  /// @param[in] _balls where the balls are in the world
+  /// @returns true if any chunk came in or went out
+  //----------------------------------------------------------------------------------------------------------------------
+  bool update(const btTransform &_maze, const std::vector <btVector3> &_balls);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of chunks in, and in the whole maze
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumResident() const {return m_chunks.size();}
+  inline unsigned int getNumChunks() const {return m_maze->getNumChunks();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of chunks built so far
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long getNumBuilt() const {return m_built;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the bytes held by the chunks in and built ahead, their meshes and bvhs
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long getMemoryUsage() const;
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a chunk that is in
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    unsigned int index;
+    MazeMesh *mesh;
+    btBvhTriangleMeshShape *shape;
+    btVector3 min;
+    btVector3 max;
+  }Chunk;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a chunk to the shape, taking it from the ones built ahead if it is there
+  //----------------------------------------------------------------------------------------------------------------------
+  void bringIn(unsigned int _index);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief take a chunk out of the shape and delete it
+  //----------------------------------------------------------------------------------------------------------------------
+  void throwOut(unsigned int _resident);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the mesh and shape of a chunk, reads nothing but the maze so runs on any thread
+  /// @param[in,out] io_chunk the chunk, with its index set
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(Chunk &io_chunk) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief delete a chunk's shape and mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  static void freeChunk(Chunk &_chunk);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns where a chunk is in a list, -1 if it isn't
+  //----------------------------------------------------------------------------------------------------------------------
+  static int findChunk(const std::vector <Chunk> &_chunks, unsigned int _index);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if a ball in m_local is within a distance of a chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  bool nearBall(const Chunk &_chunk, float _distance) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief take the chunks from a prefetch that has finished, without waiting for one that hasn't
+  //----------------------------------------------------------------------------------------------------------------------
+  void collectPrefetch();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start building the chunks near the balls that aren't in or built, if no prefetch is running
+  //----------------------------------------------------------------------------------------------------------------------
+  void startPrefetch();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief entry point for the prefetch thread
+  //----------------------------------------------------------------------------------------------------------------------
+  static int prefetchMain(void *_chunks);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wait for the prefetch thread if there is one
+  //----------------------------------------------------------------------------------------------------------------------
+  void wait();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the maze the chunks come from
+  //----------------------------------------------------------------------------------------------------------------------
+  const MazeGenerator *m_maze;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the compound the chunks are children of
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeChunkShape *m_shape;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the chunks in, in no order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Chunk> m_chunks;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief chunks built ahead that aren't in yet
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Chunk> m_ready;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the prefetch, m_building is owned by the thread until m_done is set
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_Thread *m_thread;
+  SDL_atomic_t m_done;
+  std::vector <Chunk> m_building;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the balls in the maze's space, kept to save allocating each tick
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <btVector3> m_local;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief chunks built so far
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_built;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef MAZEGENERATOR_H__
+#define MAZEGENERATOR_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeGenerator.h
+/// @brief seeded random mazes built straight into render and collision arrays
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <ngl/Vec3.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a vertex of the generated maze, laid out as ngl's VAOs expect (position, uv, normal)
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  float x;
+  float y;
+  float z;
+  float u;
+  float v;
+  float nx;
+  float ny;
+  float nz;
+}MazeVertex;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief an indexed mesh of the maze or a chunk of it
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  std::vector <MazeVertex> vertices;
+  std::vector <unsigned int> indices;
+}MazeMesh;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MazeGenerator "include/MazeGenerator.h"
+/// @brief Class that carves a perfect maze out of a grid of cells with a randomized depth first
+/// backtracker, then builds it the way mazev3.obj is built: a floor slab with walls standing on it
+/// and a hole in the floor over the goal. The cells are turned into a grid of blocks, posts at the
+/// corners, walls between cells and the cells themselves, and each row of solid blocks becomes one
+/// box so long walls are a handful of triangles. The floor is a grid of vertices shared by the
+/// blocks around them, so the mesh comes out welded and indexed. Texture coordinates are planar so
+/// wood.tif runs across the maze without seams. The vertex and index arrays are used as they are
+/// for drawing and by CollisionShape::addGeneratedMaze for collision, nothing goes through an obj.
+/// The start is the corner cell and the goal the cell furthest along the maze from it, so every
+/// seed plays differently. The same seed and size always give the same maze. Big mazes can skip
+/// the whole mesh and be built a chunk of cells at a time instead, each chunk a mesh of its own
+/// that only needs the carved walls, so MazeChunks and NGLDraw can keep just the ones near the
+/// balls or in view.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MazeGenerator
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, there is no maze until generate is called
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeGenerator();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief carve a new maze and build its mesh, centred on the origin in the maze's own space
+  /// @param[in] _seed seed for the random numbers
+  /// @param[in] _width _depth number of cells along x and z
+  /// @param[in] _buildMesh false to leave the mesh to be built a chunk at a time
+  //----------------------------------------------------------------------------------------------------------------------
+  void generate(unsigned int _seed, unsigned int _width, unsigned int _depth, bool _buildMesh=true);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true once a maze has been generated
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isValid() const {return !m_open.empty();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the whole mesh was built, false if it is only there in chunks
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool hasMesh() const {return !m_mesh.indices.empty();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the vertices of the mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector <MazeVertex> &getVertices() const {return m_mesh.vertices;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the triangles of the mesh as three indices each, counter clockwise from outside
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector <unsigned int> &getIndices() const {return m_mesh.indices;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of chunks along x and z and in all
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getChunksX() const {return (m_width+getChunkCells()-1)/getChunkCells();}
+  inline unsigned int getChunksZ() const {return (m_depth+getChunkCells()-1)/getChunkCells();}
+  inline unsigned int getNumChunks() const {return getChunksX()*getChunksZ();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the box round a chunk in the maze's own space, chunks tile the maze without overlapping
+  /// @param[in] _chunk chunk, x then z
+  /// @param[out] o_min o_max corners of the box
+  //----------------------------------------------------------------------------------------------------------------------
+  void getChunkBounds(unsigned int _chunk, ngl::Vec3 &o_min, ngl::Vec3 &o_max) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the chunks a box over the maze touches, in the maze's own space
+  /// @param[in] _minX _minZ _maxX _maxZ the box
+  /// @param[out] o_x0 o_z0 o_x1 o_z1 first and last chunk along x and z that it touches
+  /// @returns false if the box misses the maze
+  //----------------------------------------------------------------------------------------------------------------------
+  bool getChunkRange(float _minX, float _minZ, float _maxX, float _maxZ, unsigned int &o_x0, unsigned int &o_z0,
+                     unsigned int &o_x1, unsigned int &o_z1) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the mesh of one chunk, the chunks together make the same surface as the whole mesh
+  /// @param[in] _chunk chunk, x then z
+  /// @param[out] o_mesh cleared and filled with the chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildChunk(unsigned int _chunk, MazeMesh &o_mesh) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the triangles out as three corners each, for building a MazeSdf or NavGrid. Done
+  /// chunk by chunk if there is no whole mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  void getTriangles(std::vector <ngl::Vec3> &o_triangles) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the centre of the start cell level with the tops of the walls
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const ngl::Vec3 &getStart() const {return m_start;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the centre of the hole over the goal level with the top of the floor
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const ngl::Vec3 &getGoal() const {return m_goal;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the seed and the number of cells along x and z
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getSeed() const {return m_seed;}
+  inline unsigned int getWidth() const {return m_width;}
+  inline unsigned int getDepth() const {return m_depth;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the distance between the centres of neighbouring cells
+  //----------------------------------------------------------------------------------------------------------------------
+  static float getCellSize();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the thickness of the walls
+  //----------------------------------------------------------------------------------------------------------------------
+  static float getWallThickness();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of cells along each side of a chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  static unsigned int getChunkCells();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the bytes used by the carved walls, vertices and indices
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long getMemoryUsage() const
+  {
+    return m_open.size()+m_mesh.vertices.size()*sizeof(MazeVertex)+m_mesh.indices.size()*sizeof(unsigned int);
+  }
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief knock down walls with the backtracker, leaving m_open set and the goal cell picked
+  //----------------------------------------------------------------------------------------------------------------------
+  void carve();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the range of blocks in a chunk
+  /// @param[in] _chunk chunk, x then z
+  /// @param[out] o_i0 o_j0 first block along x and z, o_i1 o_j1 one past the last
+  //----------------------------------------------------------------------------------------------------------------------
+  void chunkBlocks(unsigned int _chunk, unsigned int &o_i0, unsigned int &o_j0, unsigned int &o_i1, unsigned int &o_j1) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add the floor slab under a range of blocks, its top, its underside and the sides of the
+  /// goal hole if it is there, then a box for each row of solid blocks
+  /// @param[in] _i0 _j0 first block along x and z
+  /// @param[in] _i1 _j1 one past the last block along x and z
+  /// @param[out] o_mesh mesh to add to
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildBlocks(unsigned int _i0, unsigned int _j0, unsigned int _i1, unsigned int _j1, MazeMesh &o_mesh) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if a block is a post or a wall that is still standing
+  /// @param[in] _i _j block along x and z, there are twice the cells plus one each way
+  //----------------------------------------------------------------------------------------------------------------------
+  bool solid(unsigned int _i, unsigned int _j) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns where block _i starts along an axis, posts and walls are thin and cells wide
+  /// @param[in] _cells number of cells along the axis
+  //----------------------------------------------------------------------------------------------------------------------
+  static float blockEdge(unsigned int _i, unsigned int _cells);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a vertex, returns its index
+  //----------------------------------------------------------------------------------------------------------------------
+  static unsigned int addVertex(MazeMesh &o_mesh, float _x, float _y, float _z, const ngl::Vec3 &_normal);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add two triangles over four indexed corners, counter clockwise from outside
+  //----------------------------------------------------------------------------------------------------------------------
+  static void addQuad(MazeMesh &o_mesh, unsigned int _a, unsigned int _b, unsigned int _c, unsigned int _d);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a flat quad with vertices of its own, counter clockwise from outside
+  //----------------------------------------------------------------------------------------------------------------------
+  static void addFace(MazeMesh &o_mesh, const ngl::Vec3 &_a, const ngl::Vec3 &_b, const ngl::Vec3 &_c, const ngl::Vec3 &_d,
+                      const ngl::Vec3 &_normal);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add the triangles of a mesh as three corners each
+  //----------------------------------------------------------------------------------------------------------------------
+  static void appendTriangles(const MazeMesh &_mesh, std::vector <ngl::Vec3> &o_triangles);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the next random number (xorshift)
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int random();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief seed and cells along x and z
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_seed;
+  unsigned int m_width;
+  unsigned int m_depth;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief for each cell whether the walls on its +x and +z sides are gone (bits 1 and 2)
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <unsigned char> m_open;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the goal cell
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_goalCell;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the whole mesh, empty if it is built in chunks
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeMesh m_mesh;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief where the ball starts and where the goal is
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::Vec3 m_start;
+  ngl::Vec3 m_goal;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief state of the random numbers
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_random;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef MAZESDF_H__
+#define MAZESDF_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeSdf.h
+/// @brief 3D signed distance field of a maze in its own space, cached next to the obj
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+#include <ngl/Vec3.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MazeSdf "include/MazeSdf.h"
+/// @brief Class that samples the distance to a maze obj's surface on a regular 3D grid in the
+/// maze's own space, negative inside the walls and floor. Distances are only worked out near the
+/// surface and are clamped beyond that, which is all a ball needs. Inside is found from the
+/// surfaces above and below each column, so it suits mazes made of a floor and walls standing on
+/// it. Looking up a point is a trilinear sample of the eight grid points around it, and the
+/// gradient of the same sample gives the way out of the surface, so a ball against the maze costs
+/// the same however many triangles the maze has. Building it is the slow part so the result is
+/// saved next to the obj and reused until the obj changes.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MazeSdf
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the field is empty until built or loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeSdf();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load the cached field for a maze, or build it and write the cache if there is none or
+  /// it is out of date
+  /// @param[in] _objFile the maze obj, the cache is this with .sdf added
+  /// @returns false if the obj couldn't be read
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadOrBuild(const std::string &_objFile);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the field of a maze obj
+  /// @param[in] _objFile the maze obj
+  /// @returns false if the obj couldn't be read or has no triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::string &_objFile);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the field of a maze made in memory (see MazeGenerator), it has no key so isn't cached
+  /// @param[in] _triangles corners of the maze's triangles in threes, in the maze's space
+  /// @returns false if there are no triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::vector <ngl::Vec3> &_triangles);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the field to a file
+  //----------------------------------------------------------------------------------------------------------------------
+  bool save(const std::string &_file) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read a field written by save
+  /// @param[in] _file the file
+  /// @param[in] _key key the field must have been built with, 0 to take any
+  /// @returns false if it couldn't be read or was built from something else
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(const std::string &_file, uint32_t _key=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief look up the distance to the surface from a point
+  /// @param[in] _local point in the maze's space
+  /// @param[out] o_distance distance to the surface, negative inside
+  /// @param[out] o_gradient way the distance grows fastest, not normalized
+  /// @returns false if the point is off the grid, so further from the maze than the field reaches
+  //----------------------------------------------------------------------------------------------------------------------
+  bool sample(const btVector3 &_local, btScalar &o_distance, btVector3 &o_gradient) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the furthest from the surface the field is exact, further points read this
+  //----------------------------------------------------------------------------------------------------------------------
+  static btScalar getBand();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the size of the grid in points along each axis
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getWidth() const {return m_size[0];}
+  inline unsigned int getHeight() const {return m_size[1];}
+  inline unsigned int getDepth() const {return m_size[2];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the bytes used by the grid
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long getMemoryUsage() const {return m_distance.size()*sizeof(float);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the field has been built or loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isValid() const {return !m_distance.empty();}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the key of a build from the obj's contents and the build settings
+  //----------------------------------------------------------------------------------------------------------------------
+  static uint32_t makeKey(const std::string &_objFile);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the index of a grid point
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int pointIndex(unsigned int _x, unsigned int _y, unsigned int _z) const
+  {
+    return (_z*m_size[1]+_y)*m_size[0]+_x;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief key of the obj and settings the field was built from
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t m_key;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of grid points along x, y and z and the position of point 0
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_size[3];
+  float m_origin[3];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief distance at each grid point, along x then y then z
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <float> m_distance;
+};
+
+#endif
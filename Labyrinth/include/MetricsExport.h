@@ -0,0 +1,58 @@
+#ifndef METRICSEXPORT_H__
+#define METRICSEXPORT_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MetricsExport.h
+/// @brief publishes the performance counters into a POSIX shared memory segment
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MetricsLayout.h"
+#include "PerfStats.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MetricsExport "include/MetricsExport.h"
+/// @brief Class to publish PerfStats into the shared memory segment described in MetricsLayout.h
+/// so they can be read by labyrinthstat while the game runs. Publishing is a handful of stores
+/// into mapped memory, there is no I/O or locking once the segment is open.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MetricsExport
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the segment isn't created until open is called
+  //----------------------------------------------------------------------------------------------------------------------
+  MetricsExport();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor unmaps and removes the segment
+  //----------------------------------------------------------------------------------------------------------------------
+  ~MetricsExport();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create and map the segment
+  /// @returns false if the segment couldn't be created, publish is then a no-op
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy the counters into the segment, called once per frame
+  /// @param[in] _stats the counters to publish
+  /// @param[in] _state current game state
+  //----------------------------------------------------------------------------------------------------------------------
+  void publish(const PerfStats &_stats, int _state);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns if the segment is mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isOpen() const {return m_segment!=0;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mapped segment
+  //----------------------------------------------------------------------------------------------------------------------
+  MetricsSegment *m_segment;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief physics steps already added to the step histogram
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_lastSteps;
+};
+
+#endif
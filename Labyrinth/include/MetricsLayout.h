@@ -0,0 +1,75 @@
+#ifndef METRICSLAYOUT_H__
+#define METRICSLAYOUT_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MetricsLayout.h
+/// @brief layout of the shared memory counters segment the game publishes and labyrinthstat reads.
+/// This header is shared by both programs so must only use fixed size types and no game headers.
+///
+/// The segment is created with shm_open(METRICS_SEGMENT_NAME) and holds a single MetricsSegment.
+/// All counters are totals since the game started so readers should take deltas between samples.
+/// The game is the only writer and uses a sequence lock, it makes sequence odd, writes the
+/// counters then makes sequence even again. A reader copies the whole struct and retries if the
+/// sequence was odd or changed during the copy, so the game never waits on a reader.
+///
+/// Version history
+///  1 initial layout
+///  2 governorLevel
+/// A reader must check magic and version before trusting anything else. New fields are only
+/// ever added at the end and bump the version, size holds sizeof(MetricsSegment) of the writer.
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief name passed to shm_open
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_SEGMENT_NAME "/labyrinth_metrics"
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief "LABY" so readers can reject a segment that isn't ours
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_MAGIC 0x4c414259
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief current layout version
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_VERSION 2
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief number of buckets in the step time histogram, the last bucket also holds everything above it
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_STEP_BUCKETS 64
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief width of a step time histogram bucket in microseconds (64 x 250us covers 0-16ms)
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_STEP_BUCKET_US 250
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief asset categories for the resident memory counters, the order is part of the layout
+/// 0 meshes, 1 textures, 2 fonts, 3 collision shapes
+//----------------------------------------------------------------------------------------------------------------------
+#define METRICS_ASSET_CATEGORIES 4
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the shared memory segment, every field is naturally aligned so the layout is the same
+/// for 32 and 64 bit builds
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t magic;                                   ///< METRICS_MAGIC
+  uint32_t version;                                 ///< METRICS_VERSION of the writer
+  uint32_t size;                                    ///< sizeof(MetricsSegment) of the writer
+  uint32_t pid;                                     ///< process id of the game
+  volatile uint32_t sequence;                       ///< odd while the game is writing
+  uint32_t state;                                   ///< game state 0 menu, 1 playing, 2 lost, 3 won
+  uint64_t frames;                                  ///< frames swapped
+  uint64_t physicsSteps;                            ///< calls to PhysicsWorld::step
+  uint64_t substeps;                                ///< substeps bullet took over all steps
+  uint32_t bodies;                                  ///< awake dynamic bodies at the last step
+  uint32_t contacts;                                ///< contact points at the last step
+  uint64_t stepHistogram[METRICS_STEP_BUCKETS];     ///< step time counts, bucket i is [i,i+1)*METRICS_STEP_BUCKET_US
+  uint64_t assetBytes[METRICS_ASSET_CATEGORIES];    ///< approximate resident bytes per asset category
+  uint32_t wins;                                    ///< games won
+  uint32_t losses;                                  ///< games lost
+  uint32_t governorLevel;                           ///< physics work being shed, 0 none up to 4 no new balls
+  uint32_t reserved;                                ///< keeps the size a multiple of 8 for 32 bit readers
+}MetricsSegment;
+
+#endif
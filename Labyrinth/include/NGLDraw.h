@@ -11,7 +11,15 @@
 #include <SDL.h>
 #include <btBulletDynamicsCommon.h>
 #include <ngl/Obj.h>
+#include <ngl/VertexArrayObject.h>
 #include <Text.h>
+#include "PerfStats.h"
+#include "Snapshot.h"
+#include "StepGovernor.h"
+#include "MazeGenerator.h"
+#include "Frustum.h"
+#include "LevelPack.h"
+#include <map>
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @class NGLDraw "include/NGLDraw.h"
@@ -21,15 +29,21 @@
 /// @date 10/04/2014
 //----------------------------------------------------------------------------------------------------------------------
 
-class PhysicsWorld;
-
 class NGLDraw
 {
 public :
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief ctor this will have a valid OpenGL context so we can create gl stuff
+    /// @param[in] _maze generated maze to draw, 0 to draw mazev3.obj. One without its whole mesh is
+    /// drawn a chunk at a time and must outlive us
+    //----------------------------------------------------------------------------------------------------------------------
+    NGLDraw(const MazeGenerator *_maze=0);
     //----------------------------------------------------------------------------------------------------------------------
-    NGLDraw();
+    /// @brief draw a level from a LevelPack in place of the maze we have, putting its mesh and
+    /// texture on the gpu. We don't keep hold of the level
+    /// @param _level the prepared level
+    //----------------------------------------------------------------------------------------------------------------------
+    void setLevel(const Level &_level);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief dtor used to remove any NGL stuff created
     //----------------------------------------------------------------------------------------------------------------------
@@ -42,8 +56,9 @@ public :
     void resize(int _w, int _h);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief draw the scene
+    /// @param[in] _snapshot the bodies and counters from the simulation to draw
     //----------------------------------------------------------------------------------------------------------------------
-    void draw();
+    void draw(const Snapshot &_snapshot);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief this method is called every time a mouse is moved
     /// @param _event the SDL mouse event structure containing all mouse info
@@ -65,75 +80,161 @@ public :
     //----------------------------------------------------------------------------------------------------------------------
     void wheelEvent(const SDL_MouseWheelEvent &_event);
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to create the physics world
-    /// @param _gravityY is the strength of gravity in the Y direction read from the config file
-    /// @param _friction is the strength of the friction read from the config file
+    /// @brief method to render text
+    /// @param _text string of text to render
     //----------------------------------------------------------------------------------------------------------------------
-    void setPhysics(int _gravityY, float _friction);
+    void text(std::string _text);
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to rotate down in the x direction
-    /// @param angleUpdate is the amount to increase the angle of rotation by each time
+    /// @brief set the game state (start/game/win/lose)
+    /// @param _state what state game should be set to
     //----------------------------------------------------------------------------------------------------------------------
-    void rotateMazeXDOWN(float angleUpdate);
+    inline void setGameState(int const _state) {m_state = _state; m_dirty=true;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to rotate right in the z direction
-    /// @param angleUpdate is the amount to increase the angle of rotation by each time
+    /// @brief get what state the game is in (start/game/win/lose)
+    /// @param _state what state the game is in
     //----------------------------------------------------------------------------------------------------------------------
-    void rotateMazeZRIGHT(float angleUpdate);
+    inline int getGameState() const {return m_state;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to rotate up in the x direction
-    /// @param angleUpdate is the amount to increase the angle of rotation by each time
+    /// @brief show / hide the performance HUD
     //----------------------------------------------------------------------------------------------------------------------
-    void rotateMazeXUP(float angleUpdate);
+    inline void toggleHud() {m_showHud=!m_showHud; m_dirty=true;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to rotate left in the z direction
-    /// @param angleUpdate is the amount to increase the angle of rotation by each time
+    /// @brief returns true if the performance HUD is showing
     //----------------------------------------------------------------------------------------------------------------------
-    void rotateMazeZLEFT(float angleUpdate);
+    inline bool getShowHud() const {return m_showHud;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to test if player has lost (returns true or false)
-    /// @param _friction is the strength of the friction read from the config file
+    /// @brief returns true if something changed since the last draw, the menu and result screens are
+    /// static so main only redraws them when this is set
     //----------------------------------------------------------------------------------------------------------------------
-    bool lose(float _friction);
+    inline bool needsRedraw() const {return m_dirty;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to test if player has won (returns true or false)
-    /// @param _friction is the strength of the friction read from the config file
+    /// @brief ask for a redraw on the next frame (for GL state changed outside NGLDraw)
     //----------------------------------------------------------------------------------------------------------------------
-    bool win(float _friction);
+    inline void setDirty() {m_dirty=true;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to render text
-    /// @param _text string of text to render
+    /// @brief return the performance counters, the render loop adds the frame times as it owns the swap
     //----------------------------------------------------------------------------------------------------------------------
-    void text(std::string _text);
+    inline PerfStats &getPerfStats() {return m_stats;}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to create more balls
-    /// @param _friction is the strength of the friction read from the config file
+    /// @brief returns the matrix taking world positions to clip space for the last frame drawn, the
+    /// simulation uses it to tell which balls are out of view
     //----------------------------------------------------------------------------------------------------------------------
-    void createball(float _friction);
+    inline ngl::Mat4 getViewProjection() {return m_mouseGlobalTX*m_cam->getVPMatrix();}
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief set the game state (start/game/win/lose)
-    /// @param _state what state game should be set to
+    /// @brief create a framebuffer object to render into instead of the window, used for headless runs
+    /// where there is no default framebuffer
+    /// @param _w width of the target
+    /// @param _h height of the target
+    /// @returns false if the framebuffer is incomplete
     //----------------------------------------------------------------------------------------------------------------------
-    inline void setGameState(int const _state) {m_state = _state;}
+    bool createOffscreen(int _w, int _h);
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief get what state the game is in (start/game/win/lose)
-    /// @param _state what state the game is in
+    /// @brief returns a FNV-1a hash of the pixels of the last frame drawn, when drawing to a window
+    /// call it before the buffers are swapped
     //----------------------------------------------------------------------------------------------------------------------
-    inline int getGameState() const {return m_state;}
+    unsigned int frameHash();
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief return physics world
+    /// @brief write the last frame drawn to a binary PPM image, before the swap as for frameHash
+    /// @param _fileName the image to write
+    /// @returns false if the file couldn't be written
     //----------------------------------------------------------------------------------------------------------------------
-    inline PhysicsWorld *getPhysicsWorld(){return m_physics;}
+    bool writeFrame(const std::string &_fileName);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief render the 3D scene into a target of its own whose resolution and MSAA level are lowered
+    /// when the GPU time of a frame goes over the budget (and raised again when there is room), the
+    /// scene is then scaled up into the window and the text drawn on top at full resolution
+    /// @param _ms GPU time budget for a frame in ms, 0 to draw straight into the window
+    //----------------------------------------------------------------------------------------------------------------------
+    void setFrameBudget(float _ms);
 
 protected :
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief method to load transform data to the shaders
+    /// @param[in] _program the phong program to load them into, one of its variants
+    /// @param[in] _use false when the program is already in use
     //----------------------------------------------------------------------------------------------------------------------
-    void loadMatricesToPhongShader();
+    void loadMatricesToPhongShader(const std::string &_program="Phong", bool _use=true);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief method to load transform data to the shaders
+    /// @param[in] _use false when the program is already in use
+    //----------------------------------------------------------------------------------------------------------------------
+    void loadMatricesToTextureShader(bool _use=true);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief method to draw the performance HUD
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawHud();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns approximate bytes used by a mesh for the asset memory counters
+    /// @param _mesh the mesh to measure
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned long meshBytes(ngl::Obj *_mesh);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief put a generated mesh on the gpu laid out as the texture shader expects
+    /// @param _vertices _indices the mesh
+    //----------------------------------------------------------------------------------------------------------------------
+    static ngl::VertexArrayObject *createMazeVAO(const std::vector <MazeVertex> &_vertices, const std::vector <unsigned int> &_indices);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the chunks of a streamed maze that are in view, with the texture shader already
+    /// loaded. Chunks are put on the gpu the first time they are seen and dropped once they haven't
+    /// been seen for a couple of seconds, only the chunks within the camera's far plane are tested
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawMazeChunks();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief take whichever maze we are drawing off the gpu
+    //----------------------------------------------------------------------------------------------------------------------
+    void freeMaze();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a body waiting to be drawn, key says which shader, material and mesh it draws with
+    //----------------------------------------------------------------------------------------------------------------------
+    typedef struct
+    {
+      unsigned int key;
+      unsigned int body;
+    }DrawItem;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief comparison for sorting the draw queue
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool drawBefore(const DrawItem &_a, const DrawItem &_b);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fill the draw queue with the bodies whose bullet boxes are in view, sorted so that
+    /// the ones sharing a shader, material and mesh are together
+    /// @param _snapshot the bodies
+    //----------------------------------------------------------------------------------------------------------------------
+    void queueBodies(const Snapshot &_snapshot);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the queue, only changing the shader, material and mesh when the next body needs
+    /// something different
+    /// @param _snapshot the bodies the queue points at
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawQueue(const Snapshot &_snapshot);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read the pixels of the last frame drawn (RGB, bottom row first)
+    /// @param o_pixels the pixels
+    //----------------------------------------------------------------------------------------------------------------------
+    void readFrame(std::vector <unsigned char> &o_pixels);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief (re)allocate the renderbuffers of a framebuffer, creating it the first time
+    /// @param io_fbo the framebuffer, 0 to create one
+    /// @param io_buffers colour and depth renderbuffers of the framebuffer
+    /// @param _w width of the target
+    /// @param _h height of the target
+    /// @param _samples MSAA samples, 0 for none
+    /// @param _depth if the target needs a depth buffer
+    /// @returns false if the framebuffer is incomplete
+    //----------------------------------------------------------------------------------------------------------------------
+    bool createTarget(GLuint &io_fbo, GLuint *io_buffers, int _w, int _h, int _samples, bool _depth);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief size the scene targets for the window and the current quality level
+    //----------------------------------------------------------------------------------------------------------------------
+    void createSceneTargets();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read back the GPU time of an earlier frame and move the quality level up or down
+    //----------------------------------------------------------------------------------------------------------------------
+    void adaptResolution();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief resolve and scale the scene into the window (or offscreen target) ready for the text
     //----------------------------------------------------------------------------------------------------------------------
-    void loadMatricesToTextureShader();
+    void compositeScene();
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief used to store the x rotation mouse value
     //----------------------------------------------------------------------------------------------------------------------
@@ -195,10 +296,6 @@ protected :
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Light *m_light;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief physics world
-    //----------------------------------------------------------------------------------------------------------------------
-    PhysicsWorld *m_physics;
-    //----------------------------------------------------------------------------------------------------------------------
     /// @brief trasnform of body
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Mat4 m_bodyTransform;
@@ -207,14 +304,59 @@ protected :
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Obj *m_sphereMesh;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief maze obj mesh
+    /// @brief maze obj mesh, 0 when the maze is generated
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Obj *m_mazeMesh;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief indexed mesh of a generated maze and the bytes it holds, 0 when the maze is the obj
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::VertexArrayObject *m_mazeVAO;
+    unsigned long m_mazeVAOBytes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a chunk of a streamed maze on the gpu, its bytes and the frame it was last drawn
+    //----------------------------------------------------------------------------------------------------------------------
+    typedef struct
+    {
+      ngl::VertexArrayObject *vao;
+      unsigned long bytes;
+      unsigned long lastDrawn;
+    }DrawChunk;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a streamed maze and its chunks on the gpu, m_streamMaze is 0 when the maze is held whole
+    //----------------------------------------------------------------------------------------------------------------------
+    const MazeGenerator *m_streamMaze;
+    std::map <unsigned int,DrawChunk> m_drawChunks;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the view of the maze, set each frame for culling its chunks
+    //----------------------------------------------------------------------------------------------------------------------
+    Frustum m_frustum;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the view of the world for culling bodies and the bodies left to draw, kept to save
+    /// allocating the queue each frame
+    //----------------------------------------------------------------------------------------------------------------------
+    Frustum m_viewFrustum;
+    std::vector <DrawItem> m_drawQueue;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames drawn so far
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned long m_frame;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief cube obj mesh
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Obj *m_cube;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sphere mesh for the party balls, drawn once for all of them with an offset for each
+    /// read from m_swarmVBO
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Obj *m_swarmMesh;
+    GLuint m_swarmVBO;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the phong variant each mesh is drawn with, indexed by the mesh in a draw key, and the
+    /// variant for the party balls
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_meshVariants[3];
+    unsigned int m_swarmVariant;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief larger text for titles
     //----------------------------------------------------------------------------------------------------------------------
     Text *m_text;
@@ -231,21 +373,82 @@ protected :
     //----------------------------------------------------------------------------------------------------------------------
     int m_state;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief if player has lost
+    /// @brief texture for the maze
     //----------------------------------------------------------------------------------------------------------------------
-    bool m_lost;
+    unsigned int m_mazeTexture;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief if player has won
+    /// @brief small text for the performance HUD
     //----------------------------------------------------------------------------------------------------------------------
-    bool m_win;
+    Text *m_hudText;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief texture for the maze
+    /// @brief if the performance HUD is shown
     //----------------------------------------------------------------------------------------------------------------------
-    unsigned int m_mazeTexture;
+    bool m_showHud;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief performance counters shown in the HUD
+    //----------------------------------------------------------------------------------------------------------------------
+    PerfStats m_stats;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of mesh draw calls this frame
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_drawCalls;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief offscreen framebuffer, 0 when drawing to the window
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_offscreenFBO;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief colour and depth renderbuffers for the offscreen framebuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_offscreenBuffers[2];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief current viewport size
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_width;
+    int m_height;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set when the view, state or window changes, cleared by draw
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_dirty;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief last simulation tick whose step time went into the stats
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned long m_lastTick;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief GPU time budget for a frame in ms, 0 when the scene is drawn straight to the window
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_frameBudget;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief framebuffer the scene is drawn into and its colour and depth renderbuffers
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_sceneFBO;
+    GLuint m_sceneBuffers[2];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief single sampled copy of the scene, a multisampled buffer can't be scaled as it is resolved
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_resolveFBO;
+    GLuint m_resolveBuffers[2];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief size and MSAA samples of the scene targets
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_sceneWidth;
+    int m_sceneHeight;
+    int m_sceneSamples;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief current quality level, 0 is full resolution with 4x MSAA
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_quality;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames in a row over or comfortably under budget
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_overBudget;
+    int m_underBudget;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief vec3 to set gravity
+    /// @brief timer queries for the GPU time of the last two frames, results are read a frame late
+    /// so we never wait on the GPU
     //----------------------------------------------------------------------------------------------------------------------
-    ngl::Vec3 m_gravity;
+    GLuint m_gpuQueries[2];
+    bool m_queryPending[2];
+    int m_query;
 
 };
 
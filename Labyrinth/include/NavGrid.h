@@ -0,0 +1,150 @@
+#ifndef NAVGRID_H__
+#define NAVGRID_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NavGrid.h
+/// @brief 2D occupancy grid of a maze with a distance field to the goal, cached next to the obj
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <ngl/Vec3.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what is in a cell of the grid
+//----------------------------------------------------------------------------------------------------------------------
+enum NavCell
+{
+  NAV_FLOOR=0,
+  NAV_WALL,
+  NAV_HOLE,
+  NAV_GOAL
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief distance of a cell the goal can't be reached from
+//----------------------------------------------------------------------------------------------------------------------
+const static uint32_t NAV_UNREACHABLE=0xffffffff;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class NavGrid "include/NavGrid.h"
+/// @brief Class that rasterizes a maze obj into a grid over its x / z plane in the maze's own
+/// space. Each cell is floor, wall or hole from the highest upward facing triangle above it, and
+/// floor over the goal's footprint is the goal. A distance to the goal is worked out for every
+/// floor cell, costing more near walls and holes so the path keeps the ball clear of them, along
+/// with the neighbour to head for, so following the field is a single lookup. Building it is the
+/// slow part so the result is saved next to the obj and reused until the obj changes.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class NavGrid
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the grid is empty until built or loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  NavGrid();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load the cached grid for a maze, or build it and write the cache if there is none or it
+  /// is out of date
+  /// @param[in] _objFile the maze obj, the cache is this with .nav added
+  /// @param[in] _goalMin _goalMax bounds of the goal in the maze's space, only x and z are used
+  /// @returns false if the obj couldn't be read
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadOrBuild(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rasterize a maze obj and work out the distance field
+  /// @param[in] _objFile the maze obj
+  /// @param[in] _goalMin _goalMax bounds of the goal in the maze's space, only x and z are used
+  /// @returns false if the obj couldn't be read or has no triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rasterize a maze made in memory (see MazeGenerator), it has no key so isn't cached
+  /// @param[in] _triangles corners of the maze's triangles in threes, in the maze's space
+  /// @param[in] _goalMin _goalMax bounds of the goal in the maze's space, only x and z are used
+  /// @returns false if there are no triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::vector <ngl::Vec3> &_triangles, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the grid to a file
+  //----------------------------------------------------------------------------------------------------------------------
+  bool save(const std::string &_file) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read a grid written by save
+  /// @param[in] _file the file
+  /// @param[in] _key key the grid must have been built with, 0 to take any
+  /// @returns false if it couldn't be read or was built from something else
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(const std::string &_file, uint32_t _key=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the goal can be reached from a point
+  /// @param[in] _local point in the maze's space
+  //----------------------------------------------------------------------------------------------------------------------
+  bool reachable(const ngl::Vec3 &_local) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the way to go to reach the goal from a point
+  /// @param[in] _local point in the maze's space
+  /// @param[out] o_x o_z unit direction in the maze's space
+  /// @returns false if there is no way from here (off the grid, in a wall or on the goal)
+  //----------------------------------------------------------------------------------------------------------------------
+  bool getDirection(const ngl::Vec3 &_local, float &o_x, float &o_z) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the cost to the goal from a point, NAV_UNREACHABLE if there is no way
+  /// @param[in] _local point in the maze's space
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t getDistance(const ngl::Vec3 &_local) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the cell at a grid position
+  //----------------------------------------------------------------------------------------------------------------------
+  inline NavCell getCell(unsigned int _x, unsigned int _z) const {return NavCell(m_cells[_z*m_width+_x]);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the size of the grid in cells
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getWidth() const {return m_width;}
+  inline unsigned int getDepth() const {return m_depth;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the grid has been built or loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isValid() const {return m_width>0;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the key of a build from the obj's contents and the build settings
+  //----------------------------------------------------------------------------------------------------------------------
+  static uint32_t makeKey(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the index of the cell a point is in, -1 if it is off the grid
+  //----------------------------------------------------------------------------------------------------------------------
+  int cellIndex(const ngl::Vec3 &_local) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the distance and direction of every cell from the goal cells
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildField();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief key of the obj and settings the grid was built from
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t m_key;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief size of the grid in cells and the x / z of the corner of cell 0
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_width;
+  unsigned int m_depth;
+  float m_originX;
+  float m_originZ;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief NavCell of each cell, row by row along x
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <uint8_t> m_cells;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief cost to the goal from each cell
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <uint32_t> m_distance;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief neighbour of each cell to head for (0-7), -1 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <int8_t> m_direction;
+};
+
+#endif
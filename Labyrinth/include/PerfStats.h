@@ -0,0 +1,219 @@
+#ifndef PERFSTATS_H__
+#define PERFSTATS_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PerfStats.h
+/// @brief rolling performance counters and fixed bucket histograms used by the in game HUD
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class PerfHistogram "include/PerfStats.h"
+/// @brief fixed bucket histogram over a rolling window of samples, the oldest sample is
+/// removed from its bucket as a new one is added so percentiles are always for the last
+/// window of samples and adding a sample never allocates
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class PerfHistogram
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _bucketWidth the width of each bucket (in ms for the timers)
+  /// @param[in] _numBuckets number of buckets, anything past the last bucket is clamped into it, at least 1
+  /// @param[in] _window how many of the most recent samples the percentiles cover, at least 1
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram(float _bucketWidth, unsigned int _numBuckets, unsigned int _window);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a sample replacing the oldest one once the window is full
+  /// @param[in] _value the value to add
+  //----------------------------------------------------------------------------------------------------------------------
+  void addSample(float _value);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the upper edge of the bucket containing the requested percentile
+  /// @param[in] _p the percentile wanted in the range 0-100
+  //----------------------------------------------------------------------------------------------------------------------
+  float percentile(float _p) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief remove all samples
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the last sample added
+  //----------------------------------------------------------------------------------------------------------------------
+  inline float getLast() const {return m_last;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns number of samples currently in the window
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getCount() const {return m_count;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns number of buckets
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumBuckets() const {return m_buckets.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the count in a bucket
+  /// @param[in] _index the bucket
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getBucket(unsigned int _index) const {return m_buckets[_index];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the width of a bucket
+  //----------------------------------------------------------------------------------------------------------------------
+  inline float getBucketWidth() const {return m_bucketWidth;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief width of each bucket
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_bucketWidth;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sample count per bucket
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <unsigned int> m_buckets;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ring buffer of the bucket each sample in the window went into
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <unsigned int> m_window;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief next slot to write in the ring buffer
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_head;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of samples in the window
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_count;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the last sample added
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_last;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief categories for the resident asset memory counters
+//----------------------------------------------------------------------------------------------------------------------
+enum AssetCategory
+{
+  ASSET_MESH=0,
+  ASSET_TEXTURE,
+  ASSET_FONT,
+  ASSET_COLLISION,
+  ASSET_CATEGORIES
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief counters gathered each frame for the performance HUD and the metrics export
+//----------------------------------------------------------------------------------------------------------------------
+
+struct PerfStats
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, 0.1ms buckets up to 100ms over the last 600 frames (10 seconds at 60Hz)
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfStats();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief whole frame time in ms (from swap to swap)
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram frameTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief time spent in PhysicsWorld::step in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram stepTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief input to photon latency in ms, from the input being sampled to the first frame showing
+  /// it being swapped. Only filled in when measuring latency (--latency)
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram inputLatency;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GPU time of NGLDraw::draw in ms, only measured when dynamic resolution is on
+  //----------------------------------------------------------------------------------------------------------------------
+  PerfHistogram gpuTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of substeps bullet took in the last step
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int substeps;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of awake dynamic bodies
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int activeBodies;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of dynamic bodies asleep
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int sleepingBodies;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of simulation islands with awake bodies
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int islands;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of contact points in all manifolds
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int contacts;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of pairs the broadphase found overlapping after collision filtering
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int broadphasePairs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of pairs the narrowphase is tracking
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int manifolds;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of party balls and the contacts they resolved, solved outside bullet so not in the counts above
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int partyBalls;
+  unsigned int partyContacts;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief chunks of a streamed maze, how many collide and how many were drawn last frame
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int mazeChunks;
+  unsigned int residentChunks;
+  unsigned int drawnChunks;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bodies drawn and culled as out of view last frame, and the shader, material and mesh
+  /// changes made drawing them
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int drawnBodies;
+  unsigned int culledBodies;
+  unsigned int stateChanges;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of draw calls issued in the last frame (meshes and text glyphs)
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int drawCalls;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fraction of the window resolution the scene is drawn at
+  //----------------------------------------------------------------------------------------------------------------------
+  float renderScale;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief MSAA samples the scene is drawn with, 0 when it uses the window's own
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int msaaSamples;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how much physics work the step governor is shedding (a GovernorLevel)
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int governorLevel;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief total frames swapped
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long frames;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief total calls to PhysicsWorld::step
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long physicsSteps;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief total substeps over all the steps
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long totalSubsteps;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief games won
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int wins;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief games lost
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int losses;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief approximate resident bytes per asset category, filled in as assets are loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long assetBytes[ASSET_CATEGORIES];
+};
+
+#endif
@@ -7,11 +7,61 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 #include <vector>
+#include <string>
 #include <btBulletDynamicsCommon.h>
+#include "MaterialTable.h"
+#include "BallSwarm.h"
 #include <ngl/Vec3.h>
 #include <ngl/Mat4.h>
 #include <ngl/Obj.h>
 
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief collision groups, each kind of body only collides with the groups in its mask so the
+/// ground, maze and goal never make pairs with each other
+//----------------------------------------------------------------------------------------------------------------------
+enum CollisionGroup
+{
+  COL_GROUND=1<<0,
+  COL_MAZE=1<<1,
+  COL_GOAL=1<<2,
+  COL_BALL=1<<3
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief broadphase algorithms. The axis sweeps need the world bounds up front but can be faster
+/// than the dbvt when lots of balls are packed into the maze
+//----------------------------------------------------------------------------------------------------------------------
+enum BroadphaseType
+{
+  BROADPHASE_DBVT=0,
+  BROADPHASE_SWEEP,
+  BROADPHASE_SWEEP32,
+  BROADPHASE_TYPES
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief state of one body saved by PhysicsWorld::saveState
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  // kind of body, restoring checks the bodies still line up
+  std::string name;
+  btTransform transform;
+  btVector3 linearVelocity;
+  btVector3 angularVelocity;
+  int activation;
+  bool parked;
+}SavedBody;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief state of a whole world, used to put it back to an earlier step
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  std::vector <SavedBody> bodies;
+  unsigned int stillTicks;
+}SavedWorld;
+
 //----------------------------------------------------------------------------------------------------------------------
 /// @class PhysicsWorld "include/PhysicsWorld.h"
 /// @brief Class to set physics for the world an objects to be used in NGLDRaw
@@ -26,8 +76,12 @@ class PhysicsWorld
 public :
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief ctor, this should really be a singleton as we have quite a few static members and only one world
+    /// @param[in] broadphase algorithm to use
+    /// @param[in] lower corner of the world for the axis sweeps, bodies outside still work but slowly
+    /// @param[in] upper corner of the world for the axis sweeps
     //----------------------------------------------------------------------------------------------------------------------
-    PhysicsWorld();
+    PhysicsWorld(BroadphaseType _broadphase=BROADPHASE_DBVT, const ngl::Vec3 &_worldMin=ngl::Vec3(-100,-100,-100),
+                 const ngl::Vec3 &_worldMax=ngl::Vec3(100,100,100));
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief dtor
     //----------------------------------------------------------------------------------------------------------------------
@@ -73,8 +127,9 @@ public :
     /// @param[in] shape name as a string
     /// @param[in] position as vec3 (x,y,z)
     /// @param[in] friction (read from config file)
+    /// @param[in] surface material (see MaterialTable.h)
     //----------------------------------------------------------------------------------------------------------------------
-    void addMaze(std::string _shapeName,const ngl::Vec3 &_pos, float _friction);
+    void addMaze(std::string _shapeName,const ngl::Vec3 &_pos, float _friction, int _material=MATERIAL_WOOD);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief physics for the ball
     /// @param[in] shape name as a string
@@ -89,11 +144,22 @@ public :
     //----------------------------------------------------------------------------------------------------------------------
     void addCube(std::string _shapeName, const ngl::Vec3 &_pos);
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief to step through the simulation
+    /// @brief to step through the simulation, the step is split into just enough substeps that the
+    /// fastest body moves no further than the max displacement in each one
     /// @param[in] amount of time to step simulation by as a float (default 1/60th of asecond)
-    /// @param[in] amount of time steps
+    /// @param[in] most substeps to split the step into
+    /// @returns the number of substeps taken
+    //----------------------------------------------------------------------------------------------------------------------
+    int step(float _time, int _maxSubsteps);
     //----------------------------------------------------------------------------------------------------------------------
-    void step(float _time, float _step);
+    /// @brief set how far the fastest body may move in one substep before the step is split
+    /// @param[in] distance, 0 to never split steps
+    //----------------------------------------------------------------------------------------------------------------------
+    inline void setMaxDisplacement(float _distance) {m_maxDisplacement=_distance;}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the speed of the fastest awake dynamic body
+    //----------------------------------------------------------------------------------------------------------------------
+    float getMaxSpeed() const;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief user pointer
     /// @param[in] number of collision object in array
@@ -123,6 +189,12 @@ public :
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Mat4 getTransformMatrix(unsigned int _index);
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief get the world space box round a body, as the broadphase last saw it
+    /// @param[in] number of the specific collision object within array
+    /// @param[out] o_min o_max corners of the box
+    //----------------------------------------------------------------------------------------------------------------------
+    void getAabb(unsigned int _index, ngl::Vec3 &o_min, ngl::Vec3 &o_max) const;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief get collision shape for specific body
     /// @param[in] number of specific collision object in array
     //----------------------------------------------------------------------------------------------------------------------
@@ -145,6 +217,139 @@ public :
     //----------------------------------------------------------------------------------------------------------------------
     btQuaternion getRotation(unsigned int _index);
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief tilt the maze (and the goal cube with it) about the world x and z axes, call every tick
+    /// so the maze can be put to sleep once it stops moving
+    /// @param[in] angle to rotate about x by
+    /// @param[in] angle to rotate about z by
+    //----------------------------------------------------------------------------------------------------------------------
+    void tilt(float _angleX, float _angleZ);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief count the dynamic bodies in one pass over them
+    /// @param[out] o_active number of bodies that are awake
+    /// @param[out] o_sleeping number of bodies that are asleep
+    /// @param[out] o_islands number of simulation islands with awake bodies in them at the last step
+    //----------------------------------------------------------------------------------------------------------------------
+    void countBodies(unsigned int &o_active, unsigned int &o_sleeping, unsigned int &o_islands) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the linear velocity of a body
+    /// @param[in] number of the rigid body in vector of bodies (m_bodies)
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Vec3 getLinearVelocity(unsigned int _index) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief save the transform, velocity and sleep state of every body
+    /// @param[out] o_state the saved state
+    //----------------------------------------------------------------------------------------------------------------------
+    void saveState(SavedWorld &o_state) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief put every body back as it was when saved and drop the cached contacts, so stepping
+    /// on from here does the same as stepping on from the save did
+    /// @param[in] _state state from saveState of this world or one built the same way
+    /// @returns false if the bodies don't match the ones saved (nothing is changed)
+    //----------------------------------------------------------------------------------------------------------------------
+    bool restoreState(const SavedWorld &_state);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns number of contact points over all the contact manifolds
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int getNumContacts() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns number of pairs the broadphase found overlapping
+    //----------------------------------------------------------------------------------------------------------------------
+    inline unsigned int getNumBroadphasePairs() const
+    {
+      return m_overlappingPairCache->getOverlappingPairCache()->getNumOverlappingPairs();
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns number of pairs the narrowphase is tracking (one contact manifold each)
+    //----------------------------------------------------------------------------------------------------------------------
+    inline unsigned int getNumManifolds() const
+    {
+      return m_dispatcher->getNumManifolds();
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set whether balls collide with each other, balls already in the world are refiltered
+    /// @param[in] true for balls to collide
+    //----------------------------------------------------------------------------------------------------------------------
+    void setBallsCollide(bool _collide);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns true if balls collide with each other
+    //----------------------------------------------------------------------------------------------------------------------
+    inline bool getBallsCollide() const {return m_ballsCollide;}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns false once the broadphase can't take any more bodies (the axis sweeps have a
+    /// fixed number of handles)
+    //----------------------------------------------------------------------------------------------------------------------
+    inline bool canAddBody() const {return m_bodies.size()<m_maxBodies;}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief swap the broadphase for another, the bodies in the world are moved across to it. There
+    /// must be no more bodies than the new broadphase can hold
+    /// @param[in] broadphase algorithm to use
+    /// @param[in] _worldMin _worldMax bounds for the axis sweeps, see mazeBounds
+    //----------------------------------------------------------------------------------------------------------------------
+    void setBroadphase(BroadphaseType _broadphase, const ngl::Vec3 &_worldMin, const ngl::Vec3 &_worldMax);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the broadphase in use
+    //----------------------------------------------------------------------------------------------------------------------
+    inline BroadphaseType getBroadphase() const {return m_broadphase;}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief work out world bounds from a maze shape, big enough to hold it however it is tilted
+    /// along with the ground plane below it and the balls dropped in from above
+    /// @param[in] the maze collision shape
+    /// @param[in] position the maze is added at
+    /// @param[out] lower corner of the world
+    /// @param[out] upper corner of the world
+    //----------------------------------------------------------------------------------------------------------------------
+    static void mazeBounds(btCollisionShape *_maze, const ngl::Vec3 &_pos, ngl::Vec3 &o_min, ngl::Vec3 &o_max);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the name of a broadphase as used in the config file (dbvt, sweep, sweep32)
+    /// @param[in] the broadphase
+    //----------------------------------------------------------------------------------------------------------------------
+    static const char *broadphaseName(BroadphaseType _broadphase);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief look up a broadphase from its name
+    /// @param[in] the name
+    /// @param[out] the broadphase
+    /// @returns false if the name isn't known
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool broadphaseFromName(const std::string &_name, BroadphaseType &o_broadphase);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set how many iterations the constraint solver takes each substep
+    /// @param[in] number of iterations (bullet's default is 10)
+    //----------------------------------------------------------------------------------------------------------------------
+    inline void setSolverIterations(int _iterations)
+    {
+      m_dynamicsWorld->getSolverInfo().m_numIterations=_iterations;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief stop simulating a body until it is unparked, or wake one we parked. Nothing wakes a
+    /// parked body, not even the tilting maze it lies on
+    /// @param[in] number of the rigid body in vector of bodies (m_bodies)
+    /// @param[in] true to park the body, false to wake it
+    //----------------------------------------------------------------------------------------------------------------------
+    void setParked(unsigned int _index, bool _parked);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief change the surface material of a body
+    /// @param[in] number of the rigid body in vector of bodies (m_bodies)
+    /// @param[in] the material (see MaterialTable.h)
+    //----------------------------------------------------------------------------------------------------------------------
+    void setBodyMaterial(unsigned int _index, int _material);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the surface material of a body
+    /// @param[in] number of the rigid body in vector of bodies (m_bodies)
+    //----------------------------------------------------------------------------------------------------------------------
+    inline int getBodyMaterial(unsigned int _index) const {return m_bodies[_index].body->getUserIndex();}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief turn party mode on or off. The party balls are a BallSwarm stepped after the bodies in
+    /// bullet, dropped over the maze (found by name) and sized like the "ball" shape. They roll on the
+    /// maze's distance field and are pushed about by the balls in bullet without pushing back
+    /// @param[in] number of party balls, 0 to turn party mode off
+    /// @param[in] distance field of the maze, not owned and must outlive the swarm
+    //----------------------------------------------------------------------------------------------------------------------
+    void setSwarm(unsigned int _balls, const MazeSdf *_sdf);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the party balls, 0 when party mode is off
+    //----------------------------------------------------------------------------------------------------------------------
+    inline const BallSwarm *getSwarm() const {return m_swarm;}
+    //----------------------------------------------------------------------------------------------------------------------
 
 protected :
     //----------------------------------------------------------------------------------------------------------------------
@@ -154,6 +359,8 @@ protected :
     {
       std::string name;
       btRigidBody* body;
+      // simulation switched off by setParked
+      bool parked;
     }Body;
 
     //----------------------------------------------------------------------------------------------------------------------
@@ -164,8 +371,51 @@ protected :
     btBroadphaseInterface* m_overlappingPairCache ;
     btSequentialImpulseConstraintSolver* m_solver;
     btDiscreteDynamicsWorld* m_dynamicsWorld;
+    btCollisionAlgorithmCreateFunc* m_sdfCreateFunc;
+    btCollisionAlgorithmCreateFunc* m_sdfSwappedCreateFunc;
     btCollisionShape* m_groundShape;
     std::vector <Body> m_bodies;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief furthest the fastest body may move in a substep, 0 to never split steps
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_maxDisplacement;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief if balls collide with each other
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_ballsCollide;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ticks since the maze was last tilted
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_stillTicks;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief islands countBodies has seen, kept so counting doesn't allocate, mutable as it is const
+    //----------------------------------------------------------------------------------------------------------------------
+    mutable std::vector <unsigned char> m_islandSeen;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief broadphase in use and the most bodies it can hold
+    //----------------------------------------------------------------------------------------------------------------------
+    BroadphaseType m_broadphase;
+    unsigned int m_maxBodies;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief party balls, 0 when party mode is off
+    //----------------------------------------------------------------------------------------------------------------------
+    BallSwarm *m_swarm;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief move the party balls on by a step, with the maze and balls where bullet left them
+    /// @param[in] length of the step
+    //----------------------------------------------------------------------------------------------------------------------
+    void stepSwarm(float _time);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make the broadphase into m_overlappingPairCache and set m_broadphase and m_maxBodies
+    //----------------------------------------------------------------------------------------------------------------------
+    void createBroadphase(BroadphaseType _broadphase, const ngl::Vec3 &_worldMin, const ngl::Vec3 &_worldMax);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returns the mask for balls
+    //----------------------------------------------------------------------------------------------------------------------
+    inline short ballMask() const
+    {
+      return COL_GROUND | COL_MAZE | COL_GOAL | (m_ballsCollide ? COL_BALL : 0);
+    }
 };
 
 #endif
@@ -0,0 +1,128 @@
+#ifndef SDFCOLLISION_H__
+#define SDFCOLLISION_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SdfCollision.h
+/// @brief bullet shape and collision algorithm for balls against a maze's signed distance field
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btActivatingCollisionAlgorithm.h>
+#include "MazeSdf.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MazeSdfShape "include/SdfCollision.h"
+/// @brief Class that stands in for a maze's triangle mesh with its distance field. Balls against it
+/// go to SdfCollisionAlgorithm, everything else (bounds, ray casts and the swept sphere tests of
+/// continuous collision) is passed on to the mesh, so it is a custom concave shape to bullet.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class MazeSdfShape : public btConcaveShape
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _sdf field of the maze, owned by the shape from now on
+  /// @param[in] _mesh triangle mesh of the same maze, not owned
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeSdfShape(MazeSdf *_sdf, btBvhTriangleMeshShape *_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor deletes the field
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual ~MazeSdfShape();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the field
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const MazeSdf *getSdf() const {return m_sdf;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  inline btBvhTriangleMeshShape *getMesh() const {return m_mesh;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief btCollisionShape / btConcaveShape interface, passed on to the mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual void getAabb(const btTransform &_t, btVector3 &o_aabbMin, btVector3 &o_aabbMax) const;
+  virtual void processAllTriangles(btTriangleCallback *_callback, const btVector3 &_aabbMin, const btVector3 &_aabbMax) const;
+  virtual void calculateLocalInertia(btScalar _mass, btVector3 &o_inertia) const;
+  virtual void setLocalScaling(const btVector3 &_scaling);
+  virtual const btVector3 &getLocalScaling() const;
+  virtual const char *getName() const {return "MazeSdf";}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the field and the mesh it was made from
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeSdf *m_sdf;
+  btBvhTriangleMeshShape *m_mesh;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SdfCollisionAlgorithm "include/SdfCollision.h"
+/// @brief Class that collides a ball (sphere or hull of a sphere) with a MazeSdfShape. The ball's
+/// centre is taken into the maze's space and the field is sampled there once, the distance less
+/// the radius is the depth of the contact and the gradient its normal. Walls and floor meeting at a
+/// corner blend into one rounded contact rather than two, which is the price of the lookup.
+/// PhysicsWorld registers it with the dispatcher for both orders of the pair.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class SdfCollisionAlgorithm : public btActivatingCollisionAlgorithm
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, as bullet's algorithms
+  /// @param[in] _manifold manifold to use, 0 to make one
+  /// @param[in] _isSwapped true if the maze is the first of the pair
+  //----------------------------------------------------------------------------------------------------------------------
+  SdfCollisionAlgorithm(btPersistentManifold *_manifold, const btCollisionAlgorithmConstructionInfo &_info,
+                        const btCollisionObjectWrapper *_body0Wrap, const btCollisionObjectWrapper *_body1Wrap,
+                        bool _isSwapped);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor gives back the manifold if it was made here
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual ~SdfCollisionAlgorithm();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief btCollisionAlgorithm interface
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual void processCollision(const btCollisionObjectWrapper *_body0Wrap, const btCollisionObjectWrapper *_body1Wrap,
+                                const btDispatcherInfo &_dispatchInfo, btManifoldResult *o_result);
+  virtual btScalar calculateTimeOfImpact(btCollisionObject *_body0, btCollisionObject *_body1,
+                                         const btDispatcherInfo &_dispatchInfo, btManifoldResult *o_result);
+  virtual void getAllContactManifolds(btManifoldArray &o_manifolds);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the radius bullet collides a ball shape with, margin included
+  //----------------------------------------------------------------------------------------------------------------------
+  static btScalar ballRadius(const btCollisionShape *_shape);
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief makes the algorithm for the dispatcher
+  //----------------------------------------------------------------------------------------------------------------------
+  struct CreateFunc : public btCollisionAlgorithmCreateFunc
+  {
+    virtual btCollisionAlgorithm *CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo &_info,
+                                                           const btCollisionObjectWrapper *_body0Wrap,
+                                                           const btCollisionObjectWrapper *_body1Wrap)
+    {
+      void *mem=_info.m_dispatcher1->allocateCollisionAlgorithm(sizeof(SdfCollisionAlgorithm));
+      return new(mem) SdfCollisionAlgorithm(_info.m_manifold,_info,_body0Wrap,_body1Wrap,m_swapped);
+    }
+  };
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief manifold of the pair and whether it was made here
+  //----------------------------------------------------------------------------------------------------------------------
+  btPersistentManifold *m_manifold;
+  bool m_ownManifold;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the maze is the first of the pair
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_isSwapped;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief radius of the ball, worked out once as hulls have to be measured
+  //----------------------------------------------------------------------------------------------------------------------
+  btScalar m_radius;
+};
+
+#endif
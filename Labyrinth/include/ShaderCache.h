@@ -0,0 +1,107 @@
+#ifndef SHADERCACHE_H__
+#define SHADERCACHE_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ShaderCache.h
+/// @brief builds shader programs into ngl's ShaderLib, reading the linked binary from disk when it can
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <ngl/Types.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ShaderCache "include/ShaderCache.h"
+/// @brief Class that makes the game's shader programs. Each program is made in ngl's ShaderLib so it
+/// is used by name as before, but once it has been linked its binary is saved (glGetProgramBinary)
+/// and later runs hand the binary straight back to the driver (glProgramBinary) rather than
+/// compiling the glsl again, which is most of the time it takes to start under a software driver.
+/// The binaries are keyed on the driver's renderer and version strings and on a hash of the source,
+/// so a new driver or an edited shader is simply compiled again. Anything that goes wrong with a
+/// binary, including drivers that offer no binary formats, falls back to compiling the source.
+/// The same glsl can be built into several programs, variants, by giving each its own #defines;
+/// the defines are part of the source that is hashed so each variant has a binary of its own.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class ShaderCache
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, needs a current GL context to ask the driver who it is
+  /// @param[in] _dir directory the binaries are kept in, ending in a /
+  //----------------------------------------------------------------------------------------------------------------------
+  ShaderCache(const std::string &_dir="shaders/");
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make a program from a vertex and a fragment shader
+  /// @param[in] _name name of the program in the ShaderLib, also names its binary
+  /// @param[in] _vertex _fragment the glsl files
+  /// @param[in] _attributes names of the vertex attributes in location order, empty when the
+  /// shaders give their own locations
+  /// @param[in] _defines names #defined in both shaders, straight after their #version line
+  /// @returns false if the program couldn't be made
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::string &_name, const std::string &_vertex, const std::string &_fragment,
+             const std::vector <std::string> &_attributes,
+             const std::vector <std::string> &_defines=std::vector <std::string>());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of programs read from binaries and compiled from source
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getHits() const {return m_hits;}
+  inline unsigned int getMisses() const {return m_misses;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read a whole text file
+  /// @returns false if it couldn't be read
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool readFile(const std::string &_file, std::string &o_text);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief put #defines into some glsl after its #version line, which has to come first. A #line
+  /// follows them so the driver's errors still give the line in the file
+  //----------------------------------------------------------------------------------------------------------------------
+  static void addDefines(std::string &io_source, const std::vector <std::string> &_defines);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the key of a program, a hash of the driver, the source and the attribute locations
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t makeKey(const std::string &_vertex, const std::string &_fragment, const std::vector <std::string> &_attributes) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief give a program its binary from the cache
+  /// @returns false if there is no good binary, the program is left empty to compile into
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(GLuint _program, const std::string &_file, uint32_t _key) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write a linked program's binary to the cache
+  //----------------------------------------------------------------------------------------------------------------------
+  bool save(GLuint _program, const std::string &_file, uint32_t _key) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compile the source into a program and link it
+  /// @returns false with the log printed if it doesn't compile or link
+  //----------------------------------------------------------------------------------------------------------------------
+  bool compile(GLuint _program, const std::string &_name, const std::string &_vertex, const std::string &_fragment,
+               const std::vector <std::string> &_attributes) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compile one shader and attach it to the program, the program keeps it alive
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool attachShader(GLuint _program, GLenum _type, const std::string &_name, const std::string &_source);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief where the binaries go
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_dir;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the driver's renderer and version, part of every key
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_driver;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief false when the driver has no binary formats, everything is compiled
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_binaries;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief programs read from binaries and compiled so far
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_hits;
+  unsigned int m_misses;
+};
+
+#endif
@@ -0,0 +1,372 @@
+#ifndef SIMULATION_H__
+#define SIMULATION_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Simulation.h
+/// @brief runs the physics and game rules at a fixed rate, on its own thread or ticked by the caller
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <SDL.h>
+#include <vector>
+#include "Snapshot.h"
+#include "StepGovernor.h"
+#include "PhysicsWorld.h"
+#include "NavGrid.h"
+#include "Autopilot.h"
+#include "MazeGenerator.h"
+#include "MazeChunks.h"
+#include "LevelPack.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Simulation "include/Simulation.h"
+/// @brief Class that owns the PhysicsWorld and the game rules (tilting, spawning, win / lose).
+/// Input reaches it as commands queued from other threads and the result of each tick is written
+/// into a triple buffered Snapshot, so the renderer always has a complete state to draw and neither
+/// side ever waits for the other. Interactive games call start to run it on its own thread at 60Hz,
+/// benchmarks call tick once a frame so runs are repeatable. A StepGovernor sheds physics work when
+/// the steps go over budget. Generated mazes too big to hold whole are streamed, only the chunks
+/// near the balls collide (see MazeChunks). Levels from a LevelPack are handed over ready to play
+/// and swapped in between games.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class Simulation
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor loads the collision shapes and builds the world
+  /// @param[in] _gravityY strength of gravity read from the config file
+  /// @param[in] _friction friction read from the config file
+  /// @param[in] _broadphase broadphase read from the config file, the axis sweeps are sized to the maze
+  /// @param[in] _mazeSdf true to collide the ball with the maze's distance field rather than its triangles
+  /// @param[in] _mazeSeed seed of a generated maze to play, 0 for mazev3.obj
+  /// @param[in] _mazeCells cells along each side of a generated maze, 0 for about the size of mazev3.obj
+  //----------------------------------------------------------------------------------------------------------------------
+  Simulation(int _gravityY, float _friction, BroadphaseType _broadphase=BROADPHASE_DBVT, bool _mazeSdf=false,
+             unsigned int _mazeSeed=0, unsigned int _mazeCells=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor stops the thread if it is running
+  //----------------------------------------------------------------------------------------------------------------------
+  ~Simulation();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start ticking at 60Hz on a thread of our own
+  /// @returns false if the thread couldn't be created
+  //----------------------------------------------------------------------------------------------------------------------
+  bool start();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief stop the thread and wait for it to finish
+  //----------------------------------------------------------------------------------------------------------------------
+  void stop();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief apply the queued commands, step the world once and publish a snapshot. Called by the
+  /// thread, or directly when the caller wants to stay in lockstep with its frames
+  //----------------------------------------------------------------------------------------------------------------------
+  void tick();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the tilt speeds (radians per tick) applied while playing. With a timestamp the
+  /// tick the change lands in only tilts at the new speed for the part of the tick after it
+  /// @param[in] _time performance counter time the input was sampled, 0 to apply from the start of the next tick
+  //----------------------------------------------------------------------------------------------------------------------
+  void setTilt(float _up, float _down, float _left, float _right, Uint64 _time=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief drop another ball into the maze
+  /// @param[in] _time performance counter time the input was sampled, 0 if not from input
+  //----------------------------------------------------------------------------------------------------------------------
+  void addBall(Uint64 _time=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief change the game state (start/game/win/lose)
+  /// @param[in] _state what state game should be set to
+  /// @param[in] _time performance counter time the input was sampled, 0 if not from input
+  //----------------------------------------------------------------------------------------------------------------------
+  void setGameState(int _state, Uint64 _time=0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get what state the game is in, may be a tick behind commands just queued
+  //----------------------------------------------------------------------------------------------------------------------
+  inline int getGameState() {return SDL_AtomicGet(&m_state);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the newest published snapshot, only one thread may read snapshots and the
+  /// reference stays valid until the next call
+  //----------------------------------------------------------------------------------------------------------------------
+  const Snapshot &acquire();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief semaphore posted when the game state changes, lets an idle renderer sleep until then
+  /// @param[in] _wake the semaphore, 0 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setWake(SDL_sem *_wake) {m_wake=_wake;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the step time budget for the governor, call before start
+  /// @param[in] _ms step time budget in ms, 0 to never shed work
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setStepBudget(float _ms) {m_governor.setBudget(_ms);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set whether balls collide with each other, call before start
+  /// @param[in] _collide true for balls to collide
+  //----------------------------------------------------------------------------------------------------------------------
+  void setBallsCollide(bool _collide);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the surface the maze is made of, call before start
+  /// @param[in] _material the material (wood, ice or carpet)
+  //----------------------------------------------------------------------------------------------------------------------
+  void setMazeSurface(MaterialId _material);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief tell the simulation where the camera is looking so the governor can put balls out of
+  /// view to sleep, picked up at the next tick
+  /// @param[in] _viewProjection matrix taking world positions to clip space (row vectors as ngl uses)
+  //----------------------------------------------------------------------------------------------------------------------
+  void setView(const ngl::Mat4 &_viewProjection);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief let the Autopilot play, starting a new game a couple of seconds after each one ends,
+  /// for unattended soak and performance runs. Loads the maze's NavGrid (building and caching it
+  /// the first time), call before start
+  /// @param[in] _on true to play by itself
+  /// @returns false if it couldn't be turned on
+  //----------------------------------------------------------------------------------------------------------------------
+  bool setAutopilot(bool _on);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief party mode, fill the maze with balls solved by a BallSwarm rather than bullet. They roll
+  /// on the maze's distance field, the one the maze collides with if it has one, otherwise it is
+  /// loaded (or built and cached) the first time. Streamed mazes have no field so don't party
+  /// @param[in] _balls number of party balls, 0 to stop the party
+  //----------------------------------------------------------------------------------------------------------------------
+  void setParty(unsigned int _balls);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if the party is on or has been asked for, off again once a level is played
+  /// or if the maze can't party
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool getParty() {return SDL_AtomicGet(&m_party)!=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set whether snapshots carry the body, island and contact counts, they take passes over
+  /// the world each tick so are only counted while the HUD or metrics export shows them
+  /// @param[in] _count true to count them, off to leave them 0
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setCountBodies(bool _count) {SDL_AtomicSet(&m_countBodies,_count);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the generated maze, not valid when playing mazev3.obj. It doesn't change once
+  /// the simulation is made so the renderer can read it from its own thread, and build chunks of a
+  /// streamed one
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const MazeGenerator &getMaze() const {return m_maze;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief play a level from a LevelPack, picked up at the next tick which puts the maze, ball and
+  /// goal back to the level's start and turns the party off. We own the level from here on, the
+  /// renderer should take what it needs from it before handing it over
+  /// @param[in] _level the prepared level
+  /// @param[in] _index the level's place in the pack, published in the snapshots once it is in play
+  //----------------------------------------------------------------------------------------------------------------------
+  void setLevel(Level *_level, int _index);
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a queued command
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    //0 tilt, 1 ball, 2 game state, 3 party balls
+    int type;
+    float value[4];
+    // when the input was sampled, 0 for commands that don't come from input
+    Uint64 time;
+  }Command;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief entry point for the thread
+  //----------------------------------------------------------------------------------------------------------------------
+  static int threadMain(void *_simulation);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the fixed rate loop run by the thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void run();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a command for the next tick
+  //----------------------------------------------------------------------------------------------------------------------
+  void push(const Command &_command);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief apply everything queued since the last tick
+  /// @param[in] _tickEnd performance counter time of this tick, input sampled up to here is applied
+  /// @param[out] o_angleX tilt about x over the tick, weighted by how long each speed was held
+  /// @param[out] o_angleZ tilt about z over the tick
+  //----------------------------------------------------------------------------------------------------------------------
+  void applyCommands(Uint64 _tickEnd, float &o_angleX, float &o_angleZ);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief put the maze, ball and goal back to the start
+  //----------------------------------------------------------------------------------------------------------------------
+  void resetMaze();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief method to test if player has lost (returns true or false)
+  //----------------------------------------------------------------------------------------------------------------------
+  bool lose();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief method to test if player has won (returns true or false)
+  //----------------------------------------------------------------------------------------------------------------------
+  bool win();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief park the balls out of view and wake the rest while the governor asks for it, otherwise
+  /// wake everything we parked
+  //----------------------------------------------------------------------------------------------------------------------
+  void updateParking();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief take the tick's tilt from the autopilot, and start a new game once one has ended
+  /// @param[out] o_angleX o_angleZ tilt for the tick
+  //----------------------------------------------------------------------------------------------------------------------
+  void driveAutopilot(float &o_angleX, float &o_angleZ);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start or stop the party balls in the physics world
+  /// @param[in] _balls number of party balls, 0 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  void applyParty(unsigned int _balls);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief swap the maze for a level's and start it again, freeing the level it replaces. The
+  /// broadphase is made again for the level's maze and ball collisions set as the level asks
+  /// @param[in] _level the level
+  /// @param[in] _index its place in the pack
+  //----------------------------------------------------------------------------------------------------------------------
+  void applyLevel(Level *_level, int _index);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out where new balls and the goal cube go
+  /// @param[in] _start where the ball starts in the maze's space
+  /// @param[in] _goal middle of the top of the goal hole in the maze's space
+  //----------------------------------------------------------------------------------------------------------------------
+  void placeStart(const ngl::Vec3 &_start, const ngl::Vec3 &_goal);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the maze being played as a list of triangles in its own space
+  /// @param[out] o_triangles the triangles, empty when playing mazev3.obj
+  //----------------------------------------------------------------------------------------------------------------------
+  void getMazeTriangles(std::vector <ngl::Vec3> &o_triangles) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bring in the chunks of a streamed maze near the balls and throw out the rest
+  //----------------------------------------------------------------------------------------------------------------------
+  void streamChunks();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill in the back snapshot and swap it with the one waiting for the renderer
+  //----------------------------------------------------------------------------------------------------------------------
+  void publish();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief physics world, only touched by the simulating thread
+  //----------------------------------------------------------------------------------------------------------------------
+  PhysicsWorld *m_physics;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the generated maze, its arrays are the maze's collision shape so it lives as long as we do
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeGenerator m_maze;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief collision of a streamed maze, 0 when the maze is held whole. The ball positions are
+  /// kept to save allocating them each tick
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeChunks *m_chunks;
+  std::vector <btVector3> m_ballPositions;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the level being played, 0 for the maze the config file set up. m_pendingLevel is
+  /// written under m_commandLock and applied at the next tick
+  //----------------------------------------------------------------------------------------------------------------------
+  Level *m_level;
+  int m_levelIndex;
+  Level *m_pendingLevel;
+  int m_pendingLevelIndex;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief where new balls and the goal cube go, they depend on the maze
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::Vec3 m_ballStart;
+  ngl::Vec3 m_cubeStart;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief friction from the config file used for new balls and mazes
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_friction;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief surface material of the maze
+  //----------------------------------------------------------------------------------------------------------------------
+  MaterialId m_mazeMaterial;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief tilt speeds
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_up;
+  float m_down;
+  float m_left;
+  float m_right;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief performance counter time of the last tick, the start of the next tick's input window
+  //----------------------------------------------------------------------------------------------------------------------
+  Uint64 m_tickTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sample time of the newest input applied, copied into the snapshot for latency measurement
+  //----------------------------------------------------------------------------------------------------------------------
+  Uint64 m_inputTime;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief game state, atomic so other threads can check it
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_atomic_t m_state;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief whether the party is on, atomic so the event loop can toggle it
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_atomic_t m_party;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief whether publish counts the bodies, atomic as the render thread sets it
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_atomic_t m_countBodies;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief game state in the last snapshot published
+  //----------------------------------------------------------------------------------------------------------------------
+  int m_publishedState;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief counters copied into each snapshot
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_tick;
+  int m_substeps;
+  unsigned long m_totalSubsteps;
+  unsigned long m_wins;
+  unsigned long m_losses;
+  float m_stepMs[SNAPSHOT_STEP_HISTORY];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decides how much physics work to shed
+  //----------------------------------------------------------------------------------------------------------------------
+  StepGovernor m_governor;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the renderer's view projection, m_pendingView is written under m_commandLock and
+  /// copied to m_view when m_viewChanged is set
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::Mat4 m_view;
+  bool m_haveView;
+  ngl::Mat4 m_pendingView;
+  bool m_viewChanged;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief grid and distance field of the maze for the autopilot
+  //----------------------------------------------------------------------------------------------------------------------
+  NavGrid m_navGrid;
+  Autopilot m_autopilot;
+  bool m_autopilotOn;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief distance field for the party balls when the maze collides with its triangles
+  //----------------------------------------------------------------------------------------------------------------------
+  MazeSdf m_swarmSdf;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ticks the autopilot has been waiting outside of a game
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_idleTicks;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief commands queued by other threads and the list being applied, swapped each tick
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Command> m_commands;
+  std::vector <Command> m_applying;
+  SDL_mutex *m_commandLock;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief signalled when a command is queued so the thread can sleep outside of a game
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_cond *m_commandSignal;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the thread, 0 when ticked by the caller
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_Thread *m_thread;
+  SDL_atomic_t m_running;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief posted when the game state changes
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_sem *m_wake;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the triple buffer. m_back is being written by the simulation, m_front is being drawn
+  /// and m_ready holds the index of the third along with a flag saying it is newer than m_front
+  //----------------------------------------------------------------------------------------------------------------------
+  Snapshot m_snapshots[3];
+  int m_back;
+  int m_front;
+  SDL_atomic_t m_ready;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SNAPSHOT_H__
+#define SNAPSHOT_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Snapshot.h
+/// @brief state handed from the simulation thread to the renderer
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <SDL.h>
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what the renderer should draw for a body
+//----------------------------------------------------------------------------------------------------------------------
+enum BodyKind
+{
+  BODY_OTHER=0,
+  BODY_BALL,
+  BODY_MAZE,
+  BODY_CUBE
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief number of recent physics step times carried in a snapshot, the renderer may skip
+/// snapshots when it runs slower than the simulation so keep enough to not lose samples
+//----------------------------------------------------------------------------------------------------------------------
+#define SNAPSHOT_STEP_HISTORY 16
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a body to draw
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  ngl::Mat4 transform;
+  BodyKind kind;
+  // world space box round the body from bullet's broadphase, for culling
+  ngl::Vec3 aabbMin;
+  ngl::Vec3 aabbMax;
+}BodyState;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief everything the renderer needs from one simulation tick, the simulation fills these in
+/// and the renderer only ever reads them so no locks are needed while drawing
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  // number of physics steps taken so far
+  unsigned long tick;
+  // game state (0 menu, 1 game, 2 lose, 3 win)
+  int state;
+  // every body apart from the ground plane
+  std::vector <BodyState> bodies;
+  // step time in ms of tick t is in stepMs[t%SNAPSHOT_STEP_HISTORY]
+  float stepMs[SNAPSHOT_STEP_HISTORY];
+  int substeps;
+  unsigned long totalSubsteps;
+  unsigned int activeBodies;
+  unsigned int sleepingBodies;
+  unsigned int islands;
+  unsigned int contacts;
+  unsigned int broadphasePairs;
+  unsigned int manifolds;
+  unsigned long wins;
+  unsigned long losses;
+  // performance counter time the newest input applied so far was sampled, 0 for none
+  Uint64 inputTime;
+  // how much work the step governor is shedding (a GovernorLevel)
+  int governorLevel;
+  // party balls as x y z triples, empty when party mode is off
+  std::vector <float> swarm;
+  // contacts the party balls resolved in the last step
+  unsigned int swarmContacts;
+  // chunks of a streamed maze and how many collide at the moment, 0 when the maze is held whole
+  unsigned int mazeChunks;
+  unsigned int residentChunks;
+  // place in the level pack of the level being played, -1 when not playing a pack
+  int level;
+}Snapshot;
+
+#endif
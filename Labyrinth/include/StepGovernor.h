@@ -0,0 +1,104 @@
+#ifndef STEPGOVERNOR_H__
+#define STEPGOVERNOR_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file StepGovernor.h
+/// @brief watches the physics step time and decides how much work to shed when it goes over budget
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief degradation levels, each one also keeps everything shed by the levels before it
+//----------------------------------------------------------------------------------------------------------------------
+enum GovernorLevel
+{
+  GOVERNOR_OFF=0,
+  // one substep a tick and no catching up on ticks we have fallen behind on
+  GOVERNOR_CAP_SUBSTEPS,
+  // fewer constraint solver iterations
+  GOVERNOR_FEWER_ITERATIONS,
+  // balls the camera can't see are put to sleep
+  GOVERNOR_SLEEP_OFFSCREEN,
+  // no more balls can be added
+  GOVERNOR_REFUSE_SPAWNS,
+  GOVERNOR_LEVELS
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class StepGovernor "include/StepGovernor.h"
+/// @brief Class that keeps a running average of the physics step time and moves through the
+/// GovernorLevels when it is over budget. It sheds a level at a time quickly so a pile of balls
+/// can't run away into a spiral of longer and longer steps, and only gives work back after the
+/// steps have been well under budget for a few seconds so it doesn't bounce between levels.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class StepGovernor
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _budget step time budget in ms, 0 never sheds anything
+  //----------------------------------------------------------------------------------------------------------------------
+  StepGovernor(float _budget=0.0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the step time budget and go back to full quality
+  /// @param[in] _budget step time budget in ms, 0 never sheds anything
+  //----------------------------------------------------------------------------------------------------------------------
+  void setBudget(float _budget);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the step time budget in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  inline float getBudget() const {return m_budget;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add the time of the step just taken
+  /// @param[in] _stepMs the step time in ms
+  /// @returns true if the level changed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool update(float _stepMs);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the active level
+  //----------------------------------------------------------------------------------------------------------------------
+  inline GovernorLevel getLevel() const {return m_level;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the most substeps the next step may take
+  //----------------------------------------------------------------------------------------------------------------------
+  inline int getMaxSubsteps() const {return m_level>=GOVERNOR_CAP_SUBSTEPS ? 1 : 10;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the constraint solver iterations for the next step (bullet's default is 10)
+  //----------------------------------------------------------------------------------------------------------------------
+  inline int getSolverIterations() const {return m_level>=GOVERNOR_FEWER_ITERATIONS ? 4 : 10;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if balls out of view should be put to sleep
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool sleepOffscreen() const {return m_level>=GOVERNOR_SLEEP_OFFSCREEN;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns true if new balls may be added
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool allowSpawns() const {return m_level<GOVERNOR_REFUSE_SPAWNS;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns a short name for a level for the HUD and logs
+  /// @param[in] _level the level
+  //----------------------------------------------------------------------------------------------------------------------
+  static const char *levelName(int _level);
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief step time budget in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_budget;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief exponential moving average of the step time in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_average;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the active level
+  //----------------------------------------------------------------------------------------------------------------------
+  GovernorLevel m_level;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief steps in a row over or well under budget
+  //----------------------------------------------------------------------------------------------------------------------
+  int m_over;
+  int m_under;
+};
+
+#endif
@@ -107,6 +107,18 @@ public:
   void setColour( ngl::Real _r, ngl::Real _g,  ngl::Real _b  );
 
   void setTransform(float _x, float _y);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns how many glyph draw calls renderText has issued since the last resetDrawCalls
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getDrawCalls() const {return m_drawCalls;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief reset the draw call counter (called once per frame)
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void resetDrawCalls() {m_drawCalls=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the bytes used by the glyph textures
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long getTextureBytes() const {return m_textureBytes;}
 
 private:
   //----------------------------------------------------------------------------------------------------------------------
@@ -116,6 +128,14 @@ private:
   //----------------------------------------------------------------------------------------------------------------------
   std::map <char,FontChar> m_characters;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of glyph draw calls, mutable as renderText is const
+  //----------------------------------------------------------------------------------------------------------------------
+  mutable unsigned int m_drawCalls;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bytes used by the glyph textures
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_textureBytes;
+  //----------------------------------------------------------------------------------------------------------------------
   /// extra glue for python lib bindings nothing to see here (unless ....)
   //----------------------------------------------------------------------------------------------------------------------
   #ifdef NO_PYTHON_LIB
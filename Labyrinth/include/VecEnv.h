@@ -0,0 +1,181 @@
+#ifndef VECENV_H__
+#define VECENV_H__
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file VecEnv.h
+/// @brief many independent mazes stepped together across threads for automated players and testers
+//----------------------------------------------------------------------------------------------------------------------
+
+#include <SDL.h>
+#include <vector>
+#include "PhysicsWorld.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what to do with one environment for a step, radians to tilt the maze by as Simulation
+/// applies a tick's worth of input
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  float tiltX;
+  float tiltZ;
+}EnvAction;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what one environment looks like after a step, all floats so the array of them can be
+/// handed on as a flat N x OBSERVATION_FLOATS array
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  float position[3];
+  float velocity[3];
+  // maze rotation as a quaternion (x, y, z, w)
+  float tilt[4];
+  // 1 if the ball reached the goal this step, -1 if it fell off, 0 otherwise. When non zero the
+  // environment has already been reset and the rest of the observation is of the new episode
+  float outcome;
+  // steps taken in the episode
+  float episodeSteps;
+}EnvObservation;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief number of floats in an EnvObservation
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int OBSERVATION_FLOATS=sizeof(EnvObservation)/sizeof(float);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class VecEnv "include/VecEnv.h"
+/// @brief Class hosting a number of PhysicsWorlds, each a copy of the game's maze with one ball,
+/// that all share the collision shapes in CollisionShape. step advances every world by one tick on
+/// a pool of SDL threads, each thread taking a fixed run of worlds, and returns the observations
+/// in one contiguous array. A world that wins, loses or runs out of steps is put back to its
+/// starting state with PhysicsWorld::restoreState rather than being rebuilt.
+/// Bullet keeps its profiler in globals, so unless it is built with BT_NO_PROFILE a VecEnv with
+/// more than one thread replaces the profile zone hooks with ones that do nothing.
+/// @author Faye Butler
+//----------------------------------------------------------------------------------------------------------------------
+
+class VecEnv
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor loads the collision shapes if nothing has yet and builds the worlds
+  /// @param[in] _envs number of environments
+  /// @param[in] _threads number of threads to step them on, including the caller's, 0 for one per core
+  /// @param[in] _maxEpisodeSteps steps before an episode is cut short and reset, 0 for no limit
+  /// @param[in] _gravityY strength of gravity
+  /// @param[in] _friction friction as read from the config file
+  //----------------------------------------------------------------------------------------------------------------------
+  VecEnv(unsigned int _envs, unsigned int _threads=0, unsigned int _maxEpisodeSteps=3600, int _gravityY=-100, float _friction=0.3);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor stops the threads and deletes the worlds
+  //----------------------------------------------------------------------------------------------------------------------
+  ~VecEnv();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief put every environment back to the start
+  /// @returns the observations, getNumEnvs of them
+  //----------------------------------------------------------------------------------------------------------------------
+  const EnvObservation *reset();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief step every environment once
+  /// @param[in] _actions one action per environment
+  /// @returns the observations, getNumEnvs of them, valid until the next step or reset
+  //----------------------------------------------------------------------------------------------------------------------
+  const EnvObservation *step(const EnvAction *_actions);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the observations from the last step or reset
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const EnvObservation *getObservations() const {return &m_observations[0];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of environments
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumEnvs() const {return m_envs.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns the number of threads stepping them, including the caller's
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumThreads() const {return m_workers.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns environment steps per second of time spent in step, over all threads
+  //----------------------------------------------------------------------------------------------------------------------
+  double getStepsPerSecond() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief returns environment steps per second per thread, how well the stepping scales
+  //----------------------------------------------------------------------------------------------------------------------
+  inline double getStepsPerSecondPerCore() const {return getStepsPerSecond()/m_workers.size();}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one environment
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    PhysicsWorld *world;
+    unsigned int episodeSteps;
+  }Env;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a thread and the run of environments it steps
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef struct
+  {
+    VecEnv *owner;
+    unsigned int first;
+    unsigned int last;
+    SDL_sem *go;
+    SDL_Thread *thread;
+  }Worker;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief entry point for the worker threads
+  /// @param[in] _worker the Worker
+  //----------------------------------------------------------------------------------------------------------------------
+  static int workerMain(void *_worker);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief step the environments [_first, _last) with m_actions
+  //----------------------------------------------------------------------------------------------------------------------
+  void stepRange(unsigned int _first, unsigned int _last);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief put an environment back to the start
+  //----------------------------------------------------------------------------------------------------------------------
+  void resetEnv(unsigned int _index);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill in the observation of an environment
+  //----------------------------------------------------------------------------------------------------------------------
+  void observe(unsigned int _index, float _outcome);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the environments
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Env> m_envs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief observations, one per environment
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <EnvObservation> m_observations;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief state every world starts an episode from, they are all built the same so one does
+  //----------------------------------------------------------------------------------------------------------------------
+  SavedWorld m_start;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief steps before an episode is cut short, 0 for no limit
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_maxEpisodeSteps;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief actions for the step in progress
+  //----------------------------------------------------------------------------------------------------------------------
+  const EnvAction *m_actions;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief workers, the first is the calling thread and has no thread of its own
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Worker> m_workers;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief posted by each worker thread when its run is stepped
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_sem *m_done;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief cleared to make the worker threads exit
+  //----------------------------------------------------------------------------------------------------------------------
+  SDL_atomic_t m_running;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief environment steps taken and performance counter ticks spent taking them
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_totalSteps;
+  Uint64 m_stepTicks;
+};
+
+#endif
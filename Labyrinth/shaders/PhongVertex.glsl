@@ -5,8 +5,13 @@ layout (location = 0) in vec3 inVert;
 layout (location = 2) in vec3 inNormal;
 /// @brief the in uv
 layout (location = 1) in vec2 inUV;
-/// @brief flag to indicate if model has unit normals if not normalize
-uniform bool Normalize;
+// the program is built in variants, each #define below is put in by the app after the #version line
+// INSTANCED : every instance is the mesh moved by its own offset
+// NORMALIZE : the mesh's normals aren't unit length so normalize them before they are interpolated
+#ifdef INSTANCED
+/// @brief position of this instance, added on to every vertex
+layout (location = 3) in vec3 inOffset;
+#endif
 // the eye position of the camera
 uniform vec3 viewerPos;
 /// @brief the current fragment normal for the vert being processed
@@ -28,10 +33,6 @@ struct Lights
   vec4 ambient;
   vec4 diffuse;
   vec4 specular;
-  float constantAttenuation;
-  float spotCosCutoff;
-  float quadraticAttenuation;
-  float linearAttenuation;
 };
 // our material
 uniform Materials material;
@@ -41,8 +42,6 @@ uniform Lights light;
 out vec3 lightDir;
 // out the blinn half vector
 out vec3 halfVector;
-out vec3 eyeDirection;
-out vec3 vPosition;
 
 uniform mat4 MV;
 uniform mat4 MVP;
@@ -55,28 +54,26 @@ void main()
 // calculate the fragments surface normal
 fragmentNormal = (normalMatrix*inNormal);
 
-
-if (Normalize == true)
-{
- fragmentNormal = normalize(fragmentNormal);
-}
+#ifdef NORMALIZE
+fragmentNormal = normalize(fragmentNormal);
+#endif
+#ifdef INSTANCED
+// move the mesh to this instance, only a translation so the normal is unchanged
+vec3 position = inVert+inOffset;
+#else
+vec3 position = inVert;
+#endif
 // calculate the vertex position
-gl_Position = MVP*vec4(inVert,1.0);
+gl_Position = MVP*vec4(position,1.0);
 
-vec4 worldPosition = M * vec4(inVert, 1.0);
-eyeDirection = normalize(viewerPos - worldPosition.xyz);
+vec4 worldPosition = M * vec4(position, 1.0);
+vec3 eyeDirection = normalize(viewerPos - worldPosition.xyz);
 // Get vertex position in eye coordinates
 // Transform the vertex to eye co-ordinates for frag shader
 /// @brief the vertex in eye co-ordinates  homogeneous
-vec4 eyeCord=MV*vec4(inVert,1);
-
-vPosition = eyeCord.xyz / eyeCord.w;;
-
-float dist;
+vec4 eyeCord=MV*vec4(position,1);
 
-lightDir=vec3(light.position.xyz-eyeCord.xyz);
-dist = length(lightDir);
-lightDir/= dist;
+lightDir=normalize(light.position.xyz-eyeCord.xyz);
 halfVector = normalize(eyeDirection + lightDir);
 
 }
@@ -0,0 +1,74 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Autopilot.cpp
+/// @brief plays the maze by following a NavGrid's distance field
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "Autopilot.h"
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief speed the ball is steered to along the field (units/s)
+//----------------------------------------------------------------------------------------------------------------------
+const static float CRUISE_SPEED=6.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief lean in radians for each unit/s the ball's speed is off the one wanted
+//----------------------------------------------------------------------------------------------------------------------
+const static float LEAN_GAIN=0.02;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief most the maze is leant over (radians)
+//----------------------------------------------------------------------------------------------------------------------
+const static float MAX_LEAN=0.15;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief most the tilt changes in a tick (radians), a little over three times the keyboard's
+//----------------------------------------------------------------------------------------------------------------------
+const static float MAX_RATE=0.01;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief clamp a value to +/- a limit
+//----------------------------------------------------------------------------------------------------------------------
+static inline float clampTo(float _value, float _limit)
+{
+  return std::max(-_limit,std::min(_value,_limit));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Autopilot::Autopilot(const NavGrid *_grid)
+{
+  m_grid=_grid;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Autopilot::act(const ngl::Vec3 &_ballPos, const ngl::Vec3 &_ballVelocity, const btQuaternion &_mazeRotation,
+                    const ngl::Vec3 &_mazePos, float &o_tiltX, float &o_tiltZ) const
+{
+  // the grid is in the maze's space so take the ball into it
+  btQuaternion toMaze=_mazeRotation.inverse();
+  btVector3 pos=quatRotate(toMaze,btVector3(_ballPos.m_x-_mazePos.m_x,_ballPos.m_y-_mazePos.m_y,_ballPos.m_z-_mazePos.m_z));
+  btVector3 vel=quatRotate(toMaze,btVector3(_ballVelocity.m_x,_ballVelocity.m_y,_ballVelocity.m_z));
+
+  // with nowhere to go (on the goal or off the grid) hold the ball still
+  float wantX=0.0;
+  float wantZ=0.0;
+  if(m_grid!=0 && m_grid->getDirection(ngl::Vec3(pos.getX(),pos.getY(),pos.getZ()),wantX,wantZ))
+  {
+    wantX*=CRUISE_SPEED;
+    wantZ*=CRUISE_SPEED;
+  }
+
+  // tilting about x by a positive angle rolls the ball towards +z, about z towards -x
+  float leanX=clampTo((wantZ-vel.getZ())*LEAN_GAIN,MAX_LEAN);
+  float leanZ=clampTo(-(wantX-vel.getX())*LEAN_GAIN,MAX_LEAN);
+
+  // where the maze is leant now, from which way its up points
+  btVector3 up=quatRotate(_mazeRotation,btVector3(0,1,0));
+  float nowX=asin(clampTo(up.getZ(),1.0));
+  float nowZ=-asin(clampTo(up.getX(),1.0));
+
+  o_tiltX=clampTo(leanX-nowX,MAX_RATE);
+  o_tiltZ=clampTo(leanZ-nowZ,MAX_RATE);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
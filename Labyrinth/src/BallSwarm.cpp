@@ -0,0 +1,461 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BallSwarm.cpp
+/// @brief thousands of identical balls solved outside bullet for party mode
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "BallSwarm.h"
+#include <cmath>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief passes over the contacts each step, more keeps deep piles firmer
+//----------------------------------------------------------------------------------------------------------------------
+const static int SWARM_ITERATIONS=4;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief furthest a ball moves in a step as a fraction of its radius, so two balls can't pass
+/// through each other between steps and one can't get through a wall
+//----------------------------------------------------------------------------------------------------------------------
+const static float MAX_STEP=1.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a ball this close to the maze (as a fraction of its radius) is on it for friction, the
+/// solve leaves balls just touching so they need a little leeway
+//----------------------------------------------------------------------------------------------------------------------
+const static float CONTACT_SLOP=0.02;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief rows of cells ahead of a cell as y and z steps, along with the rest of its own row each
+/// pair of cells is visited once. The cells along a row are next to each other in the sorted
+/// order so a row is one run of balls
+//----------------------------------------------------------------------------------------------------------------------
+const static int s_rows[4][2]={{1,0},{-1,1},{0,1},{1,1}};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BallSwarm::BallSwarm(float _radius, const btVector3 &_gridMin, const btVector3 &_gridMax, const MazeSdf *_sdf)
+{
+  m_radius=_radius;
+  // a cell the width of a ball means any ball touching another is in a neighbouring cell
+  float cell=2.0*_radius;
+  m_invCell=1.0/cell;
+  for(int a=0; a<3; ++a)
+  {
+    m_gridMin[a]=_gridMin[a];
+    m_dims[a]=std::max(1,int(ceil((_gridMax[a]-_gridMin[a])/cell)));
+    m_spawnMin[a]=_gridMin[a];
+    m_spawnMax[a]=_gridMax[a];
+  }
+  m_cellStart.assign(m_dims[0]*m_dims[1]*m_dims[2]+1,0);
+  m_sdf=_sdf;
+  m_mazePrev.setIdentity();
+  m_haveMaze=false;
+  m_killHeight=_gridMin[1];
+  m_random=2463534242u;
+  m_contacts=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::spawn(unsigned int _count, const btVector3 &_spawnMin, const btVector3 &_spawnMax, float _killHeight)
+{
+  for(int a=0; a<3; ++a)
+  {
+    m_spawnMin[a]=_spawnMin[a];
+    m_spawnMax[a]=_spawnMax[a];
+  }
+  m_killHeight=_killHeight;
+  m_px.resize(_count);
+  m_py.resize(_count);
+  m_pz.resize(_count);
+  m_vx.resize(_count);
+  m_vy.resize(_count);
+  m_vz.resize(_count);
+  m_ox.resize(_count);
+  m_oy.resize(_count);
+  m_oz.resize(_count);
+  m_order.resize(_count);
+  m_ballCell.resize(_count);
+  for(unsigned int i=0; i<_count; ++i)
+  {
+    respawn(i);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::respawn(unsigned int _ball)
+{
+  float *pos[3]={&m_px[_ball],&m_py[_ball],&m_pz[_ball]};
+  for(int a=0; a<3; ++a)
+  {
+    // xorshift, plenty for scattering balls
+    m_random^=m_random<<13;
+    m_random^=m_random>>17;
+    m_random^=m_random<<5;
+    float t=(m_random&0xffffff)/float(0x1000000);
+    *pos[a]=m_spawnMin[a]+(m_spawnMax[a]-m_spawnMin[a])*t;
+  }
+  m_vx[_ball]=0.0;
+  m_vy[_ball]=0.0;
+  m_vz[_ball]=0.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::addObstacle(const btVector3 &_pos, float _radius)
+{
+  Obstacle o;
+  for(int a=0; a<3; ++a)
+  {
+    o.pos[a]=_pos[a];
+  }
+  o.radius=_radius;
+  m_obstacles.push_back(o);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::step(float _dt, const btVector3 &_gravity, const btTransform &_maze, int _mazeMaterial)
+{
+  m_contacts=0;
+  if(m_px.empty() || _dt<=0.0)
+  {
+    return;
+  }
+  if(!m_haveMaze)
+  {
+    m_mazePrev=_maze;
+    m_haveMaze=true;
+  }
+  // lost balls go back in before they are sorted into the grid
+  for(unsigned int i=0; i<m_py.size(); ++i)
+  {
+    if(m_py[i]<m_killHeight)
+    {
+      respawn(i);
+    }
+  }
+  integrate(_dt,_gravity);
+  buildGrid();
+  unsigned int pairs=0;
+  unsigned int touching=0;
+  for(int i=0; i<SWARM_ITERATIONS; ++i)
+  {
+    pairs=solvePairs();
+    touching=solveMaze(_maze);
+  }
+  updateVelocities(_dt,_maze,MaterialTable::instance()->get(MATERIAL_BALL,_mazeMaterial));
+  m_contacts=pairs+touching;
+  m_mazePrev=_maze;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::integrate(float _dt, const btVector3 &_gravity)
+{
+  unsigned int n=m_px.size();
+  float *px=&m_px[0];
+  float *py=&m_py[0];
+  float *pz=&m_pz[0];
+  float *vx=&m_vx[0];
+  float *vy=&m_vy[0];
+  float *vz=&m_vz[0];
+  float *ox=&m_ox[0];
+  float *oy=&m_oy[0];
+  float *oz=&m_oz[0];
+  float gx=_gravity.x()*_dt;
+  float gy=_gravity.y()*_dt;
+  float gz=_gravity.z()*_dt;
+  float maxSpeed=MAX_STEP*m_radius/_dt;
+  unsigned int i=0;
+#if defined(__SSE__)
+  const __m128 dt4=_mm_set1_ps(_dt);
+  const __m128 gx4=_mm_set1_ps(gx);
+  const __m128 gy4=_mm_set1_ps(gy);
+  const __m128 gz4=_mm_set1_ps(gz);
+  const __m128 max4=_mm_set1_ps(maxSpeed);
+  const __m128 one4=_mm_set1_ps(1.0f);
+  const __m128 tiny4=_mm_set1_ps(1e-12f);
+  for(; i+4<=n; i+=4)
+  {
+    __m128 x=_mm_add_ps(_mm_loadu_ps(vx+i),gx4);
+    __m128 y=_mm_add_ps(_mm_loadu_ps(vy+i),gy4);
+    __m128 z=_mm_add_ps(_mm_loadu_ps(vz+i),gz4);
+    // scale down anything over the speed limit, the estimate of 1/sqrt is plenty for a clamp
+    __m128 speed2=_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x),_mm_mul_ps(y,y)),_mm_mul_ps(z,z));
+    __m128 scale=_mm_min_ps(one4,_mm_mul_ps(max4,_mm_rsqrt_ps(_mm_max_ps(speed2,tiny4))));
+    x=_mm_mul_ps(x,scale);
+    y=_mm_mul_ps(y,scale);
+    z=_mm_mul_ps(z,scale);
+    _mm_storeu_ps(vx+i,x);
+    _mm_storeu_ps(vy+i,y);
+    _mm_storeu_ps(vz+i,z);
+    __m128 p=_mm_loadu_ps(px+i);
+    _mm_storeu_ps(ox+i,p);
+    _mm_storeu_ps(px+i,_mm_add_ps(p,_mm_mul_ps(x,dt4)));
+    p=_mm_loadu_ps(py+i);
+    _mm_storeu_ps(oy+i,p);
+    _mm_storeu_ps(py+i,_mm_add_ps(p,_mm_mul_ps(y,dt4)));
+    p=_mm_loadu_ps(pz+i);
+    _mm_storeu_ps(oz+i,p);
+    _mm_storeu_ps(pz+i,_mm_add_ps(p,_mm_mul_ps(z,dt4)));
+  }
+#endif
+  // whatever is left over, or everything without SSE
+  for(; i<n; ++i)
+  {
+    float x=vx[i]+gx;
+    float y=vy[i]+gy;
+    float z=vz[i]+gz;
+    float speed2=x*x+y*y+z*z;
+    if(speed2>maxSpeed*maxSpeed)
+    {
+      float scale=maxSpeed/sqrt(speed2);
+      x*=scale;
+      y*=scale;
+      z*=scale;
+    }
+    vx[i]=x;
+    vy[i]=y;
+    vz[i]=z;
+    ox[i]=px[i];
+    oy[i]=py[i];
+    oz[i]=pz[i];
+    px[i]+=x*_dt;
+    py[i]+=y*_dt;
+    pz[i]+=z*_dt;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::buildGrid()
+{
+  unsigned int n=m_px.size();
+  unsigned int cells=m_cellStart.size()-1;
+  std::fill(m_cellStart.begin(),m_cellStart.end(),0);
+  for(unsigned int i=0; i<n; ++i)
+  {
+    int x, y, z;
+    cellOf(m_px[i],m_py[i],m_pz[i],x,y,z);
+    unsigned int c=(z*m_dims[1]+y)*m_dims[0]+x;
+    m_ballCell[i]=c;
+    ++m_cellStart[c];
+  }
+  // running total gives the end of each cell, counting back down leaves each at its start
+  for(unsigned int c=1; c<cells; ++c)
+  {
+    m_cellStart[c]+=m_cellStart[c-1];
+  }
+  for(unsigned int i=n; i-->0;)
+  {
+    m_order[i]=--m_cellStart[m_ballCell[i]];
+  }
+  m_cellStart[cells]=n;
+
+  // move every array into cell order, the balls have no identity so nothing else needs to know
+  std::vector <float> *arrays[]={&m_px,&m_py,&m_pz,&m_vx,&m_vy,&m_vz,&m_ox,&m_oy,&m_oz};
+  m_scratch.resize(n);
+  for(int a=0; a<9; ++a)
+  {
+    const float *from=&(*arrays[a])[0];
+    for(unsigned int i=0; i<n; ++i)
+    {
+      m_scratch[m_order[i]]=from[i];
+    }
+    arrays[a]->swap(m_scratch);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int BallSwarm::solvePairs()
+{
+  unsigned int n=m_px.size();
+  float *px=&m_px[0];
+  float *py=&m_py[0];
+  float *pz=&m_pz[0];
+  const unsigned int *start=&m_cellStart[0];
+  float diameter=2.0*m_radius;
+  float diameter2=diameter*diameter;
+  unsigned int pairs=0;
+
+  // the balls of cell c are start[c] to start[c+1], step c along with the balls
+  unsigned int c=0;
+  int cx=0, cy=0, cz=0, x0=0, x1=0;
+  for(unsigned int i=0; i<n; ++i)
+  {
+    if(start[c+1]<=i)
+    {
+      while(start[c+1]<=i)
+      {
+        ++c;
+      }
+      cx=c%m_dims[0];
+      cy=(c/m_dims[0])%m_dims[1];
+      cz=c/(m_dims[0]*m_dims[1]);
+      x0=std::max(cx-1,0);
+      x1=std::min(cx+1,m_dims[0]-1);
+    }
+    // ball i's pushes are added up and applied at the end, so each check doesn't wait on the last
+    float xi=px[i];
+    float yi=py[i];
+    float zi=pz[i];
+    float mx=0.0, my=0.0, mz=0.0;
+    // the rest of this ball's cell and the next one along, then the rows ahead
+    unsigned int first=i+1;
+    unsigned int last=start[c-cx+x1+1];
+    for(int r=-1; r<4; ++r)
+    {
+      if(r>=0)
+      {
+        int y=cy+s_rows[r][0];
+        int z=cz+s_rows[r][1];
+        if(y<0 || y>=m_dims[1] || z>=m_dims[2])
+        {
+          continue;
+        }
+        unsigned int row=(z*m_dims[1]+y)*m_dims[0];
+        first=start[row+x0];
+        last=start[row+x1+1];
+      }
+      for(unsigned int j=first; j<last; ++j)
+      {
+        float dx=px[j]-xi;
+        float dy=py[j]-yi;
+        float dz=pz[j]-zi;
+        float dist2=dx*dx+dy*dy+dz*dz;
+        if(dist2>=diameter2 || dist2<1e-12f)
+        {
+          continue;
+        }
+        ++pairs;
+        // each moves half the overlap
+        float dist=sqrt(dist2);
+        float push=(diameter-dist)*0.5f/dist;
+        dx*=push;
+        dy*=push;
+        dz*=push;
+        mx+=dx;
+        my+=dy;
+        mz+=dz;
+        px[j]+=dx;
+        py[j]+=dy;
+        pz[j]+=dz;
+      }
+    }
+    px[i]=xi-mx;
+    py[i]=yi-my;
+    pz[i]=zi-mz;
+  }
+  return pairs;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int BallSwarm::solveMaze(const btTransform &_maze)
+{
+  unsigned int n=m_px.size();
+  unsigned int touching=0;
+  btTransform toMaze=_maze.inverse();
+  for(unsigned int i=0; i<n; ++i)
+  {
+    btVector3 pos(m_px[i],m_py[i],m_pz[i]);
+    bool touched=false;
+    btScalar distance;
+    btVector3 gradient;
+    if(m_sdf!=0 && m_sdf->sample(toMaze*pos,distance,gradient) && distance<m_radius && gradient.length2()>SIMD_EPSILON)
+    {
+      pos+=(_maze.getBasis()*gradient.normalized())*(m_radius-distance);
+      touched=true;
+    }
+    for(unsigned int o=0; o<m_obstacles.size(); ++o)
+    {
+      const Obstacle &ob=m_obstacles[o];
+      btVector3 offset=pos-btVector3(ob.pos[0],ob.pos[1],ob.pos[2]);
+      btScalar reach=ob.radius+m_radius;
+      btScalar dist2=offset.length2();
+      if(dist2<reach*reach && dist2>1e-12)
+      {
+        btScalar dist=sqrt(dist2);
+        pos+=offset*((reach-dist)/dist);
+        touched=true;
+      }
+    }
+    if(touched)
+    {
+      ++touching;
+      m_px[i]=pos.x();
+      m_py[i]=pos.y();
+      m_pz[i]=pos.z();
+    }
+  }
+  return touching;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::updateVelocities(float _dt, const btTransform &_maze, const MaterialPair &_material)
+{
+  unsigned int n=m_px.size();
+  btTransform toMaze=_maze.inverse();
+  float invDt=1.0/_dt;
+  btScalar reach=m_radius*(1.0+CONTACT_SLOP);
+  for(unsigned int i=0; i<n; ++i)
+  {
+    btVector3 pos(m_px[i],m_py[i],m_pz[i]);
+    // what it moved by, pushes included, is its velocity from now on
+    btVector3 vel=(pos-btVector3(m_ox[i],m_oy[i],m_oz[i]))*invDt;
+    btVector3 local=toMaze*pos;
+    btScalar distance;
+    btVector3 gradient;
+    if(m_sdf!=0 && m_sdf->sample(local,distance,gradient) && distance<reach && gradient.length2()>SIMD_EPSILON)
+    {
+      btVector3 normal=_maze.getBasis()*gradient.normalized();
+      // the maze moves every point of itself, the point under the ball moved from here last step
+      btVector3 surface=(pos-m_mazePrev*local)*invDt;
+      btVector3 before=btVector3(m_vx[i],m_vy[i],m_vz[i])-surface;
+      btVector3 relative=vel-surface;
+      btScalar closing=before.dot(normal);
+      btScalar normalSpeed=relative.dot(normal);
+      // a ball that hit the maze leaves at its bounce times the speed it came in at
+      if(closing<0.0)
+      {
+        btScalar bounce=-_material.restitution*closing;
+        if(bounce>normalSpeed)
+        {
+          relative+=normal*(bounce-normalSpeed);
+          normalSpeed=bounce;
+        }
+      }
+      // coulomb friction, the sliding speed lost is at most the friction times the normal speed the maze took away
+      btScalar impulse=normalSpeed-closing;
+      btVector3 tangent=relative-normal*normalSpeed;
+      btScalar slide=tangent.length();
+      if(impulse>0.0 && slide>SIMD_EPSILON)
+      {
+        relative-=tangent*(btMin(slide,_material.friction*impulse)/slide);
+      }
+      vel=relative+surface;
+    }
+    m_vx[i]=vel.x();
+    m_vy[i]=vel.y();
+    m_vz[i]=vel.z();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BallSwarm::getPositions(std::vector <float> &o_xyz) const
+{
+  unsigned int n=m_px.size();
+  o_xyz.resize(n*3);
+  for(unsigned int i=0; i<n; ++i)
+  {
+    o_xyz[i*3]=m_px[i];
+    o_xyz[i*3+1]=m_py[i];
+    o_xyz[i*3+2]=m_pz[i];
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
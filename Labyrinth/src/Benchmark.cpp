@@ -0,0 +1,342 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Benchmark.cpp
+/// @brief scripted benchmark run, replays a tilt / ball spawn timeline and writes a JSON report
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "Benchmark.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <boost/tokenizer.hpp>
+#include <boost/lexical_cast.hpp>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief metrics compared against the baseline
+//----------------------------------------------------------------------------------------------------------------------
+static const char *s_compared[]={"frame_ms_p50","frame_ms_p95","frame_ms_p99","physics_ms_p95","draw_ms_p95"};
+static const unsigned int s_numCompared=5;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief thrown when a script line ends before all of its values
+//----------------------------------------------------------------------------------------------------------------------
+struct MissingValue {};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns the next word of a script line and steps past it
+/// @param[in,out] io_word the word to read
+/// @param[in] _end the end of the line
+//----------------------------------------------------------------------------------------------------------------------
+static std::string nextWord(tokenizer::iterator &io_word, const tokenizer::iterator &_end)
+{
+  if(io_word==_end)
+  {
+    throw MissingValue();
+  }
+  return *io_word++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief reads a count that has to be above zero, lexical_cast to unsigned would let -1 through as 4e9
+/// @param[in] _word the word to read
+//----------------------------------------------------------------------------------------------------------------------
+static int positiveValue(const std::string &_word)
+{
+  int value=boost::lexical_cast<int>(_word);
+  if(value<=0)
+  {
+    throw boost::bad_lexical_cast();
+  }
+  return value;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Benchmark::commandBefore(const Command &_a, const Command &_b)
+{
+  return _a.frame < _b.frame;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Benchmark::Benchmark() :
+  m_frameTime(0.01,10000,1),
+  m_physicsTime(0.01,10000,1),
+  m_drawTime(0.01,10000,1)
+{
+  m_next=0;
+  m_frames=600;
+  m_output="benchmark.json";
+  m_threshold=10.0;
+  m_width=1280;
+  m_height=720;
+  m_renderer="unknown";
+  m_hashInterval=0;
+  Totals t={0.0,0.0};
+  m_frameTotals=t;
+  m_physicsTotals=t;
+  m_drawTotals=t;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Benchmark::load(const std::string &_fileName)
+{
+  std::fstream fileIn;
+  fileIn.open(_fileName.c_str(),std::ios::in);
+  if (!fileIn.is_open())
+  {
+    std::cerr<<"Benchmark script : "<<_fileName<<" Not found\n";
+    return false;
+  }
+  m_script=_fileName;
+  std::string lineBuffer;
+  boost::char_separator<char> sep(" \t\r\n");
+
+  while(getline(fileIn, lineBuffer, '\n'))
+  {
+    tokenizer tokens(lineBuffer, sep);
+    tokenizer::iterator word = tokens.begin();
+    if(word==tokens.end() || (*word)[0]=='#')
+    {
+      continue;
+    }
+    try
+    {
+      std::string command=nextWord(word,tokens.end());
+      if(command == "Frames")
+      {
+        m_frames = positiveValue(nextWord(word,tokens.end()));
+      }
+      else if(command == "Output")
+      {
+        m_output = nextWord(word,tokens.end());
+      }
+      else if(command == "Baseline")
+      {
+        m_baseline = nextWord(word,tokens.end());
+      }
+      else if(command == "Threshold")
+      {
+        m_threshold = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Size")
+      {
+        m_width = positiveValue(nextWord(word,tokens.end()));
+        m_height = positiveValue(nextWord(word,tokens.end()));
+      }
+      else if(command == "Capture")
+      {
+        unsigned int frame = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+        m_captures[frame] = nextWord(word,tokens.end());
+      }
+      else if(command == "Hash")
+      {
+        m_hashInterval = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Tilt")
+      {
+        Command c;
+        c.frame = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+        std::string dir=nextWord(word,tokens.end());
+        c.type = dir=="up" ? 0 : dir=="down" ? 1 : dir=="left" ? 2 : dir=="right" ? 3 : -1;
+        c.value = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+        if(c.type<0)
+        {
+          std::cerr<<"unknown tilt direction "<<dir<<"\n";
+          return false;
+        }
+        m_commands.push_back(c);
+      }
+      else if(command == "Ball")
+      {
+        Command c;
+        c.frame = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+        c.type = 4;
+        c.value = 0.0;
+        m_commands.push_back(c);
+      }
+      else
+      {
+        std::cerr<<"unknown token"<<command<<std::endl;
+      }
+    }
+    catch(boost::bad_lexical_cast &)
+    {
+      std::cerr<<"bad value in benchmark script line : "<<lineBuffer<<"\n";
+      return false;
+    }
+    catch(MissingValue &)
+    {
+      std::cerr<<"missing value in benchmark script line : "<<lineBuffer<<"\n";
+      return false;
+    }
+  }
+  fileIn.close();
+
+  std::stable_sort(m_commands.begin(),m_commands.end(),commandBefore);
+  // histograms cover the whole run
+  m_frameTime=PerfHistogram(0.01,10000,m_frames);
+  m_physicsTime=PerfHistogram(0.01,10000,m_frames);
+  m_drawTime=PerfHistogram(0.01,10000,m_frames);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int Benchmark::apply(unsigned int _frame, float &io_up, float &io_down, float &io_left, float &io_right)
+{
+  unsigned int balls=0;
+  while(m_next<m_commands.size() && m_commands[m_next].frame<=_frame)
+  {
+    const Command &c=m_commands[m_next];
+    switch(c.type)
+    {
+      case 0 : io_up=c.value; break;
+      case 1 : io_down=c.value; break;
+      case 2 : io_left=c.value; break;
+      case 3 : io_right=c.value; break;
+      case 4 : ++balls; break;
+      default : break;
+    }
+    ++m_next;
+  }
+  return balls;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Benchmark::record(float _frameMs, float _physicsMs, float _drawMs)
+{
+  m_frameTime.addSample(_frameMs);
+  m_physicsTime.addSample(_physicsMs);
+  m_drawTime.addSample(_drawMs);
+  m_frameTotals.sum+=_frameMs;
+  m_frameTotals.max=std::max(m_frameTotals.max,_frameMs);
+  m_physicsTotals.sum+=_physicsMs;
+  m_physicsTotals.max=std::max(m_physicsTotals.max,_physicsMs);
+  m_drawTotals.sum+=_drawMs;
+  m_drawTotals.max=std::max(m_drawTotals.max,_drawMs);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Benchmark::writeMetric(std::ostream &_out, const std::string &_name, const PerfHistogram &_h, const Totals &_t, bool _last) const
+{
+  unsigned int count=_h.getCount() > 0 ? _h.getCount() : 1;
+  _out<<"  \""<<_name<<"_mean\": "<<_t.sum/count<<",\n";
+  _out<<"  \""<<_name<<"_p50\": "<<_h.percentile(50)<<",\n";
+  _out<<"  \""<<_name<<"_p95\": "<<_h.percentile(95)<<",\n";
+  _out<<"  \""<<_name<<"_p99\": "<<_h.percentile(99)<<",\n";
+  _out<<"  \""<<_name<<"_max\": "<<_t.max<<(_last ? "\n" : ",\n");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Benchmark::writeReport() const
+{
+  std::ofstream fileOut;
+  fileOut.open(m_output.c_str(),std::ios::out);
+  if (!fileOut.is_open())
+  {
+    std::cerr <<"Could not open File : "<<m_output<<" for writing \n";
+    return false;
+  }
+  fileOut<<"{\n";
+  fileOut<<"  \"version\": 1,\n";
+  fileOut<<"  \"script\": \""<<m_script<<"\",\n";
+  fileOut<<"  \"renderer\": \""<<m_renderer<<"\",\n";
+  fileOut<<"  \"frames\": "<<m_frameTime.getCount()<<",\n";
+  if(!m_hashes.empty())
+  {
+    fileOut<<"  \"frame_hashes\": {";
+    std::map <unsigned int,unsigned int>::const_iterator hash;
+    for(hash=m_hashes.begin(); hash!=m_hashes.end(); ++hash)
+    {
+      fileOut<<(hash==m_hashes.begin() ? "" : ", ")<<"\""<<hash->first<<"\": \""
+             <<std::hex<<std::setw(8)<<std::setfill('0')<<hash->second<<std::dec<<std::setfill(' ')<<"\"";
+    }
+    fileOut<<"},\n";
+  }
+  writeMetric(fileOut,"frame_ms",m_frameTime,m_frameTotals,false);
+  writeMetric(fileOut,"physics_ms",m_physicsTime,m_physicsTotals,false);
+  writeMetric(fileOut,"draw_ms",m_drawTime,m_drawTotals,true);
+  fileOut<<"}\n";
+  fileOut.close();
+  std::cout<<"Benchmark report written to "<<m_output<<"\n";
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Benchmark::captureFile(unsigned int _frame, std::string &o_file) const
+{
+  std::map <unsigned int,std::string>::const_iterator capture=m_captures.find(_frame);
+  if(capture==m_captures.end())
+  {
+    return false;
+  }
+  o_file=capture->second;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief find a number in one of our own reports, they are flat so a key search is enough
+//----------------------------------------------------------------------------------------------------------------------
+static bool findValue(const std::string &_json, const std::string &_key, float &o_value)
+{
+  std::string::size_type pos=_json.find("\""+_key+"\":");
+  if(pos==std::string::npos)
+  {
+    return false;
+  }
+  o_value=strtod(_json.c_str()+pos+_key.size()+3,0);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Benchmark::compareBaseline() const
+{
+  if(m_baseline.empty())
+  {
+    return true;
+  }
+  std::ifstream base(m_baseline.c_str());
+  std::ifstream current(m_output.c_str());
+  if(!base.is_open() || !current.is_open())
+  {
+    std::cerr<<"Could not read baseline "<<m_baseline<<" or report "<<m_output<<"\n";
+    return false;
+  }
+  std::stringstream baseText;
+  baseText<<base.rdbuf();
+  std::stringstream currentText;
+  currentText<<current.rdbuf();
+
+  bool pass=true;
+  for(unsigned int i=0; i<s_numCompared; ++i)
+  {
+    float was, now;
+    if(!findValue(baseText.str(),s_compared[i],was) || !findValue(currentText.str(),s_compared[i],now))
+    {
+      std::cerr<<s_compared[i]<<" missing from baseline or report\n";
+      pass=false;
+      continue;
+    }
+    float change= was > 0.0 ? (now-was)/was*100.0 : 0.0;
+    bool regressed= change > m_threshold;
+    std::cout<<s_compared[i]<<" baseline "<<was<<" now "<<now<<" ("<<change<<"%)"
+             <<(regressed ? " REGRESSION" : "")<<"\n";
+    pass = pass && !regressed;
+  }
+  return pass;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
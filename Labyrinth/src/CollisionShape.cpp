@@ -6,7 +6,9 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 #include "CollisionShape.h"
+#include "SdfCollision.h"
 #include <ngl/Obj.h>
+#include <iostream>
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -40,6 +42,13 @@ void CollisionShape::addSphere(const std::string & _name, const std::string &_ob
 
 //----------------------------------------------------------------------------------------------------------------------
 
+void CollisionShape::addPrimitiveSphere(const std::string & _name, float _radius)
+{
+	m_shapes[_name]=new btSphereShape(_radius);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 void CollisionShape::addMaze(const std::string & _name, const std::string &_objFilePath)
 {
   ngl::Obj mesh(_objFilePath);
@@ -70,6 +79,108 @@ void CollisionShape::addMaze(const std::string & _name, const std::string &_objF
 
 //----------------------------------------------------------------------------------------------------------------------
 
+bool CollisionShape::addMazeSdf(const std::string & _name, const std::string &_objFilePath)
+{
+  //the mesh is still needed for the bounds, ray casts and continuous collision
+  addMaze(_name,_objFilePath);
+  MazeSdf *sdf=new MazeSdf;
+  if(!sdf->loadOrBuild(_objFilePath))
+  {
+    std::cerr<<"Unable to make a distance field for "<<_objFilePath<<" colliding with the mesh\n";
+    delete sdf;
+    return false;
+  }
+  m_shapes[_name]=new MazeSdfShape(sdf,static_cast<btBvhTriangleMeshShape *>(m_shapes[_name]));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void CollisionShape::addGeneratedMaze(const std::string & _name, const MazeGenerator &_maze)
+{
+  m_shapes[_name]=makeMeshShape(_maze.getVertices(),_maze.getIndices());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void CollisionShape::deleteMazeShape(btCollisionShape *_shape)
+{
+  if(_shape==0)
+  {
+    return;
+  }
+  btBvhTriangleMeshShape *mesh;
+  if(_shape->getShapeType()==CUSTOM_CONCAVE_SHAPE_TYPE)
+  {
+    //the field shape deletes its field but not the mesh it wraps
+    mesh=static_cast<MazeSdfShape *>(_shape)->getMesh();
+    delete _shape;
+  }
+  else
+  {
+    mesh=static_cast<btBvhTriangleMeshShape *>(_shape);
+  }
+  btStridingMeshInterface *data=mesh->getMeshInterface();
+  delete mesh;
+  delete data;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+btBvhTriangleMeshShape *CollisionShape::makeMeshShape(const std::vector <MazeVertex> &_vertices, const std::vector <unsigned int> &_indices,
+                                                      bool _buildBvh)
+{
+  //bullet reads the triangles from the generator's arrays where they are
+  btIndexedMesh part;
+  part.m_numTriangles=_indices.size()/3;
+  part.m_triangleIndexBase=reinterpret_cast<const unsigned char *>(&_indices[0]);
+  part.m_triangleIndexStride=3*sizeof(unsigned int);
+  part.m_numVertices=_vertices.size();
+  part.m_vertexBase=reinterpret_cast<const unsigned char *>(&_vertices[0].x);
+  part.m_vertexStride=sizeof(MazeVertex);
+  part.m_indexType=PHY_INTEGER;
+  part.m_vertexType=PHY_FLOAT;
+  btTriangleIndexVertexArray *data=new btTriangleIndexVertexArray;
+  data->addIndexedMesh(part,PHY_INTEGER);
+
+  return new btBvhTriangleMeshShape(data, true, _buildBvh);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned long CollisionShape::meshShapeBytes(const btBvhTriangleMeshShape *_mesh)
+{
+  //the obj mazes are btTriangleMeshes, generated ones point at the generator's arrays
+  const btTriangleIndexVertexArray *data=static_cast<const btTriangleIndexVertexArray *>(_mesh->getMeshInterface());
+  const btIndexedMesh &part=data->getIndexedMeshArray()[0];
+  unsigned long bytes=part.m_numTriangles*part.m_triangleIndexStride+part.m_numVertices*part.m_vertexStride;
+  if(_mesh->getOptimizedBvh())
+  {
+    bytes+=_mesh->getOptimizedBvh()->getQuantizedNodeArray().size()*sizeof(btQuantizedBvhNode);
+  }
+  return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool CollisionShape::addGeneratedMazeSdf(const std::string & _name, const MazeGenerator &_maze)
+{
+  addGeneratedMaze(_name,_maze);
+  std::vector <ngl::Vec3> triangles;
+  _maze.getTriangles(triangles);
+  MazeSdf *sdf=new MazeSdf;
+  if(!sdf->build(triangles))
+  {
+    std::cerr<<"Unable to make a distance field for maze "<<_maze.getSeed()<<" colliding with the mesh\n";
+    delete sdf;
+    return false;
+  }
+  m_shapes[_name]=new MazeSdfShape(sdf,static_cast<btBvhTriangleMeshShape *>(m_shapes[_name]));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 btCollisionShape* CollisionShape::getShape(const std::string &_name)
 {
 	btCollisionShape *shape=0;
@@ -99,3 +210,40 @@ void CollisionShape::addBox(const std::string & _name, const std::string &_objFi
 }
 
 
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned long CollisionShape::getMemoryUsage() const
+{
+  unsigned long bytes=0;
+  std::map <std::string, btCollisionShape * >::const_iterator shapeIt;
+  for(shapeIt=m_shapes.begin(); shapeIt!=m_shapes.end(); ++shapeIt)
+  {
+    btCollisionShape *shape=shapeIt->second;
+    if(shape->getShapeType()==CUSTOM_CONCAVE_SHAPE_TYPE)
+    {
+      //the field and the mesh under it
+      MazeSdfShape *sdf=static_cast<MazeSdfShape *>(shape);
+      bytes+=sdf->getSdf()->getMemoryUsage();
+      shape=sdf->getMesh();
+    }
+    if(shape->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE)
+    {
+      bytes+=static_cast<btConvexHullShape *>(shape)->getNumPoints()*sizeof(btVector3);
+    }
+    else if(shape->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+    {
+      bytes+=meshShapeBytes(static_cast<btBvhTriangleMeshShape *>(shape));
+    }
+    else if(shape->getShapeType()==COMPOUND_SHAPE_PROXYTYPE)
+    {
+      //a streamed maze, only the chunks in at the moment
+      btCompoundShape *compound=static_cast<btCompoundShape *>(shape);
+      for(int i=0; i<compound->getNumChildShapes(); ++i)
+      {
+        bytes+=meshShapeBytes(static_cast<btBvhTriangleMeshShape *>(compound->getChildShape(i)));
+      }
+    }
+  }
+  return bytes;
+}
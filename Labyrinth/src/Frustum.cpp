@@ -0,0 +1,54 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Frustum.cpp
+/// @brief the six planes of a camera's view for throwing away boxes that can't be seen
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "Frustum.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Frustum::Frustum()
+{
+  for(int p=0; p<6; ++p)
+  {
+    m_planes[p][0]=0.0;
+    m_planes[p][1]=0.0;
+    m_planes[p][2]=0.0;
+    m_planes[p][3]=1.0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Frustum::set(const ngl::Mat4 &_mvp)
+{
+  // a point is in view when -w<=x<=w and the same for y and z, each side of that is w+x>=0 or w-x>=0
+  // and w, x, y and z are the columns of the matrix dotted with the point
+  for(int axis=0; axis<3; ++axis)
+  {
+    for(int i=0; i<4; ++i)
+    {
+      m_planes[axis*2][i]=_mvp.m_m[i][3]+_mvp.m_m[i][axis];
+      m_planes[axis*2+1][i]=_mvp.m_m[i][3]-_mvp.m_m[i][axis];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Frustum::intersects(const ngl::Vec3 &_min, const ngl::Vec3 &_max) const
+{
+  for(int p=0; p<6; ++p)
+  {
+    const float *plane=m_planes[p];
+    // the corner furthest along the plane's normal, if that is outside so is the whole box
+    float x=plane[0]>=0.0 ? _max.m_x : _min.m_x;
+    float y=plane[1]>=0.0 ? _max.m_y : _min.m_y;
+    float z=plane[2]>=0.0 ? _max.m_z : _min.m_z;
+    if(plane[0]*x+plane[1]*y+plane[2]*z+plane[3]<0.0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
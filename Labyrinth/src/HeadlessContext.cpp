@@ -0,0 +1,118 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file HeadlessContext.cpp
+/// @brief OpenGL context without a window or display for headless benchmark runs
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "HeadlessContext.h"
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <iostream>
+#include <cstring>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+HeadlessContext::HeadlessContext()
+{
+  m_display=EGL_NO_DISPLAY;
+  m_context=EGL_NO_CONTEXT;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+HeadlessContext::~HeadlessContext()
+{
+  if(m_display!=EGL_NO_DISPLAY)
+  {
+    eglMakeCurrent(m_display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+    if(m_context!=EGL_NO_CONTEXT)
+    {
+      eglDestroyContext(m_display,m_context);
+    }
+    eglTerminate(m_display);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool HeadlessContext::create()
+{
+  // prefer Mesa's surfaceless platform as it needs no display server or render node at all
+  const char *clientExtensions=eglQueryString(EGL_NO_DISPLAY,EGL_EXTENSIONS);
+  if(clientExtensions && strstr(clientExtensions,"EGL_MESA_platform_surfaceless"))
+  {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay=
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay)
+    {
+      m_display=getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,0);
+    }
+  }
+  if(m_display==EGL_NO_DISPLAY)
+  {
+    m_display=eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  EGLint major, minor;
+  if(m_display==EGL_NO_DISPLAY || !eglInitialize(m_display,&major,&minor))
+  {
+    std::cerr<<"Unable to initialise EGL\n";
+    m_display=EGL_NO_DISPLAY;
+    return false;
+  }
+  const char *extensions=eglQueryString(m_display,EGL_EXTENSIONS);
+  if(!extensions || !strstr(extensions,"EGL_KHR_surfaceless_context"))
+  {
+    std::cerr<<"EGL has no surfaceless context support\n";
+    return false;
+  }
+
+  if(!eglBindAPI(EGL_OPENGL_API))
+  {
+    std::cerr<<"EGL has no desktop OpenGL support\n";
+    return false;
+  }
+  // the surfaceless platform only offers pbuffer configs and the default is to ask for a window
+  const EGLint configAttribs[]=
+  {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint numConfigs=0;
+  if(!eglChooseConfig(m_display,configAttribs,&config,1,&numConfigs) || numConfigs==0)
+  {
+    std::cerr<<"No EGL config for desktop OpenGL\n";
+    return false;
+  }
+  // our shaders are #version 400 so ask for a 4.1 core profile like the mac build does for 3.2
+  const EGLint contextAttribs[]=
+  {
+    EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+    EGL_CONTEXT_MINOR_VERSION_KHR, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+    EGL_NONE
+  };
+  m_context=eglCreateContext(m_display,config,EGL_NO_CONTEXT,contextAttribs);
+  if(m_context==EGL_NO_CONTEXT)
+  {
+    std::cerr<<"Unable to create headless OpenGL 4.1 context\n";
+    return false;
+  }
+  if(!eglMakeCurrent(m_display,EGL_NO_SURFACE,EGL_NO_SURFACE,m_context))
+  {
+    std::cerr<<"Unable to make headless context current\n";
+    return false;
+  }
+  std::cout<<"Headless EGL "<<major<<"."<<minor<<" renderer "<<getRenderer()<<"\n";
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const char *HeadlessContext::getRenderer() const
+{
+  const GLubyte *renderer=glGetString(GL_RENDERER);
+  return renderer ? (const char *)renderer : "unknown";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
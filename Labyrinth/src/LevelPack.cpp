@@ -0,0 +1,604 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file LevelPack.cpp
+/// @brief a list of levels read from a manifest, each prepared (mesh, bvh and texture) ahead of being played
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "LevelPack.h"
+#include "CollisionShape.h"
+#include <ngl/Obj.h>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <boost/tokenizer.hpp>
+#include <boost/lexical_cast.hpp>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cache file headers
+//----------------------------------------------------------------------------------------------------------------------
+const static char MESH_MAGIC[4]={'L','M','S','H'};
+const static uint32_t MESH_VERSION=1;
+const static char BVH_MAGIC[4]={'L','B','V','H'};
+const static uint32_t BVH_VERSION=1;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief biggest mesh the caches will read, well past anything a level holds whole
+//----------------------------------------------------------------------------------------------------------------------
+const static uint32_t MAX_CACHED=1u<<24;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief thrown when a manifest line ends before all of its values
+//----------------------------------------------------------------------------------------------------------------------
+struct MissingValue {};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns the next word of a manifest line and steps past it
+/// @param[in,out] io_word the word to read
+/// @param[in] _end the end of the line
+//----------------------------------------------------------------------------------------------------------------------
+static std::string nextWord(tokenizer::iterator &io_word, const tokenizer::iterator &_end)
+{
+  if(io_word==_end)
+  {
+    throw MissingValue();
+  }
+  return *io_word++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief FNV-1a over some bytes
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t fnv1a(uint32_t _hash, const char *_data, size_t _size)
+{
+  for(size_t i=0; i<_size; ++i)
+  {
+    _hash^=(unsigned char)_data[i];
+    _hash*=16777619u;
+  }
+  return _hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief hash of a file's contents, 0 if it can't be read
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t fileKey(const std::string &_file)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return 0;
+  }
+  uint32_t hash=2166136261u;
+  char buffer[4096];
+  while(file.read(buffer,sizeof(buffer)) || file.gcount()>0)
+  {
+    hash=fnv1a(hash,buffer,file.gcount());
+  }
+  // 0 is kept for "unreadable"
+  return hash==0 ? 1 : hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Level::Level()
+{
+  m_shape=0;
+  m_bvh=0;
+  m_bvhBuffer=0;
+  m_texture=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Level::~Level()
+{
+  if(m_shape)
+  {
+    delete m_shape->getMeshInterface();
+    delete m_shape;
+  }
+  if(m_bvh)
+  {
+    // laid out in the buffer by deSerializeInPlace, its arrays don't own their memory
+    m_bvh->~btOptimizedBvh();
+    btAlignedFree(m_bvhBuffer);
+  }
+  delete m_texture;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::prepare(const LevelInfo &_info, const std::string &_cacheDir)
+{
+  m_info=_info;
+  if(!m_info.mesh.empty())
+  {
+    uint32_t key=fileKey(m_info.mesh);
+    if(key==0)
+    {
+      std::cerr<<"Unable to read level "<<m_info.name<<" maze "<<m_info.mesh<<"\n";
+      return false;
+    }
+    std::string cache=_cacheDir+m_info.name+".mesh";
+    if(!loadMesh(cache,key))
+    {
+      if(!convertObj(m_info.mesh))
+      {
+        std::cerr<<"Level "<<m_info.name<<" maze "<<m_info.mesh<<" has no faces\n";
+        return false;
+      }
+      if(!saveMesh(cache,key))
+      {
+        // not fatal, it is just converted again next time
+        std::cerr<<"Unable to write mesh cache "<<cache<<"\n";
+      }
+    }
+  }
+  else
+  {
+    MazeGenerator maze;
+    maze.generate(m_info.seed,m_info.cells,m_info.cells);
+    if(!maze.isValid())
+    {
+      std::cerr<<"Unable to generate level "<<m_info.name<<"\n";
+      return false;
+    }
+    m_mesh.vertices=maze.getVertices();
+    m_mesh.indices=maze.getIndices();
+    m_info.start=maze.getStart();
+    m_info.goal=maze.getGoal();
+    m_info.wallThickness=MazeGenerator::getWallThickness();
+  }
+
+  std::string cache=_cacheDir+m_info.name+".bvh";
+  uint32_t key=meshKey();
+  if(loadBvh(cache,key))
+  {
+    m_shape=CollisionShape::makeMeshShape(m_mesh.vertices,m_mesh.indices,false);
+    m_shape->setOptimizedBvh(m_bvh);
+  }
+  else
+  {
+    m_shape=CollisionShape::makeMeshShape(m_mesh.vertices,m_mesh.indices);
+    if(!saveBvh(cache,key))
+    {
+      std::cerr<<"Unable to write bvh cache "<<cache<<"\n";
+    }
+  }
+
+  if(!m_info.texture.empty())
+  {
+    // decoded here, only the upload is left for the render thread
+    m_texture=new ngl::Texture(m_info.texture);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::convertObj(const std::string &_objFile)
+{
+  ngl::Obj obj(_objFile);
+  std::vector <ngl::Vec3> verts=obj.getVertexList();
+  std::vector <ngl::Vec3> normals=obj.getNormalList();
+  std::vector <ngl::Vec3> uvs=obj.getTextureCordList();
+  std::vector <ngl::Face> faces=obj.getFaceList();
+  m_mesh.vertices.clear();
+  m_mesh.indices.clear();
+  for(unsigned int f=0; f<faces.size(); ++f)
+  {
+    const ngl::Face &face=faces[f];
+    if(face.m_vert.size()<3)
+    {
+      continue;
+    }
+    // faces without normals get the face's own
+    ngl::Vec3 edge1=verts[face.m_vert[1]]-verts[face.m_vert[0]];
+    ngl::Vec3 edge2=verts[face.m_vert[2]]-verts[face.m_vert[0]];
+    ngl::Vec3 flat=edge1.cross(edge2);
+    if(flat.length()>0.0)
+    {
+      flat.normalize();
+    }
+    unsigned int first=m_mesh.vertices.size();
+    for(unsigned int k=0; k<face.m_vert.size(); ++k)
+    {
+      MazeVertex v;
+      const ngl::Vec3 &p=verts[face.m_vert[k]];
+      v.x=p.m_x;
+      v.y=p.m_y;
+      v.z=p.m_z;
+      v.u=0.0;
+      v.v=0.0;
+      if(face.m_textureCoord && k<face.m_tex.size())
+      {
+        v.u=uvs[face.m_tex[k]].m_x;
+        v.v=uvs[face.m_tex[k]].m_y;
+      }
+      ngl::Vec3 n= face.m_normals && k<face.m_norm.size() ? normals[face.m_norm[k]] : flat;
+      v.nx=n.m_x;
+      v.ny=n.m_y;
+      v.nz=n.m_z;
+      m_mesh.vertices.push_back(v);
+    }
+    for(unsigned int k=1; k+1<face.m_vert.size(); ++k)
+    {
+      m_mesh.indices.push_back(first);
+      m_mesh.indices.push_back(first+k);
+      m_mesh.indices.push_back(first+k+1);
+    }
+  }
+  return !m_mesh.indices.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::saveMesh(const std::string &_file, uint32_t _key) const
+{
+  std::ofstream file(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open() || m_mesh.indices.empty())
+  {
+    return false;
+  }
+  uint32_t header[4]={MESH_VERSION,_key,uint32_t(m_mesh.vertices.size()),uint32_t(m_mesh.indices.size())};
+  file.write(MESH_MAGIC,sizeof(MESH_MAGIC));
+  file.write(reinterpret_cast<const char *>(header),sizeof(header));
+  file.write(reinterpret_cast<const char *>(&m_mesh.vertices[0]),m_mesh.vertices.size()*sizeof(MazeVertex));
+  file.write(reinterpret_cast<const char *>(&m_mesh.indices[0]),m_mesh.indices.size()*sizeof(unsigned int));
+  return file.good();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::loadMesh(const std::string &_file, uint32_t _key)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  char magic[4];
+  uint32_t header[4];
+  file.read(magic,sizeof(magic));
+  file.read(reinterpret_cast<char *>(header),sizeof(header));
+  if(!file || memcmp(magic,MESH_MAGIC,sizeof(magic))!=0 || header[0]!=MESH_VERSION || header[1]!=_key ||
+     header[2]==0 || header[3]==0 || header[2]>MAX_CACHED || header[3]>MAX_CACHED || header[3]%3!=0)
+  {
+    return false;
+  }
+  MazeMesh mesh;
+  mesh.vertices.resize(header[2]);
+  mesh.indices.resize(header[3]);
+  file.read(reinterpret_cast<char *>(&mesh.vertices[0]),mesh.vertices.size()*sizeof(MazeVertex));
+  file.read(reinterpret_cast<char *>(&mesh.indices[0]),mesh.indices.size()*sizeof(unsigned int));
+  if(!file)
+  {
+    return false;
+  }
+  for(unsigned int i=0; i<mesh.indices.size(); ++i)
+  {
+    if(mesh.indices[i]>=mesh.vertices.size())
+    {
+      return false;
+    }
+  }
+  m_mesh.vertices.swap(mesh.vertices);
+  m_mesh.indices.swap(mesh.indices);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+uint32_t Level::meshKey() const
+{
+  uint32_t hash=2166136261u;
+  hash=fnv1a(hash,reinterpret_cast<const char *>(&m_mesh.vertices[0]),m_mesh.vertices.size()*sizeof(MazeVertex));
+  hash=fnv1a(hash,reinterpret_cast<const char *>(&m_mesh.indices[0]),m_mesh.indices.size()*sizeof(unsigned int));
+  // the layout of a serialized bvh depends on how bullet was built
+  uint32_t settings[2]={BVH_VERSION,uint32_t(sizeof(btScalar))};
+  hash=fnv1a(hash,reinterpret_cast<const char *>(settings),sizeof(settings));
+  return hash==0 ? 1 : hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::saveBvh(const std::string &_file, uint32_t _key) const
+{
+  const btOptimizedBvh *bvh=m_shape->getOptimizedBvh();
+  if(!bvh)
+  {
+    return false;
+  }
+  std::ofstream file(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  uint32_t size=bvh->calculateSerializeBufferSize();
+  void *buffer=btAlignedAlloc(size,16);
+  bool good=bvh->serializeInPlace(buffer,size,false);
+  if(good)
+  {
+    uint32_t header[3]={BVH_VERSION,_key,size};
+    file.write(BVH_MAGIC,sizeof(BVH_MAGIC));
+    file.write(reinterpret_cast<const char *>(header),sizeof(header));
+    file.write(static_cast<const char *>(buffer),size);
+    good=file.good();
+  }
+  btAlignedFree(buffer);
+  return good;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Level::loadBvh(const std::string &_file, uint32_t _key)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  char magic[4];
+  uint32_t header[3];
+  file.read(magic,sizeof(magic));
+  file.read(reinterpret_cast<char *>(header),sizeof(header));
+  if(!file || memcmp(magic,BVH_MAGIC,sizeof(magic))!=0 || header[0]!=BVH_VERSION || header[1]!=_key ||
+     header[2]==0 || header[2]>MAX_CACHED*sizeof(btQuantizedBvhNode))
+  {
+    return false;
+  }
+  // the nodes are used where they are read so the buffer has to be aligned as bullet wants
+  void *buffer=btAlignedAlloc(header[2],16);
+  file.read(static_cast<char *>(buffer),header[2]);
+  btOptimizedBvh *bvh= file ? btOptimizedBvh::deSerializeInPlace(buffer,header[2],false) : 0;
+  if(!bvh)
+  {
+    btAlignedFree(buffer);
+    return false;
+  }
+  m_bvh=bvh;
+  m_bvhBuffer=buffer;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Level::getTriangles(std::vector <ngl::Vec3> &o_triangles) const
+{
+  o_triangles.clear();
+  o_triangles.reserve(m_mesh.indices.size());
+  for(unsigned int i=0; i<m_mesh.indices.size(); ++i)
+  {
+    const MazeVertex &v=m_mesh.vertices[m_mesh.indices[i]];
+    o_triangles.push_back(ngl::Vec3(v.x,v.y,v.z));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned long Level::getMemoryUsage() const
+{
+  unsigned long bytes=m_mesh.vertices.size()*sizeof(MazeVertex)+m_mesh.indices.size()*sizeof(unsigned int);
+  if(m_shape && m_shape->getOptimizedBvh())
+  {
+    bytes+=m_shape->getOptimizedBvh()->getQuantizedNodeArray().size()*sizeof(btQuantizedBvhNode);
+  }
+  return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LevelPack::LevelPack()
+{
+  m_thread=0;
+  SDL_AtomicSet(&m_done,0);
+  m_prefetchLevel=-1;
+  m_prefetched=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LevelPack::~LevelPack()
+{
+  wait();
+  delete m_prefetched;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool LevelPack::load(const std::string &_manifest, const LevelInfo &_defaults)
+{
+  std::fstream fileIn;
+  fileIn.open(_manifest.c_str(),std::ios::in);
+  if (!fileIn.is_open())
+  {
+    std::cerr<<"Level pack : "<<_manifest<<" Not found\n";
+    return false;
+  }
+  size_t slash=_manifest.find_last_of('/');
+  m_cacheDir= slash==std::string::npos ? std::string() : _manifest.substr(0,slash+1);
+  m_levels.clear();
+  std::string lineBuffer;
+  boost::char_separator<char> sep(" \t\r\n");
+
+  while(getline(fileIn, lineBuffer, '\n'))
+  {
+    tokenizer tokens(lineBuffer, sep);
+    tokenizer::iterator word = tokens.begin();
+    if(word==tokens.end() || (*word)[0]=='#')
+    {
+      continue;
+    }
+    try
+    {
+      std::string command=nextWord(word,tokens.end());
+      if(command == "Level")
+      {
+        LevelInfo level=_defaults;
+        level.name=nextWord(word,tokens.end());
+        m_levels.push_back(level);
+        continue;
+      }
+      if(m_levels.empty())
+      {
+        std::cerr<<"level pack "<<command<<" before the first Level\n";
+        return false;
+      }
+      LevelInfo &level=m_levels.back();
+      if(command == "Mesh")
+      {
+        level.mesh = nextWord(word,tokens.end());
+      }
+      else if(command == "Seed")
+      {
+        level.seed = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Cells")
+      {
+        level.cells = boost::lexical_cast<unsigned int>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Texture")
+      {
+        level.texture = nextWord(word,tokens.end());
+      }
+      else if(command == "Start" || command == "Goal")
+      {
+        ngl::Vec3 &p= command=="Start" ? level.start : level.goal;
+        p.m_x = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+        p.m_y = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+        p.m_z = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Gravity")
+      {
+        level.gravity = boost::lexical_cast<int>(nextWord(word,tokens.end()));
+      }
+      else if(command == "Friction")
+      {
+        level.friction = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+      }
+      else if(command == "WallThickness")
+      {
+        level.wallThickness = boost::lexical_cast<float>(nextWord(word,tokens.end()));
+        if(level.wallThickness<=0.0)
+        {
+          std::cerr<<"wall thickness has to be above 0 in level "<<level.name<<"\n";
+          return false;
+        }
+      }
+      else if(command == "BallCollisions")
+      {
+        level.ballCollisions = boost::lexical_cast<int>(nextWord(word,tokens.end()))!=0;
+      }
+      else if(command == "Broadphase")
+      {
+        std::string name=nextWord(word,tokens.end());
+        if(!PhysicsWorld::broadphaseFromName(name,level.broadphase))
+        {
+          std::cerr<<"unknown broadphase "<<name<<" in level "<<level.name<<"\n";
+          return false;
+        }
+      }
+      else if(command == "Surface")
+      {
+        std::string name=nextWord(word,tokens.end());
+        if(!MaterialTable::materialFromName(name,level.surface))
+        {
+          std::cerr<<"unknown surface "<<name<<" in level "<<level.name<<"\n";
+          return false;
+        }
+      }
+      else
+      {
+        std::cerr<<"unknown level pack command "<<command<<"\n";
+        return false;
+      }
+    }
+    catch(...)
+    {
+      std::cerr<<"bad level pack line : "<<lineBuffer<<"\n";
+      return false;
+    }
+  }
+  for(unsigned int i=0; i<m_levels.size(); ++i)
+  {
+    if(m_levels[i].mesh.empty() && (m_levels[i].seed==0 || m_levels[i].cells==0))
+    {
+      std::cerr<<"Level "<<m_levels[i].name<<" needs a Mesh or a Seed and Cells\n";
+      return false;
+    }
+  }
+  return !m_levels.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void LevelPack::prefetch(unsigned int _level)
+{
+  wait();
+  if(m_prefetched && m_prefetchLevel==int(_level))
+  {
+    return;
+  }
+  delete m_prefetched;
+  m_prefetched=new Level;
+  m_prefetchLevel=_level;
+  SDL_AtomicSet(&m_done,0);
+  m_thread=SDL_CreateThread(prefetchMain,"levels",this);
+  if(!m_thread)
+  {
+    // not fatal, take prepares it instead
+    std::cerr<<"Unable to create level prefetch thread "<<SDL_GetError()<<"\n";
+    delete m_prefetched;
+    m_prefetched=0;
+    m_prefetchLevel=-1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int LevelPack::prefetchMain(void *_pack)
+{
+  LevelPack *pack=static_cast<LevelPack *>(_pack);
+  pack->m_prefetched->prepare(pack->m_levels[pack->m_prefetchLevel],pack->m_cacheDir);
+  SDL_AtomicSet(&pack->m_done,1);
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void LevelPack::wait()
+{
+  if(m_thread)
+  {
+    SDL_WaitThread(m_thread,0);
+    m_thread=0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Level *LevelPack::take(unsigned int _level)
+{
+  wait();
+  Level *level=0;
+  if(m_prefetched && m_prefetchLevel==int(_level))
+  {
+    level=m_prefetched;
+    m_prefetched=0;
+    m_prefetchLevel=-1;
+    SDL_AtomicSet(&m_done,0);
+  }
+  else
+  {
+    level=new Level;
+    level->prepare(m_levels[_level],m_cacheDir);
+  }
+  if(!level->isValid())
+  {
+    delete level;
+    return 0;
+  }
+  return level;
+}
@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MaterialTable.cpp
+/// @brief surface materials and the table of combined contact properties for each pair of them
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MaterialTable.h"
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MaterialTable *MaterialTable::s_instance=0;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MaterialTable *MaterialTable::instance()
+{
+  if(s_instance==0)
+  {
+    s_instance=new MaterialTable;
+  }
+  return s_instance;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MaterialTable::MaterialTable()
+{
+  setDefaults(0.3);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MaterialTable::setDefaults(float _friction)
+{
+  // properties of each surface on its own, pairs combine them the way bullet does (multiplied,
+  // friction capped at 10) so the defaults play as they did when friction was set per body
+  MaterialPair base[MATERIALS];
+  MaterialPair d={0.5,0.0,0.0};
+  for(int i=0; i<MATERIALS; ++i)
+  {
+    base[i]=d;
+  }
+  base[MATERIAL_BALL].friction=_friction;
+  base[MATERIAL_GROUND].friction=1.0;
+  base[MATERIAL_GROUND].rollingFriction=2.0;
+  base[MATERIAL_GOAL].friction=100.5;
+  // the maze is kept slippery so the ball rolls rather than sticks
+  base[MATERIAL_WOOD].friction=_friction/10;
+  base[MATERIAL_ICE].friction=0.0;
+  base[MATERIAL_CARPET].friction=3.0;
+
+  for(int a=0; a<MATERIALS; ++a)
+  {
+    for(int b=0; b<MATERIALS; ++b)
+    {
+      MaterialPair &p=m_pairs[a][b];
+      p.friction=std::min(base[a].friction*base[b].friction,10.0f);
+      p.restitution=base[a].restitution*base[b].restitution;
+      p.rollingFriction=base[a].rollingFriction*base[b].rollingFriction;
+    }
+  }
+  // carpet drags on a rolling ball as well as a sliding one
+  setPair(MATERIAL_BALL,MATERIAL_CARPET,std::min(_friction*3.0f,10.0f),0.0,0.05);
+  // and ice gives a little bounce
+  setPair(MATERIAL_BALL,MATERIAL_ICE,0.0,0.2,0.0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MaterialTable::setPair(int _a, int _b, float _friction, float _restitution, float _rollingFriction)
+{
+  if((unsigned int)_a>=MATERIALS || (unsigned int)_b>=MATERIALS)
+  {
+    return;
+  }
+  MaterialPair p={_friction,_restitution,_rollingFriction};
+  m_pairs[_a][_b]=p;
+  m_pairs[_b][_a]=p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const char *s_materialNames[MATERIALS]={"default","ball","ground","goal","wood","ice","carpet"};
+
+const char *MaterialTable::materialName(int _material)
+{
+  return (unsigned int)_material<MATERIALS ? s_materialNames[_material] : "unknown";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MaterialTable::materialFromName(const std::string &_name, MaterialId &o_material)
+{
+  for(int i=0; i<MATERIALS; ++i)
+  {
+    if(_name==s_materialNames[i])
+    {
+      o_material=MaterialId(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,331 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeChunks.cpp
+/// @brief collision for big generated mazes, only the chunks near the balls are kept in
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MazeChunks.h"
+#include "CollisionShape.h"
+#include <iostream>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a chunk comes in when a ball is this close to it and goes out when every ball is further
+/// than EVICT_DISTANCE, a cell and two cells
+//----------------------------------------------------------------------------------------------------------------------
+const static float LOAD_DISTANCE=6.0;
+const static float EVICT_DISTANCE=12.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief chunks this close to a ball are built ahead, short of EVICT_DISTANCE so they aren't
+/// thrown away as soon as they are built
+//----------------------------------------------------------------------------------------------------------------------
+const static float PREFETCH_DISTANCE=10.0;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeChunkShape::MazeChunkShape(const btVector3 &_min, const btVector3 &_max) : btCompoundShape(true)
+{
+  m_boundsMin=_min;
+  m_boundsMax=_max;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunkShape::getAabb(const btTransform &_t, btVector3 &o_min, btVector3 &o_max) const
+{
+  btTransformAabb(m_boundsMin,m_boundsMax,getMargin(),_t,o_min,o_max);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeChunks::MazeChunks(const MazeGenerator *_maze)
+{
+  m_maze=_maze;
+  m_built=0;
+  m_thread=0;
+  SDL_AtomicSet(&m_done,0);
+  // the first and last chunks hold the corners of the maze
+  ngl::Vec3 min, max, unused;
+  _maze->getChunkBounds(0,min,unused);
+  _maze->getChunkBounds(_maze->getNumChunks()-1,unused,max);
+  m_shape=new MazeChunkShape(btVector3(min.m_x,min.m_y,min.m_z),btVector3(max.m_x,max.m_y,max.m_z));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeChunks::~MazeChunks()
+{
+  wait();
+  for(unsigned int c=0; c<m_building.size(); ++c)
+  {
+    freeChunk(m_building[c]);
+  }
+  for(unsigned int c=0; c<m_ready.size(); ++c)
+  {
+    freeChunk(m_ready[c]);
+  }
+  while(!m_chunks.empty())
+  {
+    throwOut(m_chunks.size()-1);
+  }
+  delete m_shape;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeChunks::update(const btTransform &_maze, const std::vector <btVector3> &_balls)
+{
+  m_local.resize(_balls.size());
+  for(unsigned int i=0; i<_balls.size(); ++i)
+  {
+    m_local[i]=_maze.invXform(_balls[i]);
+  }
+
+  bool changed=false;
+  // out first so a chunk a ball has left and come back to in one tick isn't built twice
+  for(unsigned int c=0; c<m_chunks.size();)
+  {
+    if(nearBall(m_chunks[c],EVICT_DISTANCE))
+    {
+      ++c;
+      continue;
+    }
+    throwOut(c);
+    changed=true;
+  }
+  collectPrefetch();
+  for(unsigned int c=0; c<m_ready.size();)
+  {
+    if(nearBall(m_ready[c],EVICT_DISTANCE))
+    {
+      ++c;
+      continue;
+    }
+    freeChunk(m_ready[c]);
+    m_ready[c]=m_ready.back();
+    m_ready.pop_back();
+  }
+
+  for(unsigned int i=0; i<m_local.size(); ++i)
+  {
+    const btVector3 &p=m_local[i];
+    unsigned int x0, z0, x1, z1;
+    if(!m_maze->getChunkRange(p.x()-LOAD_DISTANCE,p.z()-LOAD_DISTANCE,p.x()+LOAD_DISTANCE,p.z()+LOAD_DISTANCE,x0,z0,x1,z1))
+    {
+      continue;
+    }
+    for(unsigned int z=z0; z<=z1; ++z)
+    {
+      for(unsigned int x=x0; x<=x1; ++x)
+      {
+        unsigned int index=z*m_maze->getChunksX()+x;
+        if(findChunk(m_chunks,index)<0)
+        {
+          bringIn(index);
+          changed=true;
+        }
+      }
+    }
+  }
+  startPrefetch();
+  return changed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::bringIn(unsigned int _index)
+{
+  Chunk chunk;
+  int ready=findChunk(m_ready,_index);
+  if(ready>=0)
+  {
+    chunk=m_ready[ready];
+    m_ready[ready]=m_ready.back();
+    m_ready.pop_back();
+  }
+  else
+  {
+    // the ball got here ahead of the prefetch
+    chunk.index=_index;
+    build(chunk);
+    ++m_built;
+  }
+  btTransform identity;
+  identity.setIdentity();
+  m_shape->addChildShape(identity,chunk.shape);
+  m_chunks.push_back(chunk);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::throwOut(unsigned int _resident)
+{
+  Chunk &chunk=m_chunks[_resident];
+  m_shape->removeChildShape(chunk.shape);
+  freeChunk(chunk);
+  chunk=m_chunks.back();
+  m_chunks.pop_back();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::build(Chunk &io_chunk) const
+{
+  io_chunk.mesh=new MazeMesh;
+  m_maze->buildChunk(io_chunk.index,*io_chunk.mesh);
+  io_chunk.shape=CollisionShape::makeMeshShape(io_chunk.mesh->vertices,io_chunk.mesh->indices);
+  ngl::Vec3 min, max;
+  m_maze->getChunkBounds(io_chunk.index,min,max);
+  io_chunk.min.setValue(min.m_x,min.m_y,min.m_z);
+  io_chunk.max.setValue(max.m_x,max.m_y,max.m_z);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::freeChunk(Chunk &_chunk)
+{
+  delete _chunk.shape->getMeshInterface();
+  delete _chunk.shape;
+  delete _chunk.mesh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int MazeChunks::findChunk(const std::vector <Chunk> &_chunks, unsigned int _index)
+{
+  for(unsigned int c=0; c<_chunks.size(); ++c)
+  {
+    if(_chunks[c].index==_index)
+    {
+      return c;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeChunks::nearBall(const Chunk &_chunk, float _distance) const
+{
+  for(unsigned int i=0; i<m_local.size(); ++i)
+  {
+    btVector3 closest=m_local[i];
+    closest.setMax(_chunk.min);
+    closest.setMin(_chunk.max);
+    if(closest.distance2(m_local[i])<_distance*_distance)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::collectPrefetch()
+{
+  if(!m_thread || !SDL_AtomicGet(&m_done))
+  {
+    return;
+  }
+  wait();
+  m_built+=m_building.size();
+  for(unsigned int c=0; c<m_building.size(); ++c)
+  {
+    // a ball that outran the prefetch had it built in bringIn already
+    if(findChunk(m_chunks,m_building[c].index)>=0)
+    {
+      freeChunk(m_building[c]);
+    }
+    else
+    {
+      m_ready.push_back(m_building[c]);
+    }
+  }
+  m_building.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::startPrefetch()
+{
+  if(m_thread)
+  {
+    return;
+  }
+  for(unsigned int i=0; i<m_local.size(); ++i)
+  {
+    const btVector3 &p=m_local[i];
+    unsigned int x0, z0, x1, z1;
+    if(!m_maze->getChunkRange(p.x()-PREFETCH_DISTANCE,p.z()-PREFETCH_DISTANCE,p.x()+PREFETCH_DISTANCE,p.z()+PREFETCH_DISTANCE,
+                              x0,z0,x1,z1))
+    {
+      continue;
+    }
+    for(unsigned int z=z0; z<=z1; ++z)
+    {
+      for(unsigned int x=x0; x<=x1; ++x)
+      {
+        unsigned int index=z*m_maze->getChunksX()+x;
+        if(findChunk(m_chunks,index)<0 && findChunk(m_ready,index)<0 && findChunk(m_building,index)<0)
+        {
+          Chunk chunk;
+          chunk.index=index;
+          chunk.mesh=0;
+          chunk.shape=0;
+          m_building.push_back(chunk);
+        }
+      }
+    }
+  }
+  if(m_building.empty())
+  {
+    return;
+  }
+  SDL_AtomicSet(&m_done,0);
+  m_thread=SDL_CreateThread(prefetchMain,"chunks",this);
+  if(!m_thread)
+  {
+    // not fatal, bringIn builds them instead
+    std::cerr<<"Unable to create chunk prefetch thread "<<SDL_GetError()<<"\n";
+    m_building.clear();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int MazeChunks::prefetchMain(void *_chunks)
+{
+  MazeChunks *chunks=static_cast<MazeChunks *>(_chunks);
+  for(unsigned int c=0; c<chunks->m_building.size(); ++c)
+  {
+    chunks->build(chunks->m_building[c]);
+  }
+  SDL_AtomicSet(&chunks->m_done,1);
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeChunks::wait()
+{
+  if(m_thread)
+  {
+    SDL_WaitThread(m_thread,0);
+    m_thread=0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned long MazeChunks::getMemoryUsage() const
+{
+  unsigned long bytes=0;
+  for(unsigned int c=0; c<m_chunks.size(); ++c)
+  {
+    bytes+=CollisionShape::meshShapeBytes(m_chunks[c].shape);
+  }
+  for(unsigned int c=0; c<m_ready.size(); ++c)
+  {
+    bytes+=CollisionShape::meshShapeBytes(m_ready[c].shape);
+  }
+  return bytes;
+}
@@ -0,0 +1,527 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeGenerator.cpp
+/// @brief seeded random mazes built straight into render and collision arrays
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MazeGenerator.h"
+#include <cmath>
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief distance between the centres of neighbouring cells and the thickness of the walls, the
+/// gap between walls is a little wider than the goal so the cube fits in a cell
+//----------------------------------------------------------------------------------------------------------------------
+const static float CELL_SIZE=6.0;
+const static float WALL_THICKNESS=2.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief heights of the top of the floor and the tops of the walls, as in mazev3.obj
+//----------------------------------------------------------------------------------------------------------------------
+const static float FLOOR_HEIGHT=2.0;
+const static float WALL_HEIGHT=5.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief width of the hole over the goal, the size of the cube so it fills the hole
+//----------------------------------------------------------------------------------------------------------------------
+const static float HOLE_SIZE=3.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief distance the wood texture covers before repeating
+//----------------------------------------------------------------------------------------------------------------------
+const static float TEXTURE_SIZE=20.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cells along each side of a chunk
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int CHUNK_CELLS=8;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief bits of m_open
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned char OPEN_X=1;
+const static unsigned char OPEN_Z=2;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a floor vertex that hasn't been made yet
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int NO_VERTEX=0xffffffff;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeGenerator::MazeGenerator()
+{
+  m_seed=0;
+  m_width=0;
+  m_depth=0;
+  m_goalCell=0;
+  m_random=1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+float MazeGenerator::getCellSize()
+{
+  return CELL_SIZE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+float MazeGenerator::getWallThickness()
+{
+  return WALL_THICKNESS;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int MazeGenerator::getChunkCells()
+{
+  return CHUNK_CELLS;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int MazeGenerator::random()
+{
+  m_random^=m_random<<13;
+  m_random^=m_random>>17;
+  m_random^=m_random<<5;
+  return m_random;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::generate(unsigned int _seed, unsigned int _width, unsigned int _depth, bool _buildMesh)
+{
+  m_seed=_seed;
+  m_width=_width;
+  m_depth=_depth;
+  m_mesh.vertices.clear();
+  m_mesh.indices.clear();
+  m_open.clear();
+  if(_width==0 || _depth==0)
+  {
+    return;
+  }
+  // spread the seed out so neighbouring seeds don't start the same, xorshift can't have 0
+  m_random=(_seed*2654435761u)^0x9e3779b9u;
+  if(m_random==0)
+  {
+    m_random=1;
+  }
+  for(int i=0; i<4; ++i)
+  {
+    random();
+  }
+
+  carve();
+  unsigned int goalX=m_goalCell%m_width;
+  unsigned int goalZ=m_goalCell/m_width;
+  m_start.set((0.5f-0.5f*m_width)*CELL_SIZE,WALL_HEIGHT,(0.5f-0.5f*m_depth)*CELL_SIZE);
+  m_goal.set((goalX+0.5f-0.5f*m_width)*CELL_SIZE,FLOOR_HEIGHT,(goalZ+0.5f-0.5f*m_depth)*CELL_SIZE);
+
+  if(_buildMesh)
+  {
+    // a random maze comes to about 20 vertices and 12 triangles a cell, with room for the hole
+    m_mesh.vertices.reserve(22*m_width*m_depth+64);
+    m_mesh.indices.reserve(40*m_width*m_depth+96);
+    buildBlocks(0,0,2*m_width+1,2*m_depth+1,m_mesh);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::chunkBlocks(unsigned int _chunk, unsigned int &o_i0, unsigned int &o_j0, unsigned int &o_i1, unsigned int &o_j1) const
+{
+  unsigned int x=_chunk%getChunksX();
+  unsigned int z=_chunk/getChunksX();
+  // a chunk has the posts and walls on its -x and -z sides, the last ones take the outside walls too
+  o_i0=2*x*CHUNK_CELLS;
+  o_j0=2*z*CHUNK_CELLS;
+  o_i1=2*std::min((x+1)*CHUNK_CELLS,m_width);
+  o_j1=2*std::min((z+1)*CHUNK_CELLS,m_depth);
+  o_i1+= o_i1==2*m_width ? 1 : 0;
+  o_j1+= o_j1==2*m_depth ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::getChunkBounds(unsigned int _chunk, ngl::Vec3 &o_min, ngl::Vec3 &o_max) const
+{
+  unsigned int i0, j0, i1, j1;
+  chunkBlocks(_chunk,i0,j0,i1,j1);
+  o_min.set(blockEdge(i0,m_width),0.0,blockEdge(j0,m_depth));
+  o_max.set(blockEdge(i1,m_width),WALL_HEIGHT,blockEdge(j1,m_depth));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeGenerator::getChunkRange(float _minX, float _minZ, float _maxX, float _maxZ, unsigned int &o_x0, unsigned int &o_z0,
+                                  unsigned int &o_x1, unsigned int &o_z1) const
+{
+  if(m_open.empty())
+  {
+    return false;
+  }
+  // chunks all start a whole number of chunk widths from the outside of the first wall
+  float originX=blockEdge(0,m_width);
+  float originZ=blockEdge(0,m_depth);
+  if(_maxX<originX || _maxZ<originZ || _minX>blockEdge(2*m_width+1,m_width) || _minZ>blockEdge(2*m_depth+1,m_depth))
+  {
+    return false;
+  }
+  // the last chunks take the outside walls as well so reach a little past a whole chunk width
+  float size=CHUNK_CELLS*CELL_SIZE;
+  int lastX=getChunksX()-1;
+  int lastZ=getChunksZ()-1;
+  o_x0=std::max(0,std::min(lastX,int(floor((_minX-originX)/size))));
+  o_z0=std::max(0,std::min(lastZ,int(floor((_minZ-originZ)/size))));
+  o_x1=std::max(0,std::min(lastX,int(floor((_maxX-originX)/size))));
+  o_z1=std::max(0,std::min(lastZ,int(floor((_maxZ-originZ)/size))));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::buildChunk(unsigned int _chunk, MazeMesh &o_mesh) const
+{
+  o_mesh.vertices.clear();
+  o_mesh.indices.clear();
+  if(m_open.empty())
+  {
+    return;
+  }
+  unsigned int i0, j0, i1, j1;
+  chunkBlocks(_chunk,i0,j0,i1,j1);
+  buildBlocks(i0,j0,i1,j1,o_mesh);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::carve()
+{
+  unsigned int cells=m_width*m_depth;
+  m_open.assign(cells,0);
+  std::vector <unsigned char> visited(cells,0);
+  // the backtracker's path from the start, kept as a stack rather than recursing so big mazes
+  // can't run out of stack. How deep it is when a cell is reached is how far along the maze the
+  // cell is, the deepest is the goal
+  std::vector <unsigned int> path;
+  path.reserve(cells);
+  path.push_back(0);
+  visited[0]=1;
+  m_goalCell=0;
+  size_t deepest=1;
+  while(!path.empty())
+  {
+    unsigned int cell=path.back();
+    unsigned int x=cell%m_width;
+    unsigned int z=cell/m_width;
+    unsigned int next[4];
+    unsigned int count=0;
+    if(x+1<m_width && !visited[cell+1])
+    {
+      next[count++]=cell+1;
+    }
+    if(x>0 && !visited[cell-1])
+    {
+      next[count++]=cell-1;
+    }
+    if(z+1<m_depth && !visited[cell+m_width])
+    {
+      next[count++]=cell+m_width;
+    }
+    if(z>0 && !visited[cell-m_width])
+    {
+      next[count++]=cell-m_width;
+    }
+    if(count==0)
+    {
+      path.pop_back();
+      continue;
+    }
+    unsigned int n=next[random()%count];
+    // the wall between two cells belongs to the one with the lower x or z
+    if(n==cell+1)
+    {
+      m_open[cell]|=OPEN_X;
+    }
+    else if(n+1==cell)
+    {
+      m_open[n]|=OPEN_X;
+    }
+    else if(n==cell+m_width)
+    {
+      m_open[cell]|=OPEN_Z;
+    }
+    else
+    {
+      m_open[n]|=OPEN_Z;
+    }
+    visited[n]=1;
+    path.push_back(n);
+    if(path.size()>deepest)
+    {
+      deepest=path.size();
+      m_goalCell=n;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeGenerator::solid(unsigned int _i, unsigned int _j) const
+{
+  bool wallX=(_i&1)==0;
+  bool wallZ=(_j&1)==0;
+  if(wallX && wallZ)
+  {
+    return true;
+  }
+  if(!wallX && !wallZ)
+  {
+    return false;
+  }
+  if(wallX)
+  {
+    // a wall along z between the cells either side of it, the outside ones always stand
+    unsigned int k=_i/2;
+    if(k==0 || k==m_width)
+    {
+      return true;
+    }
+    return (m_open[(_j/2)*m_width+k-1]&OPEN_X)==0;
+  }
+  unsigned int k=_j/2;
+  if(k==0 || k==m_depth)
+  {
+    return true;
+  }
+  return (m_open[(k-1)*m_width+_i/2]&OPEN_Z)==0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+float MazeGenerator::blockEdge(unsigned int _i, unsigned int _cells)
+{
+  // even blocks are walls centred on the lines between cells, odd ones the cells between them
+  float line=(float(_i/2)-0.5f*_cells)*CELL_SIZE;
+  return (_i&1) ? line+0.5f*WALL_THICKNESS : line-0.5f*WALL_THICKNESS;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int MazeGenerator::addVertex(MazeMesh &o_mesh, float _x, float _y, float _z, const ngl::Vec3 &_normal)
+{
+  MazeVertex v;
+  v.x=_x;
+  v.y=_y;
+  v.z=_z;
+  // planar mapping onto whichever axis the face looks along
+  if(fabs(_normal.m_y)>0.5)
+  {
+    v.u=_x/TEXTURE_SIZE;
+    v.v=_z/TEXTURE_SIZE;
+  }
+  else if(fabs(_normal.m_x)>0.5)
+  {
+    v.u=_z/TEXTURE_SIZE;
+    v.v=_y/TEXTURE_SIZE;
+  }
+  else
+  {
+    v.u=_x/TEXTURE_SIZE;
+    v.v=_y/TEXTURE_SIZE;
+  }
+  v.nx=_normal.m_x;
+  v.ny=_normal.m_y;
+  v.nz=_normal.m_z;
+  o_mesh.vertices.push_back(v);
+  return o_mesh.vertices.size()-1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::addQuad(MazeMesh &o_mesh, unsigned int _a, unsigned int _b, unsigned int _c, unsigned int _d)
+{
+  o_mesh.indices.push_back(_a);
+  o_mesh.indices.push_back(_b);
+  o_mesh.indices.push_back(_c);
+  o_mesh.indices.push_back(_a);
+  o_mesh.indices.push_back(_c);
+  o_mesh.indices.push_back(_d);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::addFace(MazeMesh &o_mesh, const ngl::Vec3 &_a, const ngl::Vec3 &_b, const ngl::Vec3 &_c, const ngl::Vec3 &_d,
+                            const ngl::Vec3 &_normal)
+{
+  unsigned int a=addVertex(o_mesh,_a.m_x,_a.m_y,_a.m_z,_normal);
+  unsigned int b=addVertex(o_mesh,_b.m_x,_b.m_y,_b.m_z,_normal);
+  unsigned int c=addVertex(o_mesh,_c.m_x,_c.m_y,_c.m_z,_normal);
+  unsigned int d=addVertex(o_mesh,_d.m_x,_d.m_y,_d.m_z,_normal);
+  addQuad(o_mesh,a,b,c,d);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::buildBlocks(unsigned int _i0, unsigned int _j0, unsigned int _i1, unsigned int _j1, MazeMesh &o_mesh) const
+{
+  ngl::Vec3 up(0,1,0);
+  ngl::Vec3 down(0,-1,0);
+  unsigned int goalI=2*(m_goalCell%m_width)+1;
+  unsigned int goalJ=2*(m_goalCell/m_width)+1;
+  bool hasGoal=goalI>=_i0 && goalI<_i1 && goalJ>=_j0 && goalJ<_j1;
+  float hx0=m_goal.m_x-0.5f*HOLE_SIZE;
+  float hx1=m_goal.m_x+0.5f*HOLE_SIZE;
+  float hz0=m_goal.m_z-0.5f*HOLE_SIZE;
+  float hz1=m_goal.m_z+0.5f*HOLE_SIZE;
+
+  // the top of the floor is only under the cells and the gaps between them, the walls cover the
+  // rest. Neighbouring blocks share the vertices at their corners
+  unsigned int pointsX=_i1-_i0+1;
+  std::vector <unsigned int> lattice(pointsX*(_j1-_j0+1),NO_VERTEX);
+  for(unsigned int j=_j0; j<_j1; ++j)
+  {
+    for(unsigned int i=_i0; i<_i1; ++i)
+    {
+      if(solid(i,j))
+      {
+        continue;
+      }
+      unsigned int corner[4];
+      unsigned int li=i-_i0;
+      unsigned int lj=j-_j0;
+      unsigned int points[4]={lj*pointsX+li,(lj+1)*pointsX+li,(lj+1)*pointsX+li+1,lj*pointsX+li+1};
+      for(int k=0; k<4; ++k)
+      {
+        unsigned int &p=lattice[points[k]];
+        if(p==NO_VERTEX)
+        {
+          unsigned int pi=_i0+points[k]%pointsX;
+          unsigned int pj=_j0+points[k]/pointsX;
+          p=addVertex(o_mesh,blockEdge(pi,m_width),FLOOR_HEIGHT,blockEdge(pj,m_depth),up);
+        }
+        corner[k]=p;
+      }
+      if(i!=goalI || j!=goalJ)
+      {
+        addQuad(o_mesh,corner[0],corner[1],corner[2],corner[3]);
+        continue;
+      }
+      // the goal cell is a ring of four pieces round the hole
+      unsigned int hole[4];
+      hole[0]=addVertex(o_mesh,hx0,FLOOR_HEIGHT,hz0,up);
+      hole[1]=addVertex(o_mesh,hx0,FLOOR_HEIGHT,hz1,up);
+      hole[2]=addVertex(o_mesh,hx1,FLOOR_HEIGHT,hz1,up);
+      hole[3]=addVertex(o_mesh,hx1,FLOOR_HEIGHT,hz0,up);
+      for(int k=0; k<4; ++k)
+      {
+        addQuad(o_mesh,corner[k],corner[(k+1)&3],hole[(k+1)&3],hole[k]);
+      }
+    }
+  }
+
+  // the underside is one quad, or a ring round the hole
+  float x0=blockEdge(_i0,m_width);
+  float x1=blockEdge(_i1,m_width);
+  float z0=blockEdge(_j0,m_depth);
+  float z1=blockEdge(_j1,m_depth);
+  unsigned int corner[4];
+  corner[0]=addVertex(o_mesh,x0,0.0,z0,down);
+  corner[1]=addVertex(o_mesh,x0,0.0,z1,down);
+  corner[2]=addVertex(o_mesh,x1,0.0,z1,down);
+  corner[3]=addVertex(o_mesh,x1,0.0,z0,down);
+  if(!hasGoal)
+  {
+    addQuad(o_mesh,corner[3],corner[2],corner[1],corner[0]);
+  }
+  else
+  {
+    unsigned int hole[4];
+    hole[0]=addVertex(o_mesh,hx0,0.0,hz0,down);
+    hole[1]=addVertex(o_mesh,hx0,0.0,hz1,down);
+    hole[2]=addVertex(o_mesh,hx1,0.0,hz1,down);
+    hole[3]=addVertex(o_mesh,hx1,0.0,hz0,down);
+    for(int k=0; k<4; ++k)
+    {
+      addQuad(o_mesh,hole[k],hole[(k+1)&3],corner[(k+1)&3],corner[k]);
+    }
+
+    // the sides of the hole face into it
+    addFace(o_mesh,ngl::Vec3(hx0,FLOOR_HEIGHT,hz0),ngl::Vec3(hx0,FLOOR_HEIGHT,hz1),ngl::Vec3(hx0,0,hz1),ngl::Vec3(hx0,0,hz0),ngl::Vec3(1,0,0));
+    addFace(o_mesh,ngl::Vec3(hx1,0,hz0),ngl::Vec3(hx1,0,hz1),ngl::Vec3(hx1,FLOOR_HEIGHT,hz1),ngl::Vec3(hx1,FLOOR_HEIGHT,hz0),ngl::Vec3(-1,0,0));
+    addFace(o_mesh,ngl::Vec3(hx1,0,hz0),ngl::Vec3(hx1,FLOOR_HEIGHT,hz0),ngl::Vec3(hx0,FLOOR_HEIGHT,hz0),ngl::Vec3(hx0,0,hz0),ngl::Vec3(0,0,1));
+    addFace(o_mesh,ngl::Vec3(hx0,0,hz1),ngl::Vec3(hx0,FLOOR_HEIGHT,hz1),ngl::Vec3(hx1,FLOOR_HEIGHT,hz1),ngl::Vec3(hx1,0,hz1),ngl::Vec3(0,0,-1));
+  }
+
+  // a box for each row of solid blocks, the walls go down through the slab so the outside ones
+  // are its sides as well
+  float y0=0.0;
+  float y1=WALL_HEIGHT;
+  for(unsigned int j=_j0; j<_j1; ++j)
+  {
+    float bz0=blockEdge(j,m_depth);
+    float bz1=blockEdge(j+1,m_depth);
+    unsigned int i=_i0;
+    while(i<_i1)
+    {
+      if(!solid(i,j))
+      {
+        ++i;
+        continue;
+      }
+      unsigned int first=i;
+      while(i<_i1 && solid(i,j))
+      {
+        ++i;
+      }
+      float bx0=blockEdge(first,m_width);
+      float bx1=blockEdge(i,m_width);
+      addFace(o_mesh,ngl::Vec3(bx0,y1,bz0),ngl::Vec3(bx0,y1,bz1),ngl::Vec3(bx1,y1,bz1),ngl::Vec3(bx1,y1,bz0),up);
+      // rows between cells only have walls along z, which always end against posts
+      if(j&1)
+      {
+        addFace(o_mesh,ngl::Vec3(bx0,y0,bz0),ngl::Vec3(bx0,y0,bz1),ngl::Vec3(bx0,y1,bz1),ngl::Vec3(bx0,y1,bz0),ngl::Vec3(-1,0,0));
+        addFace(o_mesh,ngl::Vec3(bx1,y1,bz0),ngl::Vec3(bx1,y1,bz1),ngl::Vec3(bx1,y0,bz1),ngl::Vec3(bx1,y0,bz0),ngl::Vec3(1,0,0));
+        continue;
+      }
+      addFace(o_mesh,ngl::Vec3(bx0,y0,bz0),ngl::Vec3(bx0,y1,bz0),ngl::Vec3(bx1,y1,bz0),ngl::Vec3(bx1,y0,bz0),ngl::Vec3(0,0,-1));
+      addFace(o_mesh,ngl::Vec3(bx1,y0,bz1),ngl::Vec3(bx1,y1,bz1),ngl::Vec3(bx0,y1,bz1),ngl::Vec3(bx0,y0,bz1),ngl::Vec3(0,0,1));
+      // a run cut off by the edge of a chunk carries on in the next one so has no end there
+      if(first==0 || !solid(first-1,j))
+      {
+        addFace(o_mesh,ngl::Vec3(bx0,y0,bz0),ngl::Vec3(bx0,y0,bz1),ngl::Vec3(bx0,y1,bz1),ngl::Vec3(bx0,y1,bz0),ngl::Vec3(-1,0,0));
+      }
+      if(i==2*m_width+1 || !solid(i,j))
+      {
+        addFace(o_mesh,ngl::Vec3(bx1,y1,bz0),ngl::Vec3(bx1,y1,bz1),ngl::Vec3(bx1,y0,bz1),ngl::Vec3(bx1,y0,bz0),ngl::Vec3(1,0,0));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::getTriangles(std::vector <ngl::Vec3> &o_triangles) const
+{
+  o_triangles.clear();
+  if(!m_mesh.indices.empty())
+  {
+    appendTriangles(m_mesh,o_triangles);
+    return;
+  }
+  // without the whole mesh it is made a chunk at a time
+  MazeMesh chunk;
+  for(unsigned int c=0; c<getNumChunks(); ++c)
+  {
+    buildChunk(c,chunk);
+    appendTriangles(chunk,o_triangles);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeGenerator::appendTriangles(const MazeMesh &_mesh, std::vector <ngl::Vec3> &o_triangles)
+{
+  o_triangles.reserve(o_triangles.size()+_mesh.indices.size());
+  for(unsigned int i=0; i<_mesh.indices.size(); ++i)
+  {
+    const MazeVertex &v=_mesh.vertices[_mesh.indices[i]];
+    o_triangles.push_back(ngl::Vec3(v.x,v.y,v.z));
+  }
+}
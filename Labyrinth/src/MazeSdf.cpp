@@ -0,0 +1,438 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MazeSdf.cpp
+/// @brief 3D signed distance field of a maze in its own space, cached next to the obj
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MazeSdf.h"
+#include <ngl/Obj.h>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief spacing of the grid, under half the ball's radius so the rounding at edges stays small
+//----------------------------------------------------------------------------------------------------------------------
+const static float CELL_SIZE=0.25;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how far from the surface distances are worked out, the ball's radius plus plenty for
+/// bullet's contact breaking threshold. The grid reaches this far past the maze as well
+//----------------------------------------------------------------------------------------------------------------------
+const static float BAND=1.5;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cache file header
+//----------------------------------------------------------------------------------------------------------------------
+const static char SDF_MAGIC[4]={'L','S','D','F'};
+const static uint32_t SDF_VERSION=1;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief FNV-1a over some bytes
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t fnv1a(uint32_t _hash, const char *_data, size_t _size)
+{
+  for(size_t i=0; i<_size; ++i)
+  {
+    _hash^=(unsigned char)_data[i];
+    _hash*=16777619u;
+  }
+  return _hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief closest point on a triangle to a point (Ericson, Real-Time Collision Detection 5.1.5)
+//----------------------------------------------------------------------------------------------------------------------
+static btVector3 closestOnTriangle(const btVector3 &_p, const btVector3 &_a, const btVector3 &_b, const btVector3 &_c)
+{
+  btVector3 ab=_b-_a;
+  btVector3 ac=_c-_a;
+  btVector3 ap=_p-_a;
+  btScalar d1=ab.dot(ap);
+  btScalar d2=ac.dot(ap);
+  if(d1<=0 && d2<=0)
+  {
+    return _a;
+  }
+  btVector3 bp=_p-_b;
+  btScalar d3=ab.dot(bp);
+  btScalar d4=ac.dot(bp);
+  if(d3>=0 && d4<=d3)
+  {
+    return _b;
+  }
+  btScalar vc=d1*d4-d3*d2;
+  if(vc<=0 && d1>=0 && d3<=0)
+  {
+    return _a+ab*(d1/(d1-d3));
+  }
+  btVector3 cp=_p-_c;
+  btScalar d5=ab.dot(cp);
+  btScalar d6=ac.dot(cp);
+  if(d6>=0 && d5<=d6)
+  {
+    return _c;
+  }
+  btScalar vb=d5*d2-d1*d6;
+  if(vb<=0 && d2>=0 && d6<=0)
+  {
+    return _a+ac*(d2/(d2-d6));
+  }
+  btScalar va=d3*d6-d5*d4;
+  if(va<=0 && d4-d3>=0 && d5-d6>=0)
+  {
+    return _b+(_c-_b)*((d4-d3)/((d4-d3)+(d5-d6)));
+  }
+  btScalar denom=1.0/(va+vb+vc);
+  return _a+ab*(vb*denom)+ac*(vc*denom);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeSdf::MazeSdf()
+{
+  m_key=0;
+  for(int a=0; a<3; ++a)
+  {
+    m_size[a]=0;
+    m_origin[a]=0.0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+btScalar MazeSdf::getBand()
+{
+  return BAND;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+uint32_t MazeSdf::makeKey(const std::string &_objFile)
+{
+  std::ifstream file(_objFile.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return 0;
+  }
+  uint32_t hash=2166136261u;
+  char buffer[4096];
+  while(file.read(buffer,sizeof(buffer)) || file.gcount()>0)
+  {
+    hash=fnv1a(hash,buffer,file.gcount());
+  }
+  float settings[3]={CELL_SIZE,BAND,float(SDF_VERSION)};
+  hash=fnv1a(hash,reinterpret_cast<const char *>(settings),sizeof(settings));
+  // 0 is kept for "any"
+  return hash==0 ? 1 : hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::loadOrBuild(const std::string &_objFile)
+{
+  uint32_t key=makeKey(_objFile);
+  if(key==0)
+  {
+    std::cerr<<"Unable to read maze "<<_objFile<<"\n";
+    return false;
+  }
+  std::string cache=_objFile+".sdf";
+  if(load(cache,key))
+  {
+    return true;
+  }
+  if(!build(_objFile))
+  {
+    return false;
+  }
+  if(!save(cache))
+  {
+    // not fatal, it is just built again next time
+    std::cerr<<"Unable to write distance field cache "<<cache<<"\n";
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::build(const std::string &_objFile)
+{
+  uint32_t key=makeKey(_objFile);
+  if(key==0)
+  {
+    m_distance.clear();
+    return false;
+  }
+  ngl::Obj mesh(_objFile);
+  std::vector <ngl::Vec3> verts=mesh.getVertexList();
+  std::vector <ngl::Face> faces=mesh.getFaceList();
+
+  // faces with more than three corners are split into a fan
+  std::vector <ngl::Vec3> triangles;
+  for(unsigned int f=0; f<faces.size(); ++f)
+  {
+    const ngl::Face &face=faces[f];
+    for(unsigned int k=1; k+1<face.m_vert.size(); ++k)
+    {
+      triangles.push_back(verts[face.m_vert[0]]);
+      triangles.push_back(verts[face.m_vert[k]]);
+      triangles.push_back(verts[face.m_vert[k+1]]);
+    }
+  }
+  if(!build(triangles))
+  {
+    return false;
+  }
+  m_key=key;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::build(const std::vector <ngl::Vec3> &_triangles)
+{
+  m_distance.clear();
+  m_key=0;
+  // slivers are dropped
+  std::vector <btVector3> tris;
+  for(unsigned int t=0; t+2<_triangles.size(); t+=3)
+  {
+    btVector3 va(_triangles[t].m_x,_triangles[t].m_y,_triangles[t].m_z);
+    btVector3 vb(_triangles[t+1].m_x,_triangles[t+1].m_y,_triangles[t+1].m_z);
+    btVector3 vc(_triangles[t+2].m_x,_triangles[t+2].m_y,_triangles[t+2].m_z);
+    if((vb-va).cross(vc-va).length2()<1e-12)
+    {
+      continue;
+    }
+    tris.push_back(va);
+    tris.push_back(vb);
+    tris.push_back(vc);
+  }
+  if(tris.empty())
+  {
+    return false;
+  }
+
+  btVector3 lo=tris[0];
+  btVector3 hi=tris[0];
+  for(unsigned int i=1; i<tris.size(); ++i)
+  {
+    lo.setMin(tris[i]);
+    hi.setMax(tris[i]);
+  }
+  for(int a=0; a<3; ++a)
+  {
+    m_origin[a]=lo[a]-BAND;
+    m_size[a]=std::max(2,int(ceil((hi[a]-lo[a]+2.0*BAND)/CELL_SIZE))+1);
+  }
+  unsigned int points=m_size[0]*m_size[1]*m_size[2];
+  m_distance.assign(points,BAND);
+
+  // distance to the nearest triangle, each triangle only visits the points within the band of it
+  for(unsigned int t=0; t<tris.size(); t+=3)
+  {
+    const btVector3 &a=tris[t];
+    const btVector3 &b=tris[t+1];
+    const btVector3 &c=tris[t+2];
+    btVector3 tmin=a;
+    btVector3 tmax=a;
+    tmin.setMin(b);
+    tmin.setMin(c);
+    tmax.setMax(b);
+    tmax.setMax(c);
+    int first[3];
+    int last[3];
+    for(int k=0; k<3; ++k)
+    {
+      first[k]=std::max(0,int(ceil((tmin[k]-BAND-m_origin[k])/CELL_SIZE)));
+      last[k]=std::min(int(m_size[k])-1,int(floor((tmax[k]+BAND-m_origin[k])/CELL_SIZE)));
+    }
+    for(int z=first[2]; z<=last[2]; ++z)
+    {
+      for(int y=first[1]; y<=last[1]; ++y)
+      {
+        for(int x=first[0]; x<=last[0]; ++x)
+        {
+          btVector3 p(m_origin[0]+x*CELL_SIZE,m_origin[1]+y*CELL_SIZE,m_origin[2]+z*CELL_SIZE);
+          float d=(p-closestOnTriangle(p,a,b,c)).length();
+          float &best=m_distance[pointIndex(x,y,z)];
+          best=std::min(best,d);
+        }
+      }
+    }
+  }
+
+  // a point is inside if it is between the lowest and highest surface over its column. The sides
+  // of the walls can't cover a column so are skipped, as in NavGrid
+  unsigned int columns=m_size[0]*m_size[2];
+  std::vector <float> bottom(columns,0.0);
+  std::vector <float> top(columns,0.0);
+  std::vector <bool> covered(columns,false);
+  for(unsigned int t=0; t<tris.size(); t+=3)
+  {
+    const btVector3 &a=tris[t];
+    const btVector3 &b=tris[t+1];
+    const btVector3 &c=tris[t+2];
+    // twice the signed area on the x / z plane, 0 for a side
+    float area=(b.x()-a.x())*(c.z()-a.z())-(c.x()-a.x())*(b.z()-a.z());
+    if(fabs(area)<1e-6)
+    {
+      continue;
+    }
+    int x0=std::max(0,int(ceil((std::min(a.x(),std::min(b.x(),c.x()))-m_origin[0])/CELL_SIZE)));
+    int x1=std::min(int(m_size[0])-1,int(floor((std::max(a.x(),std::max(b.x(),c.x()))-m_origin[0])/CELL_SIZE)));
+    int z0=std::max(0,int(ceil((std::min(a.z(),std::min(b.z(),c.z()))-m_origin[2])/CELL_SIZE)));
+    int z1=std::min(int(m_size[2])-1,int(floor((std::max(a.z(),std::max(b.z(),c.z()))-m_origin[2])/CELL_SIZE)));
+    for(int z=z0; z<=z1; ++z)
+    {
+      for(int x=x0; x<=x1; ++x)
+      {
+        float px=m_origin[0]+x*CELL_SIZE;
+        float pz=m_origin[2]+z*CELL_SIZE;
+        // barycentric weights, all the same sign as the area when inside
+        float wa=((b.x()-px)*(c.z()-pz)-(c.x()-px)*(b.z()-pz))/area;
+        float wb=((c.x()-px)*(a.z()-pz)-(a.x()-px)*(c.z()-pz))/area;
+        float wc=1.0f-wa-wb;
+        if(wa<0.0 || wb<0.0 || wc<0.0)
+        {
+          continue;
+        }
+        float y=wa*a.y()+wb*b.y()+wc*c.y();
+        unsigned int i=z*m_size[0]+x;
+        if(!covered[i])
+        {
+          bottom[i]=y;
+          top[i]=y;
+          covered[i]=true;
+        }
+        bottom[i]=std::min(bottom[i],y);
+        top[i]=std::max(top[i],y);
+      }
+    }
+  }
+  for(unsigned int z=0; z<m_size[2]; ++z)
+  {
+    for(unsigned int x=0; x<m_size[0]; ++x)
+    {
+      unsigned int i=z*m_size[0]+x;
+      if(!covered[i])
+      {
+        continue;
+      }
+      for(unsigned int y=0; y<m_size[1]; ++y)
+      {
+        float py=m_origin[1]+y*CELL_SIZE;
+        if(py>bottom[i] && py<top[i])
+        {
+          float &d=m_distance[pointIndex(x,y,z)];
+          d=-d;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::save(const std::string &_file) const
+{
+  std::ofstream file(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open() || m_distance.empty())
+  {
+    return false;
+  }
+  uint32_t header[5]={SDF_VERSION,m_key,m_size[0],m_size[1],m_size[2]};
+  file.write(SDF_MAGIC,sizeof(SDF_MAGIC));
+  file.write(reinterpret_cast<const char *>(header),sizeof(header));
+  file.write(reinterpret_cast<const char *>(m_origin),sizeof(m_origin));
+  file.write(reinterpret_cast<const char *>(&m_distance[0]),m_distance.size()*sizeof(float));
+  return file.good();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::load(const std::string &_file, uint32_t _key)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  char magic[4];
+  uint32_t header[5];
+  float origin[3];
+  file.read(magic,sizeof(magic));
+  file.read(reinterpret_cast<char *>(header),sizeof(header));
+  file.read(reinterpret_cast<char *>(origin),sizeof(origin));
+  if(!file || memcmp(magic,SDF_MAGIC,sizeof(magic))!=0 || header[0]!=SDF_VERSION || (_key!=0 && header[1]!=_key) ||
+     header[2]<2 || header[3]<2 || header[4]<2 || header[2]>4096 || header[3]>4096 || header[4]>4096 ||
+     double(header[2])*header[3]*header[4]>double(1u<<26))
+  {
+    return false;
+  }
+  unsigned int points=header[2]*header[3]*header[4];
+  std::vector <float> distance(points);
+  file.read(reinterpret_cast<char *>(&distance[0]),points*sizeof(float));
+  if(!file)
+  {
+    return false;
+  }
+  m_key=header[1];
+  for(int a=0; a<3; ++a)
+  {
+    m_size[a]=header[a+2];
+    m_origin[a]=origin[a];
+  }
+  m_distance.swap(distance);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MazeSdf::sample(const btVector3 &_local, btScalar &o_distance, btVector3 &o_gradient) const
+{
+  if(m_distance.empty())
+  {
+    return false;
+  }
+  // cell the point is in and how far across it
+  int cell[3];
+  float t[3];
+  for(int a=0; a<3; ++a)
+  {
+    float f=(_local[a]-m_origin[a])/CELL_SIZE;
+    if(f<0.0 || f>float(m_size[a]-1))
+    {
+      return false;
+    }
+    cell[a]=std::min(int(f),int(m_size[a])-2);
+    t[a]=f-cell[a];
+  }
+  unsigned int sy=m_size[0];
+  unsigned int sz=m_size[0]*m_size[1];
+  const float *p=&m_distance[pointIndex(cell[0],cell[1],cell[2])];
+  float c000=p[0],    c100=p[1];
+  float c010=p[sy],   c110=p[sy+1];
+  float c001=p[sz],   c101=p[sz+1];
+  float c011=p[sz+sy],c111=p[sz+sy+1];
+
+  // along x, then y, then z
+  float c00=c000+(c100-c000)*t[0];
+  float c10=c010+(c110-c010)*t[0];
+  float c01=c001+(c101-c001)*t[0];
+  float c11=c011+(c111-c011)*t[0];
+  float c0=c00+(c10-c00)*t[1];
+  float c1=c01+(c11-c01)*t[1];
+  o_distance=c0+(c1-c0)*t[2];
+
+  // the same sum differentiated along each axis
+  float dx0=(c100-c000)+((c110-c010)-(c100-c000))*t[1];
+  float dx1=(c101-c001)+((c111-c011)-(c101-c001))*t[1];
+  o_gradient.setValue((dx0+(dx1-dx0)*t[2])/CELL_SIZE,
+                      ((c10-c00)+((c11-c01)-(c10-c00))*t[2])/CELL_SIZE,
+                      (c1-c0)/CELL_SIZE);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MetricsExport.cpp
+/// @brief publishes the performance counters into a POSIX shared memory segment
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MetricsExport.h"
+#include <iostream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MetricsExport::MetricsExport()
+{
+  m_segment=0;
+  m_lastSteps=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MetricsExport::~MetricsExport()
+{
+  if(m_segment!=0)
+  {
+    munmap(m_segment,sizeof(MetricsSegment));
+    shm_unlink(METRICS_SEGMENT_NAME);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool MetricsExport::open()
+{
+  int fd=shm_open(METRICS_SEGMENT_NAME,O_CREAT|O_RDWR,0644);
+  if(fd<0)
+  {
+    std::cerr<<"Could not create metrics segment "<<METRICS_SEGMENT_NAME<<"\n";
+    return false;
+  }
+  if(ftruncate(fd,sizeof(MetricsSegment))!=0)
+  {
+    std::cerr<<"Could not size metrics segment "<<METRICS_SEGMENT_NAME<<"\n";
+    close(fd);
+    return false;
+  }
+  void *mem=mmap(0,sizeof(MetricsSegment),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  //the mapping keeps the segment alive so we don't need the descriptor
+  close(fd);
+  if(mem==MAP_FAILED)
+  {
+    std::cerr<<"Could not map metrics segment "<<METRICS_SEGMENT_NAME<<"\n";
+    return false;
+  }
+  m_segment=static_cast<MetricsSegment *>(mem);
+  memset(m_segment,0,sizeof(MetricsSegment));
+  m_segment->size=sizeof(MetricsSegment);
+  m_segment->pid=getpid();
+  m_segment->version=METRICS_VERSION;
+  //magic goes in last so a reader never sees a half initialised header
+  __sync_synchronize();
+  m_segment->magic=METRICS_MAGIC;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MetricsExport::publish(const PerfStats &_stats, int _state)
+{
+  if(m_segment==0)
+  {
+    return;
+  }
+  //odd sequence tells readers we are mid write
+  ++m_segment->sequence;
+  __sync_synchronize();
+
+  m_segment->state=_state;
+  m_segment->frames=_stats.frames;
+  m_segment->physicsSteps=_stats.physicsSteps;
+  m_segment->substeps=_stats.totalSubsteps;
+  m_segment->bodies=_stats.activeBodies;
+  m_segment->contacts=_stats.contacts;
+  //we publish once per frame and step at most once per frame so only the last step time is new
+  if(_stats.physicsSteps!=m_lastSteps)
+  {
+    unsigned int bucket=(unsigned int)(_stats.stepTime.getLast()*1000.0/METRICS_STEP_BUCKET_US);
+    if(bucket>=METRICS_STEP_BUCKETS)
+    {
+      bucket=METRICS_STEP_BUCKETS-1;
+    }
+    ++m_segment->stepHistogram[bucket];
+    m_lastSteps=_stats.physicsSteps;
+  }
+  for(unsigned int i=0; i<METRICS_ASSET_CATEGORIES && i<ASSET_CATEGORIES; ++i)
+  {
+    m_segment->assetBytes[i]=_stats.assetBytes[i];
+  }
+  m_segment->wins=_stats.wins;
+  m_segment->losses=_stats.losses;
+  m_segment->governorLevel=_stats.governorLevel;
+
+  __sync_synchronize();
+  ++m_segment->sequence;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -10,67 +10,134 @@
 #include <ngl/NGLInit.h>
 #include <ngl/Material.h>
 #include <ngl/VAOPrimitives.h>
-#include "PhysicsWorld.h"
 #include "CollisionShape.h"
+#include "ShaderCache.h"
 #include <SDL.h>
 #include <sstream>
 #include <string>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
 
 //----------------------------------------------------------------------------------------------------------------------
 
 const static float INCREMENT=0.01;
 const static float ZOOM=1.0;
-NGLDraw::NGLDraw()
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the camera's far plane, chunks of a streamed maze further than this from it aren't tested
+//----------------------------------------------------------------------------------------------------------------------
+const static float DRAW_DISTANCE=350.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief most chunks put on the gpu in a frame, the rest wait for the next so turning to a new
+/// part of the maze doesn't stall
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int MAX_CHUNK_UPLOADS=16;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief frames a chunk can go unseen before it is dropped from the gpu (2 seconds at 60Hz)
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned long CHUNK_KEEP_FRAMES=120;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the phong shaders are built into a program for each variant, a variant being some of
+/// these bits each of which #defines its name in the glsl. s_phongPrograms is indexed by variant
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int PHONG_INSTANCED=1;
+const static unsigned int PHONG_NORMALIZE=2;
+const static unsigned int PHONG_VARIANTS=4;
+const static char *s_phongDefines[]={"INSTANCED","NORMALIZE"};
+const static std::string s_phongPrograms[]={"Phong","PhongInstanced","PhongNormalize","PhongInstancedNormalize"};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns the phong variant a mesh needs, normalizing in the vertex shader only when its
+/// normals aren't already unit length
+//----------------------------------------------------------------------------------------------------------------------
+static unsigned int phongVariant(ngl::Obj *_mesh)
+{
+  std::vector <ngl::Vec3> normals=_mesh->getNormalList();
+  for(unsigned int i=0; i<normals.size(); ++i)
+  {
+    if(fabs(normals[i].lengthSquared()-1.0)>0.001)
+    {
+      return PHONG_NORMALIZE;
+    }
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a draw queue key has the shader in its top bits then the material then the mesh, so
+/// sorting the keys groups the bodies by the most costly state to change first. The phong shaders
+/// take the values below DRAW_SHADER_TEXTURE, DRAW_SHADER_PHONG plus the mesh's variant
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int DRAW_SHADER_PHONG=0;
+const static unsigned int DRAW_SHADER_TEXTURE=PHONG_VARIANTS;
+const static unsigned int DRAW_MESH_SPHERE=0;
+const static unsigned int DRAW_MESH_CUBE=1;
+const static unsigned int DRAW_MESH_MAZE=2;
+const static unsigned int DRAW_NONE=~0u;
+
+static unsigned int drawKey(unsigned int _shader, unsigned int _material, unsigned int _mesh)
+{
+  return _shader<<16 | _material<<8 | _mesh;
+}
+
+static unsigned int drawShader(unsigned int _key) {return _key>>16;}
+static unsigned int drawMaterial(unsigned int _key) {return (_key>>8)&0xff;}
+static unsigned int drawMesh(unsigned int _key) {return _key&0xff;}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief key for each BodyKind, other bodies aren't drawn
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int s_drawKeys[]={DRAW_NONE,
+                                        drawKey(DRAW_SHADER_PHONG,ngl::SILVER,DRAW_MESH_SPHERE),
+                                        drawKey(DRAW_SHADER_TEXTURE,0,DRAW_MESH_MAZE),
+                                        drawKey(DRAW_SHADER_PHONG,ngl::BLACKPLASTIC,DRAW_MESH_CUBE)};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief quality levels for dynamic resolution, best first. MSAA goes before resolution as it
+/// costs the most and the text, which shows scaling worst, is always drawn at full resolution
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  float scale;
+  int samples;
+}QualityLevel;
+
+const static QualityLevel s_quality[]={{1.0,4},{1.0,2},{1.0,0},{0.85,0},{0.7,0},{0.5,0}};
+const static int s_numQuality=6;
+
+NGLDraw::NGLDraw(const MazeGenerator *_maze)
 {
   m_rotate=false;
   m_spinXFace=0;
   m_spinYFace=0;
+  m_showHud=false;
+  m_drawCalls=0;
+  m_offscreenFBO=0;
+  m_dirty=true;
+  m_lastTick=0;
+  m_width=720;
+  m_height=576;
+  m_frameBudget=0.0;
+  m_sceneFBO=0;
+  m_resolveFBO=0;
+  m_sceneWidth=0;
+  m_sceneHeight=0;
+  m_sceneSamples=0;
+  m_quality=0;
+  m_overBudget=0;
+  m_underBudget=0;
+  m_gpuQueries[0]=0;
+  m_gpuQueries[1]=0;
+  m_queryPending[0]=false;
+  m_queryPending[1]=false;
+  m_query=0;
 
   glClearColor(0.98f, 0.98f, 0.98f, 1.0f);
   glEnable(GL_DEPTH_TEST);
 
-  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
-  shader->createShaderProgram("Phong");
-  shader->attachShader("PhongVertex",ngl::VERTEX);
-  shader->attachShader("PhongFragment",ngl::FRAGMENT);
-  shader->loadShaderSource("PhongVertex","shaders/PhongVertex.glsl");
-  shader->loadShaderSource("PhongFragment","shaders/PhongFragment.glsl");
-  shader->compileShader("PhongVertex");
-  shader->compileShader("PhongFragment");
-  shader->attachShaderToProgram("Phong","PhongVertex");
-  shader->attachShaderToProgram("Phong","PhongFragment");
-  shader->bindAttribute("Phong",0,"inVert");
-  shader->bindAttribute("Phong",1,"inUV");
-  shader->bindAttribute("Phong",2,"inNormal");
-  shader->linkProgramObject("Phong");
-  (*shader)["Phong"]->use();
-
-  ngl::Vec3 from(0,100,0);
-  ngl::Vec3 to(0,10,0);
-  ngl::Vec3 up(0,0,1);
-  m_cam= new ngl::Camera(from,to,up);
-  m_cam->setShape(45,(float)720.0/576.0,0.05,350);
-  shader->setShaderParam3f("viewerPos",m_cam->getEye().m_x,m_cam->getEye().m_y,m_cam->getEye().m_z);
-
-  m_light = new ngl::Light(ngl::Vec3(0,100,0),ngl::Colour(1,1,1,1),ngl::Colour(1,1,1,1),ngl::POINTLIGHT );
-  m_light->loadToShader("light");
-
-  ngl::ShaderLib *shader2=ngl::ShaderLib::instance();
-
-  shader2->createShaderProgram("TextureShader");
-  shader2->attachShader("TextureVertex",ngl::VERTEX);
-  shader2->attachShader("TextureFragment",ngl::FRAGMENT);
-  shader2->loadShaderSource("TextureVertex","shaders/TextureVert.glsl");
-  shader2->loadShaderSource("TextureFragment","shaders/TextureFrag.glsl");
-  shader2->compileShader("TextureVertex");
-  shader2->compileShader("TextureFragment");
-  shader2->attachShaderToProgram("TextureShader","TextureVertex");
-  shader2->attachShaderToProgram("TextureShader","TextureFragment");
-  shader2->linkProgramObject("TextureShader");
-  shader2->use("TextureShader");
-  shader2->registerUniform("TextureShader","MVP");
-
   ngl::Texture texture("textures/wood.tif");
   m_mazeTexture=texture.setTextureGL();
 
@@ -80,19 +147,139 @@ NGLDraw::NGLDraw()
   m_bodyText = new Text("font/Raleway Thin.ttf",60);
   m_bodyText->setColour(0.0,0.0,0.0);
 
+  m_hudText = new Text("font/arial.ttf",24);
+  m_hudText->setColour(0.0,0.0,0.0);
+
   m_sphereMesh = new ngl::Obj("obj/sphere.obj");
   m_sphereMesh->createVAO();
 
-  m_mazeMesh = new ngl::Obj("obj/mazev3.obj", "textures/wood.tif");
-  m_mazeMesh->createVAO();
+  m_mazeMesh=0;
+  m_mazeVAO=0;
+  m_mazeVAOBytes=0;
+  m_streamMaze=0;
+  m_frame=0;
+  if(_maze && !_maze->hasMesh())
+  {
+    //chunks are put on the gpu as they come into view
+    m_streamMaze=_maze;
+  }
+  else if(_maze)
+  {
+    //the generator's arrays go straight to the gpu
+    m_mazeVAO=createMazeVAO(_maze->getVertices(),_maze->getIndices());
+    m_mazeVAOBytes=_maze->getMemoryUsage();
+  }
+  else
+  {
+    m_mazeMesh = new ngl::Obj("obj/mazev3.obj", "textures/wood.tif");
+    m_mazeMesh->createVAO();
+  }
 
   m_cube = new ngl::Obj("obj/cubev2.obj");
   m_cube->createVAO();
 
+  m_swarmMesh = new ngl::Obj("obj/sphere.obj");
+  m_swarmMesh->createVAO();
+  //one offset per ball rather than per vertex, refilled every frame there is a party
+  glGenBuffers(1, &m_swarmVBO);
+  m_swarmMesh->bindVAO();
+  glBindBuffer(GL_ARRAY_BUFFER, m_swarmVBO);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glVertexAttribDivisor(3, 1);
+  m_swarmMesh->unbindVAO();
+
+  //each mesh drawn with phong picks its variant, only the variants used are built
+  m_meshVariants[DRAW_MESH_SPHERE]=phongVariant(m_sphereMesh);
+  m_meshVariants[DRAW_MESH_CUBE]=phongVariant(m_cube);
+  m_meshVariants[DRAW_MESH_MAZE]=0;
+  m_swarmVariant=phongVariant(m_swarmMesh) | PHONG_INSTANCED;
+  bool used[PHONG_VARIANTS]={true,false,false,false};
+  used[m_meshVariants[DRAW_MESH_SPHERE]]=true;
+  used[m_meshVariants[DRAW_MESH_CUBE]]=true;
+  used[m_swarmVariant]=true;
+
+  // the programs are linked by ShaderCache, which reads them back from the driver's binary when it
+  // can, and used by name through the ShaderLib as before
+  Uint64 shadersStart=SDL_GetPerformanceCounter();
+  ShaderCache programs;
+  std::vector <std::string> attributes;
+  attributes.push_back("inVert");
+  attributes.push_back("inUV");
+  attributes.push_back("inNormal");
+  //the party balls have each ball's position added on to the mesh
+  attributes.push_back("inOffset");
+  for(unsigned int variant=0; variant<PHONG_VARIANTS; ++variant)
+  {
+    if(!used[variant])
+    {
+      continue;
+    }
+    std::vector <std::string> defines;
+    for(unsigned int bit=0; (1u<<bit)<PHONG_VARIANTS; ++bit)
+    {
+      if(variant & (1u<<bit))
+      {
+        defines.push_back(s_phongDefines[bit]);
+      }
+    }
+    programs.build(s_phongPrograms[variant],"shaders/PhongVertex.glsl","shaders/PhongFragment.glsl",attributes,defines);
+  }
+
+  // the text shader gives its own locations
+  attributes.clear();
+  programs.build("TextureShader","shaders/TextureVert.glsl","shaders/TextureFrag.glsl",attributes);
+  std::cout<<"Shaders ready in "<<(SDL_GetPerformanceCounter()-shadersStart)*1000.0/SDL_GetPerformanceFrequency()<<" ms, "
+           <<programs.getHits()<<" of "<<programs.getHits()+programs.getMisses()<<" from the cache\n";
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+
+  ngl::Vec3 from(0,100,0);
+  ngl::Vec3 to(0,10,0);
+  ngl::Vec3 up(0,0,1);
+  m_cam= new ngl::Camera(from,to,up);
+  m_cam->setShape(45,(float)720.0/576.0,0.05,350);
+
+  m_light = new ngl::Light(ngl::Vec3(0,100,0),ngl::Colour(1,1,1,1),ngl::Colour(1,1,1,1),ngl::POINTLIGHT );
+  for(unsigned int variant=0; variant<PHONG_VARIANTS; ++variant)
+  {
+    if(used[variant])
+    {
+      (*shader)[s_phongPrograms[variant]]->use();
+      shader->setShaderParam3f("viewerPos",m_cam->getEye().m_x,m_cam->getEye().m_y,m_cam->getEye().m_z);
+      m_light->loadToShader("light");
+    }
+  }
+
+  shader->use("TextureShader");
+  shader->registerUniform("TextureShader","MVP");
+
+  //the collision shapes are loaded by the Simulation which is created first
   CollisionShape *shapes=CollisionShape::instance();
-  shapes->addSphere("ball", "obj/sphere.obj");
-  shapes->addMaze("maze", "obj/mazev3.obj");
-  shapes->addBox("cube", "obj/cubev2.obj");
+
+  m_stats.assetBytes[ASSET_MESH]=meshBytes(m_sphereMesh)+meshBytes(m_cube)+meshBytes(m_swarmMesh);
+  //the generator's own copy of a generated maze is counted with the collision shapes that use it
+  m_stats.assetBytes[ASSET_MESH]+= m_mazeMesh ? meshBytes(m_mazeMesh) : m_mazeVAOBytes;
+  GLint texW, texH;
+  glBindTexture(GL_TEXTURE_2D, m_mazeTexture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D,0,GL_TEXTURE_WIDTH,&texW);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D,0,GL_TEXTURE_HEIGHT,&texH);
+  //the maze Obj loads its own copy of the wood texture as well
+  m_stats.assetBytes[ASSET_TEXTURE]=(m_mazeMesh ? 2 : 1)*texW*texH*4;
+  m_stats.assetBytes[ASSET_FONT]=m_text->getTextureBytes()+m_bodyText->getTextureBytes()+m_hudText->getTextureBytes();
+  m_stats.assetBytes[ASSET_COLLISION]=shapes->getMemoryUsage();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned long NGLDraw::meshBytes(ngl::Obj *_mesh)
+{
+  //cpu side vertex lists plus the vao which holds 8 floats for each vertex of each face
+  unsigned long bytes=(_mesh->getNumVerts()+_mesh->getNumNormals())*sizeof(ngl::Vec3);
+  bytes+=_mesh->getNumTexCords()*sizeof(ngl::Vec3);
+  bytes+=_mesh->getNumFaces()*sizeof(ngl::Face);
+  bytes+=_mesh->getNumFaces()*3*8*sizeof(float);
+  return bytes;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -103,37 +290,44 @@ NGLDraw::~NGLDraw()
   std::cout<<"Shutting down NGL, removing VAO's and Shaders\n";
   delete m_light;
   delete m_cam;
-  delete m_physics;
   delete m_sphereMesh;
-  delete m_mazeMesh;
-//  glDeleteFramebuffers(1, &m_fboID);
+  freeMaze();
+  delete m_swarmMesh;
+  glDeleteBuffers(1, &m_swarmVBO);
+  delete m_hudText;
+  if(m_offscreenFBO)
+  {
+    glDeleteFramebuffers(1, &m_offscreenFBO);
+    glDeleteRenderbuffers(2, m_offscreenBuffers);
+  }
+  if(m_sceneFBO)
+  {
+    glDeleteFramebuffers(1, &m_sceneFBO);
+    glDeleteRenderbuffers(2, m_sceneBuffers);
+    glDeleteFramebuffers(1, &m_resolveFBO);
+    glDeleteRenderbuffers(2, m_resolveBuffers);
+    glDeleteQueries(2, m_gpuQueries);
+  }
   Init->NGLQuit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void NGLDraw::setPhysics(int _gravityY, float _friction)
-{
-  m_gravity = ngl::Vec3(0, _gravityY, 0);
-  m_physics = new PhysicsWorld();
-  m_physics->setGravity(m_gravity);
-  m_physics->addGroundPlane(ngl::Vec3(0,0,0), ngl::Vec3(50,0.01,50));
-
-  m_physics->addSphere("ball",ngl::Vec3(-15,25,-15), _friction);
-  m_physics->addMaze("maze", ngl::Vec3(0,20,0), _friction);
-  m_physics->addCube("cube",ngl::Vec3(0,17,0));
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
 void NGLDraw::resize(int _w, int _h)
 {
+  m_width=_w;
+  m_height=_h;
   glViewport(0,0,_w,_h);
   m_cam->setShape(45,(float)_w/_h,0.05,350);
 
   m_text->setScreenSize(_w,_h);
   SDL_Rect s;
-  SDL_GetDisplayBounds(0,&s);
+  // headless there is no display so the text is laid out for our own size
+  if(SDL_GetDisplayBounds(0,&s)!=0)
+  {
+    s.w=_w;
+    s.h=_h;
+  }
   float x,y;
   x=1.0-float(s.w-_w)/s.w;
   y=1.0-float(s.h-_h)/s.h;
@@ -141,14 +335,62 @@ void NGLDraw::resize(int _w, int _h)
   std::cout<<x<<" "<<y<<"\n";
 
   m_text->setTransform(x,y);
-  draw();
+  if(m_frameBudget>0.0)
+  {
+    createSceneTargets();
+  }
+  m_dirty=true;
 
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void NGLDraw::draw()
+void NGLDraw::draw(const Snapshot &_snapshot)
 {
+  //fold in the simulation counters, it may have ticked more than once since the last frame
+  unsigned long first=_snapshot.tick > m_lastTick+SNAPSHOT_STEP_HISTORY ? _snapshot.tick-SNAPSHOT_STEP_HISTORY : m_lastTick;
+  for(unsigned long t=first+1; t<=_snapshot.tick; ++t)
+  {
+    m_stats.stepTime.addSample(_snapshot.stepMs[t%SNAPSHOT_STEP_HISTORY]);
+  }
+  m_lastTick=_snapshot.tick;
+  m_stats.physicsSteps=_snapshot.tick;
+  m_stats.substeps=_snapshot.substeps;
+  m_stats.totalSubsteps=_snapshot.totalSubsteps;
+  m_stats.activeBodies=_snapshot.activeBodies;
+  m_stats.sleepingBodies=_snapshot.sleepingBodies;
+  m_stats.islands=_snapshot.islands;
+  m_stats.contacts=_snapshot.contacts;
+  m_stats.broadphasePairs=_snapshot.broadphasePairs;
+  m_stats.manifolds=_snapshot.manifolds;
+  m_stats.partyBalls=_snapshot.swarm.size()/3;
+  m_stats.partyContacts=_snapshot.swarmContacts;
+  m_stats.mazeChunks=_snapshot.mazeChunks;
+  m_stats.residentChunks=_snapshot.residentChunks;
+  ++m_frame;
+  m_stats.wins=_snapshot.wins;
+  m_stats.losses=_snapshot.losses;
+  m_stats.governorLevel=_snapshot.governorLevel;
+
+  //text drawn by the render loop after draw (the timer) lands in the next frame's count
+  m_stats.drawCalls=m_drawCalls+m_text->getDrawCalls()+m_bodyText->getDrawCalls()+m_hudText->getDrawCalls();
+  m_drawCalls=0;
+  m_text->resetDrawCalls();
+  m_bodyText->resetDrawCalls();
+  m_hudText->resetDrawCalls();
+  m_dirty=false;
+
+  if(m_frameBudget>0.0)
+  {
+    adaptResolution();
+    glBeginQuery(GL_TIME_ELAPSED, m_gpuQueries[m_query]);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+    glViewport(0,0,m_sceneWidth,m_sceneHeight);
+  }
+  else if(m_offscreenFBO)
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+  }
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   ngl::ShaderLib *shader=ngl::ShaderLib::instance();
@@ -168,34 +410,27 @@ void NGLDraw::draw()
   m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
   loadMatricesToPhongShader();
 
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
+  queueBodies(_snapshot);
+  drawQueue(_snapshot);
+
+  if(!_snapshot.swarm.empty())
   {
-    m_bodyTransform=m_physics->getTransformMatrix(i);
+    //every party ball in one draw, they are all the same sphere in a different place
+    m_bodyTransform.identity();
+    loadMatricesToPhongShader(s_phongPrograms[m_swarmVariant]);
+    ngl::Material m(ngl::GOLD);
+    m.loadToShader("material");
+    glBindBuffer(GL_ARRAY_BUFFER, m_swarmVBO);
+    glBufferData(GL_ARRAY_BUFFER, _snapshot.swarm.size()*sizeof(float), &_snapshot.swarm[0], GL_STREAM_DRAW);
+    m_swarmMesh->bindVAO();
+    glDrawArraysInstanced(GL_TRIANGLES, 0, m_swarmMesh->getMeshSize(), _snapshot.swarm.size()/3);
+    m_swarmMesh->unbindVAO();
+    ++m_drawCalls;
+  }
 
-    if(m_physics->getBodyNameAtIndex(i)=="ball")
-    {
-      loadMatricesToPhongShader();
-      ngl::Material m(ngl::SILVER);
-      m.loadToShader("material");
-      m_physics->getCollisionShape(i);
-      m_sphereMesh->draw();
-    }
-    else if(m_physics->getBodyNameAtIndex(i)=="maze")
-    {
-      loadMatricesToTextureShader();
-      glBindTexture(GL_TEXTURE_2D, m_mazeTexture);
-      m_physics->getCollisionShape(i);
-      m_mazeMesh->draw();
-    }
-    else if(m_physics->getBodyNameAtIndex(i)=="cube")
-    {
-      loadMatricesToPhongShader();
-      ngl::Material m(ngl::BLACKPLASTIC);
-      m.loadToShader("material");
-      m_physics->getCollisionShape(i);
-      m_cube->draw();
-    }
+  if(m_frameBudget>0.0)
+  {
+    compositeScene();
   }
 
   loadMatricesToPhongShader();
@@ -213,10 +448,6 @@ void NGLDraw::draw()
     m_bodyText->renderText(300,700, "Esc To Quit");
     m_bodyText->renderText(300,800, "Press B To Add More Balls");
   }
-  else if(getGameState()==1)//game
-  {
-   m_physics->step(1.0f/60.0f, 10);
-  }
   else if(getGameState()==2)//lost menu
   {
     m_text->renderText(300,300, "You Lose");
@@ -228,14 +459,581 @@ void NGLDraw::draw()
     m_text->renderText(200,500, "Press A To Play Again");
   }
 
+  if(m_showHud)
+  {
+    drawHud();
+  }
+
+  if(m_frameBudget>0.0)
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_queryPending[m_query]=true;
+    m_query^=1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NGLDraw::drawBefore(const DrawItem &_a, const DrawItem &_b)
+{
+  return _a.key < _b.key;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::queueBodies(const Snapshot &_snapshot)
+{
+  //the bodies' boxes are in the world so leave the body transform out of the planes
+  m_viewFrustum.set(m_transformStack.getCurrentTransform().getMatrix()*m_mouseGlobalTX*m_cam->getVPMatrix());
+  m_drawQueue.clear();
+  unsigned int culled=0;
+  for(unsigned int i=0; i<_snapshot.bodies.size(); ++i)
+  {
+    const BodyState &body=_snapshot.bodies[i];
+    if(body.kind!=BODY_BALL && body.kind!=BODY_MAZE && body.kind!=BODY_CUBE)
+    {
+      continue;
+    }
+    if(!m_viewFrustum.intersects(body.aabbMin,body.aabbMax))
+    {
+      ++culled;
+      continue;
+    }
+    DrawItem item;
+    item.key=s_drawKeys[body.kind];
+    if(drawShader(item.key)==DRAW_SHADER_PHONG)
+    {
+      item.key=drawKey(DRAW_SHADER_PHONG+m_meshVariants[drawMesh(item.key)],drawMaterial(item.key),drawMesh(item.key));
+    }
+    item.body=i;
+    m_drawQueue.push_back(item);
+  }
+  //bodies sharing a shader, material and mesh end up next to each other
+  std::sort(m_drawQueue.begin(),m_drawQueue.end(),drawBefore);
+  m_stats.drawnBodies=m_drawQueue.size();
+  m_stats.culledBodies=culled;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::drawQueue(const Snapshot &_snapshot)
+{
+  unsigned int shader=DRAW_NONE;
+  unsigned int material=DRAW_NONE;
+  unsigned int mesh=DRAW_NONE;
+  ngl::Obj *bound=0;
+  unsigned int changes=0;
+  for(unsigned int i=0; i<m_drawQueue.size(); ++i)
+  {
+    const DrawItem &item=m_drawQueue[i];
+    unsigned int itemShader=drawShader(item.key);
+    unsigned int itemMaterial=drawMaterial(item.key);
+    unsigned int itemMesh=drawMesh(item.key);
+    m_bodyTransform=_snapshot.bodies[item.body].transform;
+    if(itemShader!=shader)
+    {
+      shader=itemShader;
+      material=DRAW_NONE;
+      ++changes;
+      if(shader==DRAW_SHADER_TEXTURE)
+      {
+        loadMatricesToTextureShader();
+        glBindTexture(GL_TEXTURE_2D, m_mazeTexture);
+      }
+      else
+      {
+        loadMatricesToPhongShader(s_phongPrograms[shader]);
+      }
+    }
+    else if(shader==DRAW_SHADER_TEXTURE)
+    {
+      loadMatricesToTextureShader(false);
+    }
+    else
+    {
+      loadMatricesToPhongShader(s_phongPrograms[shader],false);
+    }
+    if(itemMaterial!=material)
+    {
+      material=itemMaterial;
+      ++changes;
+      if(shader!=DRAW_SHADER_TEXTURE)
+      {
+        ngl::Material m(static_cast<ngl::STDMAT>(material));
+        m.loadToShader("material");
+      }
+    }
+    if(itemMesh!=mesh)
+    {
+      mesh=itemMesh;
+      ++changes;
+      if(bound)
+      {
+        bound->unbindVAO();
+      }
+      bound= mesh==DRAW_MESH_SPHERE ? m_sphereMesh : mesh==DRAW_MESH_CUBE ? m_cube : 0;
+      if(bound)
+      {
+        bound->bindVAO();
+      }
+    }
+
+    if(bound)
+    {
+      glDrawArrays(GL_TRIANGLES, 0, bound->getMeshSize());
+      ++m_drawCalls;
+    }
+    else if(m_streamMaze)
+    {
+      drawMazeChunks();
+    }
+    else if(m_mazeVAO)
+    {
+      m_mazeVAO->bind();
+      m_mazeVAO->draw();
+      m_mazeVAO->unbind();
+      ++m_drawCalls;
+    }
+    else
+    {
+      m_mazeMesh->draw();
+      ++m_drawCalls;
+    }
+  }
+  if(bound)
+  {
+    bound->unbindVAO();
+  }
+  m_stats.stateChanges=changes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::drawHud()
+{
+  std::stringstream frame;
+  frame<<std::fixed<<std::setprecision(1);
+  frame<<"frame "<<m_stats.frameTime.getLast()<<" ms  p50 "<<m_stats.frameTime.percentile(50)
+       <<"  p95 "<<m_stats.frameTime.percentile(95)<<"  p99 "<<m_stats.frameTime.percentile(99);
+
+  std::stringstream physics;
+  physics<<std::fixed<<std::setprecision(1);
+  physics<<"physics "<<m_stats.stepTime.getLast()<<" ms  p50 "<<m_stats.stepTime.percentile(50)
+         <<"  p95 "<<m_stats.stepTime.percentile(95)<<"  p99 "<<m_stats.stepTime.percentile(99);
+
+  std::stringstream counters;
+  counters<<"substeps "<<m_stats.substeps<<"  bodies "<<m_stats.activeBodies<<" awake "
+          <<m_stats.sleepingBodies<<" asleep "<<m_stats.islands<<" islands"
+          <<"  contacts "<<m_stats.contacts<<"  pairs "<<m_stats.broadphasePairs<<" broad "
+          <<m_stats.manifolds<<" narrow  draw calls "<<m_stats.drawCalls
+          <<"  governor "<<StepGovernor::levelName(m_stats.governorLevel);
+
+  m_hudText->renderText(10,120,frame.str());
+  m_hudText->renderText(10,150,physics.str());
+  m_hudText->renderText(10,180,counters.str());
+
+  if(m_stats.partyBalls>0)
+  {
+    std::stringstream party;
+    party<<"party balls "<<m_stats.partyBalls<<"  contacts "<<m_stats.partyContacts;
+    m_hudText->renderText(10,270,party.str());
+  }
+
+  if(m_stats.mazeChunks>0)
+  {
+    std::stringstream chunks;
+    chunks<<"maze chunks "<<m_stats.mazeChunks<<"  colliding "<<m_stats.residentChunks<<"  drawn "
+          <<m_stats.drawnChunks<<"  on gpu "<<m_drawChunks.size();
+    m_hudText->renderText(10,300,chunks.str());
+  }
+
+  std::stringstream queue;
+  queue<<"bodies drawn "<<m_stats.drawnBodies<<"  culled "<<m_stats.culledBodies<<"  state changes "<<m_stats.stateChanges;
+  m_hudText->renderText(10,330,queue.str());
+
+  const PerfHistogram &latency=m_stats.inputLatency;
+  if(latency.getCount()>0)
+  {
+    std::stringstream input;
+    input<<std::fixed<<std::setprecision(1);
+    input<<"input to photon "<<latency.getLast()<<" ms  p50 "<<latency.percentile(50)
+         <<"  p95 "<<latency.percentile(95)<<"  p99 "<<latency.percentile(99);
+    m_hudText->renderText(10,210,input.str());
+  }
+
+  if(m_frameBudget>0.0)
+  {
+    const PerfHistogram &gpu=m_stats.gpuTime;
+    std::stringstream scene;
+    scene<<std::fixed<<std::setprecision(1);
+    scene<<"scene "<<m_sceneWidth<<"x"<<m_sceneHeight<<"  msaa "<<m_sceneSamples<<"  gpu "<<gpu.getLast()
+         <<" ms  p95 "<<gpu.percentile(95)<<"  budget "<<m_frameBudget;
+    m_hudText->renderText(10,240,scene.str());
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NGLDraw::createOffscreen(int _w, int _h)
+{
+  if(!createTarget(m_offscreenFBO, m_offscreenBuffers, _w, _h, 0, true))
+  {
+    return false;
+  }
+  m_width=_w;
+  m_height=_h;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NGLDraw::createTarget(GLuint &io_fbo, GLuint *io_buffers, int _w, int _h, int _samples, bool _depth)
+{
+  if(io_fbo==0)
+  {
+    glGenFramebuffers(1, &io_fbo);
+    glGenRenderbuffers(2, io_buffers);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, io_fbo);
+
+  // re-specifying the storage is enough to resize, the attachments stay as they are
+  glBindRenderbuffer(GL_RENDERBUFFER, io_buffers[0]);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, _samples, GL_RGBA8, _w, _h);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, io_buffers[0]);
+
+  if(_depth)
+  {
+    glBindRenderbuffer(GL_RENDERBUFFER, io_buffers[1]);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, _samples, GL_DEPTH_COMPONENT24, _w, _h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, io_buffers[1]);
+  }
+
+  GLenum status=glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if(status!=GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cerr<<"Offscreen framebuffer incomplete "<<std::hex<<status<<std::dec<<"\n";
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::setFrameBudget(float _ms)
+{
+  m_frameBudget=_ms;
+  if(m_frameBudget<=0.0)
+  {
+    return;
+  }
+  if(m_gpuQueries[0]==0)
+  {
+    glGenQueries(2, m_gpuQueries);
+  }
+  m_quality=0;
+  m_overBudget=0;
+  m_underBudget=0;
+  createSceneTargets();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::createSceneTargets()
+{
+  GLint maxSamples=0;
+  glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  const QualityLevel &level=s_quality[m_quality];
+  m_sceneWidth=std::max(1,int(m_width*level.scale));
+  m_sceneHeight=std::max(1,int(m_height*level.scale));
+  m_sceneSamples=std::min(level.samples,int(maxSamples));
+
+  bool complete=createTarget(m_sceneFBO, m_sceneBuffers, m_sceneWidth, m_sceneHeight, m_sceneSamples, true);
+  complete=createTarget(m_resolveFBO, m_resolveBuffers, m_sceneWidth, m_sceneHeight, 0, false) && complete;
+  if(!complete)
+  {
+    // fall back to drawing straight into the window rather than drawing nothing
+    std::cerr<<"Dynamic resolution disabled\n";
+    m_frameBudget=0.0;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+  m_stats.renderScale=level.scale;
+  m_stats.msaaSamples=m_sceneSamples;
+  m_dirty=true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::adaptResolution()
+{
+  // the query from the frame before last has almost always finished, if it hasn't skip a frame
+  // rather than stall waiting for the GPU
+  int previous=m_query^1;
+  if(!m_queryPending[previous])
+  {
+    return;
+  }
+  GLint available=0;
+  glGetQueryObjectiv(m_gpuQueries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+  if(!available)
+  {
+    return;
+  }
+  GLuint64 elapsed=0;
+  glGetQueryObjectui64v(m_gpuQueries[previous], GL_QUERY_RESULT, &elapsed);
+  m_queryPending[previous]=false;
+  float gpuMs=elapsed/1000000.0;
+  m_stats.gpuTime.addSample(gpuMs);
+
+  if(gpuMs > m_frameBudget*0.9)
+  {
+    ++m_overBudget;
+    m_underBudget=0;
+  }
+  else if(gpuMs < m_frameBudget*0.6)
+  {
+    ++m_underBudget;
+    m_overBudget=0;
+  }
+  else
+  {
+    m_overBudget=0;
+    m_underBudget=0;
+  }
+
+  // drop quickly so we stop missing frames, come back up slowly so we don't bounce between levels
+  int quality=m_quality;
+  if(m_overBudget>=5 && m_quality<s_numQuality-1)
+  {
+    ++quality;
+  }
+  else if(m_underBudget>=120 && m_quality>0)
+  {
+    --quality;
+  }
+  if(quality!=m_quality)
+  {
+    m_quality=quality;
+    m_overBudget=0;
+    m_underBudget=0;
+    createSceneTargets();
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void NGLDraw::loadMatricesToTextureShader()
+void NGLDraw::compositeScene()
+{
+  GLuint source=m_sceneFBO;
+  if(m_sceneSamples>0)
+  {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_sceneFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFBO);
+    glBlitFramebuffer(0,0,m_sceneWidth,m_sceneHeight, 0,0,m_sceneWidth,m_sceneHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    source=m_resolveFBO;
+  }
+  bool scaled= m_sceneWidth!=m_width || m_sceneHeight!=m_height;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_offscreenFBO);
+  glBlitFramebuffer(0,0,m_sceneWidth,m_sceneHeight, 0,0,m_width,m_height, GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+  glViewport(0,0,m_width,m_height);
+  // the text is drawn over the scene so only the depth needs clearing
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::readFrame(std::vector <unsigned char> &o_pixels)
+{
+  o_pixels.resize(m_width*m_height*3);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, m_offscreenFBO);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, &o_pixels[0]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int NGLDraw::frameHash()
+{
+  std::vector <unsigned char> pixels;
+  readFrame(pixels);
+  // FNV-1a, enough to spot a frame that differs from the last known good run
+  unsigned int hash=2166136261u;
+  for(unsigned int i=0; i<pixels.size(); ++i)
+  {
+    hash^=pixels[i];
+    hash*=16777619u;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NGLDraw::writeFrame(const std::string &_fileName)
+{
+  std::vector <unsigned char> pixels;
+  readFrame(pixels);
+  std::ofstream fileOut(_fileName.c_str(), std::ios::out | std::ios::binary);
+  if(!fileOut.is_open())
+  {
+    std::cerr<<"Could not open File : "<<_fileName<<" for writing \n";
+    return false;
+  }
+  fileOut<<"P6\n"<<m_width<<" "<<m_height<<"\n255\n";
+  // GL rows start at the bottom, PPM at the top
+  for(int y=m_height-1; y>=0; --y)
+  {
+    fileOut.write((const char *)&pixels[y*m_width*3], m_width*3);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::freeMaze()
+{
+  if(m_mazeMesh)
+  {
+    m_stats.assetBytes[ASSET_MESH]-=meshBytes(m_mazeMesh);
+    delete m_mazeMesh;
+    m_mazeMesh=0;
+  }
+  if(m_mazeVAO)
+  {
+    m_stats.assetBytes[ASSET_MESH]-=m_mazeVAOBytes;
+    m_mazeVAO->removeVOA();
+    delete m_mazeVAO;
+    m_mazeVAO=0;
+    m_mazeVAOBytes=0;
+  }
+  std::map <unsigned int,DrawChunk>::iterator chunk;
+  for(chunk=m_drawChunks.begin(); chunk!=m_drawChunks.end(); ++chunk)
+  {
+    m_stats.assetBytes[ASSET_MESH]-=chunk->second.bytes;
+    chunk->second.vao->removeVOA();
+    delete chunk->second.vao;
+  }
+  m_drawChunks.clear();
+  m_streamMaze=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::setLevel(const Level &_level)
+{
+  //everything slow was done when the level was prepared, this is just the uploads
+  freeMaze();
+  const MazeMesh &mesh=_level.getMesh();
+  m_mazeVAO=createMazeVAO(mesh.vertices,mesh.indices);
+  m_mazeVAOBytes=mesh.vertices.size()*sizeof(MazeVertex)+mesh.indices.size()*sizeof(unsigned int);
+  m_stats.assetBytes[ASSET_MESH]+=m_mazeVAOBytes;
+  if(_level.getTexture())
+  {
+    glDeleteTextures(1,&m_mazeTexture);
+    m_mazeTexture=_level.getTexture()->setTextureGL();
+  }
+  GLint texW, texH;
+  glBindTexture(GL_TEXTURE_2D, m_mazeTexture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D,0,GL_TEXTURE_WIDTH,&texW);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D,0,GL_TEXTURE_HEIGHT,&texH);
+  m_stats.assetBytes[ASSET_TEXTURE]=texW*texH*4;
+  m_dirty=true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ngl::VertexArrayObject *NGLDraw::createMazeVAO(const std::vector <MazeVertex> &_vertices, const std::vector <unsigned int> &_indices)
+{
+  ngl::VertexArrayObject *vao=ngl::VertexArrayObject::createVOA(GL_TRIANGLES);
+  vao->bind();
+  vao->setIndexedData(_vertices.size()*sizeof(MazeVertex),_vertices[0].x,_indices.size(),&_indices[0],GL_UNSIGNED_INT);
+  vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(MazeVertex),0);
+  vao->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(MazeVertex),3);
+  vao->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(MazeVertex),5);
+  vao->setNumIndices(_indices.size());
+  vao->unbind();
+  return vao;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::drawMazeChunks()
+{
+  ngl::Mat4 M=m_bodyTransform*m_transformStack.getCurrentTransform().getMatrix()*m_mouseGlobalTX;
+  m_frustum.set(M*m_cam->getVPMatrix());
+  //the camera in the maze's space, M only rotates and moves so its inverse is its transpose
+  float eye[3]={m_cam->getEye().m_x-M.m_m[3][0],m_cam->getEye().m_y-M.m_m[3][1],m_cam->getEye().m_z-M.m_m[3][2]};
+  float eyeX=eye[0]*M.m_m[0][0]+eye[1]*M.m_m[0][1]+eye[2]*M.m_m[0][2];
+  float eyeZ=eye[0]*M.m_m[2][0]+eye[1]*M.m_m[2][1]+eye[2]*M.m_m[2][2];
+
+  unsigned int drawn=0;
+  unsigned int uploads=0;
+  unsigned int x0, z0, x1, z1;
+  if(m_streamMaze->getChunkRange(eyeX-DRAW_DISTANCE,eyeZ-DRAW_DISTANCE,eyeX+DRAW_DISTANCE,eyeZ+DRAW_DISTANCE,x0,z0,x1,z1))
+  {
+    MazeMesh mesh;
+    for(unsigned int z=z0; z<=z1; ++z)
+    {
+      for(unsigned int x=x0; x<=x1; ++x)
+      {
+        unsigned int index=z*m_streamMaze->getChunksX()+x;
+        ngl::Vec3 min, max;
+        m_streamMaze->getChunkBounds(index,min,max);
+        if(!m_frustum.intersects(min,max))
+        {
+          continue;
+        }
+        std::map <unsigned int,DrawChunk>::iterator chunk=m_drawChunks.find(index);
+        if(chunk==m_drawChunks.end())
+        {
+          if(uploads==MAX_CHUNK_UPLOADS)
+          {
+            continue;
+          }
+          ++uploads;
+          m_streamMaze->buildChunk(index,mesh);
+          DrawChunk c;
+          c.vao=createMazeVAO(mesh.vertices,mesh.indices);
+          c.bytes=mesh.vertices.size()*sizeof(MazeVertex)+mesh.indices.size()*sizeof(unsigned int);
+          m_stats.assetBytes[ASSET_MESH]+=c.bytes;
+          chunk=m_drawChunks.insert(std::make_pair(index,c)).first;
+        }
+        chunk->second.lastDrawn=m_frame;
+        chunk->second.vao->bind();
+        chunk->second.vao->draw();
+        chunk->second.vao->unbind();
+        ++m_drawCalls;
+        ++drawn;
+      }
+    }
+  }
+  m_stats.drawnChunks=drawn;
+
+  std::map <unsigned int,DrawChunk>::iterator chunk=m_drawChunks.begin();
+  while(chunk!=m_drawChunks.end())
+  {
+    if(m_frame-chunk->second.lastDrawn<CHUNK_KEEP_FRAMES)
+    {
+      ++chunk;
+      continue;
+    }
+    m_stats.assetBytes[ASSET_MESH]-=chunk->second.bytes;
+    chunk->second.vao->removeVOA();
+    delete chunk->second.vao;
+    m_drawChunks.erase(chunk++);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NGLDraw::loadMatricesToTextureShader(bool _use)
 {
   ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-  (*shader)["TextureShader"]->use();
+  if(_use)
+  {
+    (*shader)["TextureShader"]->use();
+  }
   ngl::Mat4 MV;
   ngl::Mat4 MVP;
   ngl::Mat3 normalMatrix;
@@ -250,10 +1048,13 @@ void NGLDraw::loadMatricesToTextureShader()
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void NGLDraw::loadMatricesToPhongShader()
+void NGLDraw::loadMatricesToPhongShader(const std::string &_program, bool _use)
 {
   ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-  (*shader)["Phong"]->use();
+  if(_use)
+  {
+    (*shader)[_program]->use();
+  }
   ngl::Mat4 MV;
   ngl::Mat4 MVP;
   ngl::Mat3 normalMatrix;
@@ -282,7 +1083,7 @@ void NGLDraw::mouseMoveEvent (const SDL_MouseMotionEvent &_event)
     m_spinYFace += (float) 0.5f * diffx;
     m_origX = _event.x;
     m_origY = _event.y;
-    this->draw();
+    m_dirty=true;
 
   }
 
@@ -294,7 +1095,7 @@ void NGLDraw::mouseMoveEvent (const SDL_MouseMotionEvent &_event)
     m_origZPos = _event.y;
     m_modelPos.m_x -= INCREMENT * diffX;
     m_modelPos.m_z -= INCREMENT * diffZ;
-    this->draw();
+    m_dirty=true;
   }
 }
 
@@ -337,217 +1138,28 @@ void NGLDraw::wheelEvent(const SDL_MouseWheelEvent &_event)
   if(_event.y > 0)
   {
     m_modelPos.m_y+=ZOOM;
-    this->draw();
+    m_dirty=true;
   }
   else if(_event.y <0 )
   {
     m_modelPos.m_y-=ZOOM;
-    this->draw();
+    m_dirty=true;
   }
 
   if(_event.x > 0)
   {
     m_modelPos.m_x-=ZOOM;
-    this->draw();
+    m_dirty=true;
   }
   else if(_event.x <0 )
   {
     m_modelPos.m_x+=ZOOM;
-    this->draw();
-  }
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-void NGLDraw::rotateMazeXUP(float angleUpdate)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    if(m_physics->getBodyNameAtIndex(i) == "maze")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(angleUpdate/2));
-      local.setX(sin(angleUpdate/2));
-      total = local * total;
-      m_physics->setRot(i, total);
-    }
-    if(m_physics->getBodyNameAtIndex(i) == "cube")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(angleUpdate/2));
-      local.setX(sin(angleUpdate/2));
-      total = local * total;
-      m_physics->setRotAboutOrigin(i, total);
-    }
-  }
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-void NGLDraw::rotateMazeZRIGHT(float angleUpdate)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    if(m_physics->getBodyNameAtIndex(i) =="maze")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(angleUpdate/2));
-      local.setZ(sin(angleUpdate/2));
-      total = local * total;
-      m_physics->setRot(i, total);
-    }
-    if(m_physics->getBodyNameAtIndex(i) =="cube")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(angleUpdate/2));
-      local.setZ(sin(angleUpdate/2));
-      total = local * total;
-      m_physics->setRotAboutOrigin(i, total);
-    }
-  }
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-void NGLDraw::rotateMazeXDOWN(float angleUpdate)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    if(m_physics->getBodyNameAtIndex(i) == "maze")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(-angleUpdate/2));
-      local.setX(sin(-angleUpdate/2));
-      total = local * total;
-      m_physics->setRot(i, total);
-    }
-    if(m_physics->getBodyNameAtIndex(i) == "cube")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(-angleUpdate/2));
-      local.setX(sin(-angleUpdate/2));
-      total = local * total;
-      m_physics->setRotAboutOrigin(i, total);
-    }
-  }
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-void NGLDraw::rotateMazeZLEFT(float angleUpdate)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    if(m_physics->getBodyNameAtIndex(i)=="maze")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(-angleUpdate/2));
-      local.setZ(sin(-angleUpdate/2));
-      total = local * total;
-      m_physics->setRot(i, total);
-    }
-
-    if(m_physics->getBodyNameAtIndex(i)=="cube")
-    {
-      btQuaternion total;
-      total = m_physics->getRotation(i);
-      btQuaternion local;
-      local.setW(cos(-angleUpdate/2));
-      local.setZ(sin(-angleUpdate/2));
-      total = local * total;
-      m_physics->setRotAboutOrigin(i, total);
-    }
+    m_dirty=true;
   }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-bool NGLDraw::lose(float _friction)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    if(m_physics->getBodyNameAtIndex(i)=="ball")
-    {
-      ngl::Vec3 pos = m_physics->getPosition(i);
-      if(pos.m_y < 3)
-      {
-        m_physics->reset();
-        m_physics->addMaze("maze",ngl::Vec3(0,20,0), _friction);
-        m_physics->addSphere("ball", ngl::Vec3(-15,25,-15), _friction);
-        m_physics->addCube("cube",ngl::Vec3(0,17,0));
-        setGameState(2);
-        m_lost=1;
-        break;
-      }
-      else
-      {
-        m_lost =0;
-        break;
-      }
-    }
-  }
-
-  return m_lost;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-bool NGLDraw::win(float _friction)
-{
-  unsigned int bodies=m_physics->getNumCollisionObjects();
-  for(unsigned int i=1; i<bodies; ++i)
-  {
-    for(unsigned int j=1; j<bodies; ++j)
-    {
-      if(m_physics->getBodyNameAtIndex(i)=="ball" && m_physics->getBodyNameAtIndex(j)=="cube")
-      {
-        if(m_physics->contactTest(i,j)==true)
-        {
-          m_physics->reset();
-          m_physics->addMaze("maze",ngl::Vec3(0,20,0), _friction);
-          m_physics->addSphere("ball", ngl::Vec3(-15,25,-15), _friction);
-          m_physics->addCube("cube",ngl::Vec3(0,17,0));
-          setGameState(3);
-          m_win=1;
-          break;
-        }
-        else if(m_physics->contactTest(i,j)==false)
-        {
-          m_win=0;
-          break;
-        }
-      }
-    }
-  }
-  return m_win;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-void NGLDraw::createball(float _friction)
-{
-  m_physics->addSphere("ball", ngl::Vec3(-15,25,-15), _friction);
-}
-
 void NGLDraw::text(std::string _text)
 {
   m_text->setColour(0,0,0);
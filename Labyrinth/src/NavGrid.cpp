@@ -0,0 +1,481 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NavGrid.cpp
+/// @brief 2D occupancy grid of a maze with a distance field to the goal, cached next to the obj
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "NavGrid.h"
+#include <ngl/Obj.h>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief size of a cell, a little under the ball's radius
+//----------------------------------------------------------------------------------------------------------------------
+const static float CELL_SIZE=0.5;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how far from walls and holes the path tries to keep (the ball's radius and a bit)
+//----------------------------------------------------------------------------------------------------------------------
+const static float CLEARANCE=0.6;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief anything this much higher than the floor is a wall
+//----------------------------------------------------------------------------------------------------------------------
+const static float WALL_STEP=0.5;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cost of a straight and diagonal step, and extra for stepping into a cell close to a wall or hole
+//----------------------------------------------------------------------------------------------------------------------
+const static uint32_t STRAIGHT_COST=10;
+const static uint32_t DIAGONAL_COST=14;
+const static uint32_t CLOSE_COST=30;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief neighbours, straight ones first
+//----------------------------------------------------------------------------------------------------------------------
+const static int s_dx[8]={1,-1,0,0,1,1,-1,-1};
+const static int s_dz[8]={0,0,1,-1,1,-1,1,-1};
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cache file header
+//----------------------------------------------------------------------------------------------------------------------
+const static char NAV_MAGIC[4]={'L','N','A','V'};
+const static uint32_t NAV_VERSION=2;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief FNV-1a over some bytes
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t fnv1a(uint32_t _hash, const char *_data, size_t _size)
+{
+  for(size_t i=0; i<_size; ++i)
+  {
+    _hash^=(unsigned char)_data[i];
+    _hash*=16777619u;
+  }
+  return _hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+NavGrid::NavGrid()
+{
+  m_key=0;
+  m_width=0;
+  m_depth=0;
+  m_originX=0.0;
+  m_originZ=0.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+uint32_t NavGrid::makeKey(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax)
+{
+  std::ifstream file(_objFile.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return 0;
+  }
+  uint32_t hash=2166136261u;
+  char buffer[4096];
+  while(file.read(buffer,sizeof(buffer)) || file.gcount()>0)
+  {
+    hash=fnv1a(hash,buffer,file.gcount());
+  }
+  // anything that changes the result goes in the key as well
+  float settings[8]={CELL_SIZE,CLEARANCE,WALL_STEP,_goalMin.m_x,_goalMin.m_z,_goalMax.m_x,_goalMax.m_z,float(NAV_VERSION)};
+  hash=fnv1a(hash,reinterpret_cast<const char *>(settings),sizeof(settings));
+  // 0 is kept for "any"
+  return hash==0 ? 1 : hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::loadOrBuild(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax)
+{
+  uint32_t key=makeKey(_objFile,_goalMin,_goalMax);
+  if(key==0)
+  {
+    std::cerr<<"Unable to read maze "<<_objFile<<"\n";
+    return false;
+  }
+  std::string cache=_objFile+".nav";
+  if(load(cache,key))
+  {
+    return true;
+  }
+  if(!build(_objFile,_goalMin,_goalMax))
+  {
+    return false;
+  }
+  if(!save(cache))
+  {
+    // not fatal, it is just built again next time
+    std::cerr<<"Unable to write nav grid cache "<<cache<<"\n";
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::build(const std::string &_objFile, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax)
+{
+  uint32_t key=makeKey(_objFile,_goalMin,_goalMax);
+  if(key==0)
+  {
+    m_width=0;
+    return false;
+  }
+  ngl::Obj mesh(_objFile);
+  std::vector <ngl::Vec3> verts=mesh.getVertexList();
+  std::vector <ngl::Face> faces=mesh.getFaceList();
+
+  // faces with more than three corners are split into a fan
+  std::vector <ngl::Vec3> triangles;
+  for(unsigned int f=0; f<faces.size(); ++f)
+  {
+    const ngl::Face &face=faces[f];
+    for(unsigned int k=1; k+1<face.m_vert.size(); ++k)
+    {
+      triangles.push_back(verts[face.m_vert[0]]);
+      triangles.push_back(verts[face.m_vert[k]]);
+      triangles.push_back(verts[face.m_vert[k+1]]);
+    }
+  }
+  if(!build(triangles,_goalMin,_goalMax))
+  {
+    return false;
+  }
+  m_key=key;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::build(const std::vector <ngl::Vec3> &_triangles, const ngl::Vec3 &_goalMin, const ngl::Vec3 &_goalMax)
+{
+  m_key=0;
+  if(_triangles.size()<3)
+  {
+    m_width=0;
+    return false;
+  }
+
+  float minX=_triangles[0].m_x, maxX=_triangles[0].m_x, minZ=_triangles[0].m_z, maxZ=_triangles[0].m_z;
+  for(unsigned int i=1; i<_triangles.size(); ++i)
+  {
+    minX=std::min(minX,_triangles[i].m_x);
+    maxX=std::max(maxX,_triangles[i].m_x);
+    minZ=std::min(minZ,_triangles[i].m_z);
+    maxZ=std::max(maxZ,_triangles[i].m_z);
+  }
+  m_originX=minX;
+  m_originZ=minZ;
+  m_width=std::max(1,int(ceil((maxX-minX)/CELL_SIZE)));
+  m_depth=std::max(1,int(ceil((maxZ-minZ)/CELL_SIZE)));
+  unsigned int cells=m_width*m_depth;
+
+  // height of the highest surface above the centre of each cell, found by testing the centres
+  // inside each triangle's bounds against it. Walls are closed boxes so their tops are found
+  // and the sides, which can't be stood on, are skipped
+  std::vector <float> top(cells,0.0);
+  std::vector <bool> covered(cells,false);
+  for(unsigned int t=0; t+2<_triangles.size(); t+=3)
+  {
+    const ngl::Vec3 &a=_triangles[t];
+    const ngl::Vec3 &b=_triangles[t+1];
+    const ngl::Vec3 &c=_triangles[t+2];
+    // twice the signed area on the x / z plane, 0 for a side
+    float area=(b.m_x-a.m_x)*(c.m_z-a.m_z)-(c.m_x-a.m_x)*(b.m_z-a.m_z);
+    if(fabs(area)<1e-6)
+    {
+      continue;
+    }
+    int x0=std::max(0,int((std::min(a.m_x,std::min(b.m_x,c.m_x))-m_originX)/CELL_SIZE));
+    int x1=std::min(int(m_width)-1,int((std::max(a.m_x,std::max(b.m_x,c.m_x))-m_originX)/CELL_SIZE));
+    int z0=std::max(0,int((std::min(a.m_z,std::min(b.m_z,c.m_z))-m_originZ)/CELL_SIZE));
+    int z1=std::min(int(m_depth)-1,int((std::max(a.m_z,std::max(b.m_z,c.m_z))-m_originZ)/CELL_SIZE));
+    for(int z=z0; z<=z1; ++z)
+    {
+      for(int x=x0; x<=x1; ++x)
+      {
+        float px=m_originX+(x+0.5f)*CELL_SIZE;
+        float pz=m_originZ+(z+0.5f)*CELL_SIZE;
+        // barycentric weights, all the same sign as the area when inside
+        float wa=((b.m_x-px)*(c.m_z-pz)-(c.m_x-px)*(b.m_z-pz))/area;
+        float wb=((c.m_x-px)*(a.m_z-pz)-(a.m_x-px)*(c.m_z-pz))/area;
+        float wc=1.0f-wa-wb;
+        if(wa<0.0 || wb<0.0 || wc<0.0)
+        {
+          continue;
+        }
+        float y=wa*a.m_y+wb*b.m_y+wc*c.m_y;
+        unsigned int i=z*m_width+x;
+        if(!covered[i] || y>top[i])
+        {
+          top[i]=y;
+          covered[i]=true;
+        }
+      }
+    }
+  }
+
+  // the floor is the lowest surface there is, anything well above it is a wall
+  float floor=0.0;
+  bool haveFloor=false;
+  for(unsigned int i=0; i<cells; ++i)
+  {
+    if(covered[i] && (!haveFloor || top[i]<floor))
+    {
+      floor=top[i];
+      haveFloor=true;
+    }
+  }
+  m_cells.assign(cells,NAV_HOLE);
+  for(unsigned int z=0; z<m_depth; ++z)
+  {
+    for(unsigned int x=0; x<m_width; ++x)
+    {
+      unsigned int i=z*m_width+x;
+      float px=m_originX+(x+0.5f)*CELL_SIZE;
+      float pz=m_originZ+(z+0.5f)*CELL_SIZE;
+      bool goal=px>=_goalMin.m_x && px<=_goalMax.m_x && pz>=_goalMin.m_z && pz<=_goalMax.m_z;
+      if(!covered[i])
+      {
+        // a goal sitting in a hole in the floor fills it
+        m_cells[i]= goal ? NAV_GOAL : NAV_HOLE;
+        continue;
+      }
+      if(top[i]>floor+WALL_STEP)
+      {
+        m_cells[i]=NAV_WALL;
+        continue;
+      }
+      m_cells[i]= goal ? NAV_GOAL : NAV_FLOOR;
+    }
+  }
+  buildField();
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void NavGrid::buildField()
+{
+  unsigned int cells=m_width*m_depth;
+  int w=m_width;
+  int d=m_depth;
+
+  // cells close enough to a wall or hole that the ball would touch it
+  int reach=int(ceil(CLEARANCE/CELL_SIZE));
+  std::vector <bool> close(cells,false);
+  for(int z=0; z<d; ++z)
+  {
+    for(int x=0; x<w; ++x)
+    {
+      uint8_t c=m_cells[z*w+x];
+      if(c!=NAV_WALL && c!=NAV_HOLE)
+      {
+        continue;
+      }
+      for(int j=std::max(0,z-reach); j<=std::min(d-1,z+reach); ++j)
+      {
+        for(int i=std::max(0,x-reach); i<=std::min(w-1,x+reach); ++i)
+        {
+          close[j*w+i]=true;
+        }
+      }
+    }
+  }
+
+  // dijkstra out from the goal cells
+  typedef std::pair <uint32_t, unsigned int> Entry;
+  std::priority_queue <Entry, std::vector <Entry>, std::greater <Entry> > open;
+  m_distance.assign(cells,NAV_UNREACHABLE);
+  for(unsigned int i=0; i<cells; ++i)
+  {
+    if(m_cells[i]==NAV_GOAL)
+    {
+      m_distance[i]=0;
+      open.push(Entry(0,i));
+    }
+  }
+  while(!open.empty())
+  {
+    Entry e=open.top();
+    open.pop();
+    if(e.first>m_distance[e.second])
+    {
+      continue;
+    }
+    int x=e.second%w;
+    int z=e.second/w;
+    for(int n=0; n<8; ++n)
+    {
+      int nx=x+s_dx[n];
+      int nz=z+s_dz[n];
+      if(nx<0 || nx>=w || nz<0 || nz>=d)
+      {
+        continue;
+      }
+      unsigned int ni=nz*w+nx;
+      if(m_cells[ni]!=NAV_FLOOR)
+      {
+        continue;
+      }
+      // no cutting a corner of a wall or hole
+      if(n>=4 && (m_cells[z*w+nx]==NAV_WALL || m_cells[z*w+nx]==NAV_HOLE ||
+                  m_cells[nz*w+x]==NAV_WALL || m_cells[nz*w+x]==NAV_HOLE))
+      {
+        continue;
+      }
+      uint32_t cost=e.first+(n<4 ? STRAIGHT_COST : DIAGONAL_COST)+(close[ni] ? CLOSE_COST : 0);
+      if(cost<m_distance[ni])
+      {
+        m_distance[ni]=cost;
+        open.push(Entry(cost,ni));
+      }
+    }
+  }
+
+  // each cell heads for its cheapest neighbour, the moves allowed are the same both ways round
+  m_direction.assign(cells,-1);
+  for(int z=0; z<d; ++z)
+  {
+    for(int x=0; x<w; ++x)
+    {
+      unsigned int i=z*w+x;
+      if(m_cells[i]!=NAV_FLOOR || m_distance[i]==NAV_UNREACHABLE)
+      {
+        continue;
+      }
+      uint32_t best=m_distance[i];
+      for(int n=0; n<8; ++n)
+      {
+        int nx=x+s_dx[n];
+        int nz=z+s_dz[n];
+        if(nx<0 || nx>=w || nz<0 || nz>=d)
+        {
+          continue;
+        }
+        if(n>=4 && (m_cells[z*w+nx]==NAV_WALL || m_cells[z*w+nx]==NAV_HOLE ||
+                    m_cells[nz*w+x]==NAV_WALL || m_cells[nz*w+x]==NAV_HOLE))
+        {
+          continue;
+        }
+        if(m_distance[nz*w+nx]<best)
+        {
+          best=m_distance[nz*w+nx];
+          m_direction[i]=n;
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::save(const std::string &_file) const
+{
+  std::ofstream file(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  uint32_t header[4]={NAV_VERSION,m_key,m_width,m_depth};
+  float origin[2]={m_originX,m_originZ};
+  file.write(NAV_MAGIC,sizeof(NAV_MAGIC));
+  file.write(reinterpret_cast<const char *>(header),sizeof(header));
+  file.write(reinterpret_cast<const char *>(origin),sizeof(origin));
+  file.write(reinterpret_cast<const char *>(&m_cells[0]),m_cells.size());
+  file.write(reinterpret_cast<const char *>(&m_distance[0]),m_distance.size()*sizeof(uint32_t));
+  file.write(reinterpret_cast<const char *>(&m_direction[0]),m_direction.size());
+  return file.good();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::load(const std::string &_file, uint32_t _key)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  char magic[4];
+  uint32_t header[4];
+  float origin[2];
+  file.read(magic,sizeof(magic));
+  file.read(reinterpret_cast<char *>(header),sizeof(header));
+  file.read(reinterpret_cast<char *>(origin),sizeof(origin));
+  if(!file || memcmp(magic,NAV_MAGIC,sizeof(magic))!=0 || header[0]!=NAV_VERSION ||
+     (_key!=0 && header[1]!=_key) || header[2]==0 || header[3]==0 || header[2]*header[3]>(1u<<24))
+  {
+    return false;
+  }
+  unsigned int cells=header[2]*header[3];
+  std::vector <uint8_t> types(cells);
+  std::vector <uint32_t> distance(cells);
+  std::vector <int8_t> direction(cells);
+  file.read(reinterpret_cast<char *>(&types[0]),cells);
+  file.read(reinterpret_cast<char *>(&distance[0]),cells*sizeof(uint32_t));
+  file.read(reinterpret_cast<char *>(&direction[0]),cells);
+  if(!file)
+  {
+    return false;
+  }
+  m_key=header[1];
+  m_width=header[2];
+  m_depth=header[3];
+  m_originX=origin[0];
+  m_originZ=origin[1];
+  m_cells.swap(types);
+  m_distance.swap(distance);
+  m_direction.swap(direction);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int NavGrid::cellIndex(const ngl::Vec3 &_local) const
+{
+  float fx=(_local.m_x-m_originX)/CELL_SIZE;
+  float fz=(_local.m_z-m_originZ)/CELL_SIZE;
+  if(fx<0.0 || fz<0.0 || fx>=m_width || fz>=m_depth)
+  {
+    return -1;
+  }
+  return int(fz)*m_width+int(fx);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::reachable(const ngl::Vec3 &_local) const
+{
+  return getDistance(_local)!=NAV_UNREACHABLE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+uint32_t NavGrid::getDistance(const ngl::Vec3 &_local) const
+{
+  int i=cellIndex(_local);
+  return i<0 ? NAV_UNREACHABLE : m_distance[i];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool NavGrid::getDirection(const ngl::Vec3 &_local, float &o_x, float &o_z) const
+{
+  int i=cellIndex(_local);
+  if(i<0 || m_direction[i]<0)
+  {
+    return false;
+  }
+  int n=m_direction[i];
+  // diagonals are scaled to unit length
+  float scale= n<4 ? 1.0f : 0.70710678f;
+  o_x=s_dx[n]*scale;
+  o_z=s_dz[n]*scale;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
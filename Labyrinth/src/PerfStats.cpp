@@ -0,0 +1,127 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PerfStats.cpp
+/// @brief rolling performance counters and fixed bucket histograms used by the in game HUD
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "PerfStats.h"
+#include <cassert>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+PerfHistogram::PerfHistogram(float _bucketWidth, unsigned int _numBuckets, unsigned int _window)
+{
+  assert(_numBuckets>0 && _window>0);
+  m_bucketWidth=_bucketWidth;
+  m_buckets.resize(_numBuckets,0);
+  m_window.resize(_window,0);
+  m_head=0;
+  m_count=0;
+  m_last=0.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PerfHistogram::addSample(float _value)
+{
+  m_last=_value;
+  unsigned int bucket=0;
+  if(_value > 0.0)
+  {
+    bucket=(unsigned int)(_value/m_bucketWidth);
+  }
+  if(bucket >= m_buckets.size())
+  {
+    bucket=m_buckets.size()-1;
+  }
+  //window full so drop the oldest sample from its bucket
+  if(m_count==m_window.size())
+  {
+    --m_buckets[m_window[m_head]];
+  }
+  else
+  {
+    ++m_count;
+  }
+  m_window[m_head]=bucket;
+  ++m_buckets[bucket];
+  m_head=(m_head+1)%m_window.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+float PerfHistogram::percentile(float _p) const
+{
+  if(m_count==0)
+  {
+    return 0.0;
+  }
+  //rank of the sample we want, rounded up so p100 is the last sample
+  unsigned int rank=(unsigned int)(_p/100.0*m_count+0.999);
+  if(rank<1)
+  {
+    rank=1;
+  }
+  unsigned int total=0;
+  for(unsigned int i=0; i<m_buckets.size(); ++i)
+  {
+    total+=m_buckets[i];
+    if(total>=rank)
+    {
+      return (i+1)*m_bucketWidth;
+    }
+  }
+  return m_buckets.size()*m_bucketWidth;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PerfHistogram::clear()
+{
+  for(unsigned int i=0; i<m_buckets.size(); ++i)
+  {
+    m_buckets[i]=0;
+  }
+  m_head=0;
+  m_count=0;
+  m_last=0.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+PerfStats::PerfStats() :
+  frameTime(0.1,1000,600),
+  stepTime(0.1,1000,600),
+  inputLatency(0.1,1000,600),
+  gpuTime(0.1,1000,600),
+  substeps(0),
+  activeBodies(0),
+  sleepingBodies(0),
+  islands(0),
+  contacts(0),
+  broadphasePairs(0),
+  manifolds(0),
+  partyBalls(0),
+  partyContacts(0),
+  mazeChunks(0),
+  residentChunks(0),
+  drawnChunks(0),
+  drawnBodies(0),
+  culledBodies(0),
+  stateChanges(0),
+  drawCalls(0),
+  renderScale(1.0),
+  msaaSamples(0),
+  governorLevel(0),
+  frames(0),
+  physicsSteps(0),
+  totalSubsteps(0),
+  wins(0),
+  losses(0)
+{
+  for(unsigned int i=0; i<ASSET_CATEGORIES; ++i)
+  {
+    assetBytes[i]=0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
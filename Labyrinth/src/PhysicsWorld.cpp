@@ -5,12 +5,55 @@
 
 #include "PhysicsWorld.h"
 #include "CollisionShape.h"
+#include "MaterialTable.h"
+#include "SdfCollision.h"
 #include <ngl/Obj.h>
-#include "NGLDraw.h"
+#include <cmath>
+#include <algorithm>
 
 //----------------------------------------------------------------------------------------------------------------------
 
-PhysicsWorld::PhysicsWorld()
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief handles for the axis sweeps, the 16 bit one can't go higher than 32767
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned short SWEEP_HANDLES=16384;
+const static unsigned int SWEEP32_HANDLES=65536;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief speeds below which a ball counts as resting (units/s and rad/s), bullet puts an island to
+/// sleep once every body in it has rested for 2 seconds. Bullet's defaults of 0.8 and 1.0 would
+/// freeze a ball starting to roll off a gently tilted floor
+//----------------------------------------------------------------------------------------------------------------------
+const static btScalar BALL_SLEEP_LINEAR=0.3;
+const static btScalar BALL_SLEEP_ANGULAR=0.5;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief ticks without a tilt before the maze and goal are put to sleep, the first still step
+/// zeroes the velocity bullet works out for them from their motion states
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int KINEMATIC_SETTLE_TICKS=2;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief party balls lower than this have fallen off the maze, the same height the player's ball
+/// is lost at
+//----------------------------------------------------------------------------------------------------------------------
+const static float SWARM_KILL_HEIGHT=3.0;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief called by bullet for each new contact point involving a body flagged with
+/// CF_CUSTOM_MATERIAL_CALLBACK, replaces the combined friction and restitution bullet worked out
+/// from the two bodies with the entry for their materials
+//----------------------------------------------------------------------------------------------------------------------
+static bool materialContactAdded(btManifoldPoint &io_cp, const btCollisionObjectWrapper *_obj0, int _partId0, int _index0, const btCollisionObjectWrapper *_obj1, int _partId1, int _index1)
+{
+	const MaterialPair &pair=MaterialTable::instance()->get(_obj0->getCollisionObject()->getUserIndex(),_obj1->getCollisionObject()->getUserIndex());
+	io_cp.m_combinedFriction=pair.friction;
+	io_cp.m_combinedRestitution=pair.restitution;
+	io_cp.m_combinedRollingFriction=pair.rollingFriction;
+	//bullet ignores the return value
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+PhysicsWorld::PhysicsWorld(BroadphaseType _broadphase, const ngl::Vec3 &_worldMin, const ngl::Vec3 &_worldMax)
 {
 	///collision configuration contains default setup for memory, collision setup. Advanced users can create their own configuration.
 	m_collisionConfiguration = new btDefaultCollisionConfiguration();
@@ -18,8 +61,16 @@ PhysicsWorld::PhysicsWorld()
 	///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
 	m_dispatcher = new	btCollisionDispatcher(m_collisionConfiguration);
 
-	///btDbvtBroadphase is a good general purpose broadphase. You can also try out btAxis3Sweep.
-	m_overlappingPairCache = new btDbvtBroadphase();
+	///balls against a maze made by CollisionShape::addMazeSdf look the contact up in its distance field
+	m_sdfCreateFunc = new SdfCollisionAlgorithm::CreateFunc;
+	m_sdfSwappedCreateFunc = new SdfCollisionAlgorithm::CreateFunc;
+	m_sdfSwappedCreateFunc->m_swapped=true;
+	m_dispatcher->registerCollisionCreateFunc(SPHERE_SHAPE_PROXYTYPE,CUSTOM_CONCAVE_SHAPE_TYPE,m_sdfCreateFunc);
+	m_dispatcher->registerCollisionCreateFunc(CONVEX_HULL_SHAPE_PROXYTYPE,CUSTOM_CONCAVE_SHAPE_TYPE,m_sdfCreateFunc);
+	m_dispatcher->registerCollisionCreateFunc(CUSTOM_CONCAVE_SHAPE_TYPE,SPHERE_SHAPE_PROXYTYPE,m_sdfSwappedCreateFunc);
+	m_dispatcher->registerCollisionCreateFunc(CUSTOM_CONCAVE_SHAPE_TYPE,CONVEX_HULL_SHAPE_PROXYTYPE,m_sdfSwappedCreateFunc);
+
+	createBroadphase(_broadphase,_worldMin,_worldMax);
 
 	///the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
 	m_solver = new btSequentialImpulseConstraintSolver;
@@ -27,8 +78,74 @@ PhysicsWorld::PhysicsWorld()
 	m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher,m_overlappingPairCache,m_solver,m_collisionConfiguration);
 
 	m_dynamicsWorld->getSolverInfo().m_solverMode = SOLVER_USE_WARMSTARTING + SOLVER_SIMD;
+	m_maxDisplacement=0.0;
+	m_ballsCollide=true;
+	m_stillTicks=0;
+	m_swarm=0;
+	gContactAddedCallback=materialContactAdded;
 
+}
+
+//----------------------------------------------------------------------------------------------------------------------
 
+void PhysicsWorld::createBroadphase(BroadphaseType _broadphase, const ngl::Vec3 &_worldMin, const ngl::Vec3 &_worldMax)
+{
+	///btDbvtBroadphase is a good general purpose broadphase, the axis sweeps only cover the bounds given
+	btVector3 worldMin(_worldMin.m_x,_worldMin.m_y,_worldMin.m_z);
+	btVector3 worldMax(_worldMax.m_x,_worldMax.m_y,_worldMax.m_z);
+	m_broadphase=_broadphase;
+	switch(_broadphase)
+	{
+		case BROADPHASE_SWEEP :
+			m_overlappingPairCache = new btAxisSweep3(worldMin,worldMax,SWEEP_HANDLES);
+			m_maxBodies=SWEEP_HANDLES;
+		break;
+		case BROADPHASE_SWEEP32 :
+			m_overlappingPairCache = new bt32BitAxisSweep3(worldMin,worldMax,SWEEP32_HANDLES);
+			m_maxBodies=SWEEP32_HANDLES;
+		break;
+		default :
+			m_overlappingPairCache = new btDbvtBroadphase();
+			m_broadphase=BROADPHASE_DBVT;
+			m_maxBodies=~0u;
+		break;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::setBroadphase(BroadphaseType _broadphase, const ngl::Vec3 &_worldMin, const ngl::Vec3 &_worldMax)
+{
+	//the dbvt grows to fit whatever it is given, there is nothing to change
+	if(_broadphase==BROADPHASE_DBVT && m_broadphase==BROADPHASE_DBVT)
+	{
+		return;
+	}
+	//every body in the world leaves the old broadphase and joins the new one with the same filter, in
+	//the same order so the collision objects stay in step with m_bodies
+	std::vector <int> groups(m_bodies.size(),-1);
+	std::vector <int> masks(m_bodies.size(),0);
+	for(unsigned int i=0; i<m_bodies.size(); ++i)
+	{
+		btBroadphaseProxy *proxy=m_bodies[i].body->getBroadphaseHandle();
+		if(proxy!=0)
+		{
+			groups[i]=proxy->m_collisionFilterGroup;
+			masks[i]=proxy->m_collisionFilterMask;
+			m_dynamicsWorld->removeRigidBody(m_bodies[i].body);
+		}
+	}
+	btBroadphaseInterface *old=m_overlappingPairCache;
+	createBroadphase(_broadphase,_worldMin,_worldMax);
+	m_dynamicsWorld->setBroadphase(m_overlappingPairCache);
+	delete old;
+	for(unsigned int i=0; i<m_bodies.size(); ++i)
+	{
+		if(groups[i]>=0)
+		{
+			m_dynamicsWorld->addRigidBody(m_bodies[i].body,groups[i],masks[i]);
+		}
+	}
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -51,12 +168,23 @@ void PhysicsWorld::addSphere(std::string _shapeName,const ngl::Vec3 &_pos, float
 
 	btRigidBody * fallRigidBody = new btRigidBody(fallRigidBodyCI);
 	fallRigidBody->setFriction(_friction);
-	//set collision flag for contact test call back
+	//sweep a sphere a little smaller than the ball whenever it moves more than half its radius in a
+	//substep, so a ball that is too fast for the substeps still can't pass through a wall
+	btVector3 centre;
+	btScalar radius;
+	fallshape->getBoundingSphere(centre,radius);
+	fallRigidBody->setCcdMotionThreshold(radius*0.5);
+	fallRigidBody->setCcdSweptSphereRadius(radius*0.9);
+	fallRigidBody->setSleepingThresholds(BALL_SLEEP_LINEAR,BALL_SLEEP_ANGULAR);
+	//every contact has a ball in it, so flagging the balls is enough for the material table to
+	//cover all of them
+	fallRigidBody->setUserIndex(MATERIAL_BALL);
 	fallRigidBody->setCollisionFlags(fallRigidBody->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
-	m_dynamicsWorld->addRigidBody(fallRigidBody);
+	m_dynamicsWorld->addRigidBody(fallRigidBody, COL_BALL, ballMask());
 	Body b;
 	b.name= _shapeName;
 	b.body =fallRigidBody;
+	b.parked=false;
 	m_bodies.push_back(b);
 
 }
@@ -80,11 +208,13 @@ void PhysicsWorld::addGroundPlane(const ngl::Vec3 &_pos, const ngl::Vec3 &_size)
 			btRigidBody* body = new btRigidBody(rbInfo);
 			body->setFriction(1.);
 			body->setRollingFriction(2.);
+			body->setUserIndex(MATERIAL_GROUND);
 			//add the body to the dynamics world
-			m_dynamicsWorld->addRigidBody(body);
+			m_dynamicsWorld->addRigidBody(body, COL_GROUND, COL_BALL);
 			Body b;
 			b.name="groundPlane";
 			b.body=body;
+			b.parked=false;
 			m_bodies.push_back(b);
 
 		}
@@ -109,11 +239,16 @@ PhysicsWorld::~PhysicsWorld()
 
 		delete m_collisionConfiguration;
 
+		delete m_sdfCreateFunc;
+		delete m_sdfSwappedCreateFunc;
+
+		delete m_swarm;
+
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void PhysicsWorld::addMaze(std::string _shapeName,const ngl::Vec3 &_pos, float _friction)
+void PhysicsWorld::addMaze(std::string _shapeName,const ngl::Vec3 &_pos, float _friction, int _material)
 {
 
 	btCollisionShape* colShape = CollisionShape::instance()->getShape(_shapeName);
@@ -130,16 +265,18 @@ void PhysicsWorld::addMaze(std::string _shapeName,const ngl::Vec3 &_pos, float _
 	btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,myMotionState,colShape,localInertia);
 
 	btRigidBody* body = new btRigidBody(rbInfo);
-	m_dynamicsWorld->addRigidBody(body);
+	m_dynamicsWorld->addRigidBody(body, COL_MAZE, COL_BALL);
 	//set friction from config file
 	//divide by 10 as want maze to have low friction for calculation
+	//(only used if the material table is bypassed, ball contacts take the table's entry)
 	body->setFriction(_friction/10);
-	//set as kinematic object
+	body->setUserIndex(_material);
+	//set as kinematic object, tilt wakes it only while the maze is moving (see tilt)
 	body->setCollisionFlags(body->getCollisionFlags()|btCollisionObject::CF_KINEMATIC_OBJECT);
-	body->setActivationState(DISABLE_DEACTIVATION);
 	Body b;
 	b.name=_shapeName;
 	b.body=body;
+	b.parked=false;
 	m_bodies.push_back(b);
 }
 
@@ -181,9 +318,278 @@ void PhysicsWorld::setRotAboutOrigin(unsigned int _index, btQuaternion _rot)
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void PhysicsWorld::step(float _time, float _step)
+void PhysicsWorld::tilt(float _angleX, float _angleZ)
+{
+	if(_angleX==0.0 && _angleZ==0.0)
+	{
+		//a still maze is left asleep, so balls resting on it can sleep too rather than being woken by
+		//it every step
+		if(++m_stillTicks==KINEMATIC_SETTLE_TICKS)
+		{
+			for(unsigned int i=1; i<m_bodies.size(); ++i)
+			{
+				if(m_bodies[i].body->isKinematicObject())
+				{
+					m_bodies[i].body->setActivationState(ISLAND_SLEEPING);
+				}
+			}
+		}
+		return;
+	}
+	m_stillTicks=0;
+	btQuaternion local=btQuaternion(btVector3(0,0,1),_angleZ)*btQuaternion(btVector3(1,0,0),_angleX);
+	for(unsigned int i=1; i<m_bodies.size(); ++i)
+	{
+		if(m_bodies[i].name=="maze")
+		{
+			setRot(i, local*getRotation(i));
+		}
+		else if(m_bodies[i].name=="cube")
+		{
+			setRotAboutOrigin(i, local*getRotation(i));
+		}
+		else
+		{
+			continue;
+		}
+		//an awake kinematic body wakes whatever it is touching when bullet builds the islands, so only
+		//the islands on the maze wake up and balls lying elsewhere stay asleep
+		m_bodies[i].body->activate(true);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int PhysicsWorld::step(float _time, int _maxSubsteps)
+{
+  //calm steps take a single substep, only fast balls that could get through a wall pay for more
+  int substeps=1;
+  if(m_maxDisplacement>0.0)
+  {
+    substeps=int(ceil(getMaxSpeed()*_time/m_maxDisplacement));
+    substeps=std::max(1,std::min(substeps,_maxSubsteps));
+  }
+  //bullet takes the substeps itself so the maze's kinematic velocity is worked out over the whole
+  //step and its motion spread across them, stepping it once per substep would give all the tilt
+  //to the first
+  m_dynamicsWorld->stepSimulation(_time,substeps,_time/substeps);
+  //the party balls take the whole step at once, their speed limit keeps them out of the walls
+  if(m_swarm!=0)
+  {
+    stepSwarm(_time);
+  }
+  return substeps;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+float PhysicsWorld::getMaxSpeed() const
+{
+	btScalar fastest=0.0;
+	const btCollisionObjectArray &objects=m_dynamicsWorld->getCollisionObjectArray();
+	for(int i=0; i<objects.size(); ++i)
+	{
+		const btRigidBody *body=btRigidBody::upcast(objects[i]);
+		if(body && !body->isStaticOrKinematicObject() && body->isActive())
+		{
+			fastest=std::max(fastest,body->getLinearVelocity().length2());
+		}
+	}
+	return sqrt(fastest);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::countBodies(unsigned int &o_active, unsigned int &o_sleeping, unsigned int &o_islands) const
+{
+	o_active=0;
+	o_sleeping=0;
+	o_islands=0;
+	//bullet tags each body with its island when it builds them during the step, the tag is the
+	//index of one of the island's bodies so marking them off needs no sort
+	const btCollisionObjectArray &objects=m_dynamicsWorld->getCollisionObjectArray();
+	m_islandSeen.assign(objects.size(),0);
+	for(int i=0; i<objects.size(); ++i)
+	{
+		if(objects[i]->isStaticOrKinematicObject())
+		{
+			continue;
+		}
+		if(!objects[i]->isActive())
+		{
+			++o_sleeping;
+			continue;
+		}
+		++o_active;
+		int tag=objects[i]->getIslandTag();
+		if(tag>=0 && tag<objects.size() && !m_islandSeen[tag])
+		{
+			m_islandSeen[tag]=1;
+			++o_islands;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+unsigned int PhysicsWorld::getNumContacts() const
+{
+	unsigned int contacts=0;
+	int numManifolds=m_dispatcher->getNumManifolds();
+	for(int i=0; i<numManifolds; ++i)
+	{
+		contacts+=m_dispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+	}
+	return contacts;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::setParked(unsigned int _index, bool _parked)
+{
+	Body &b=m_bodies[_index];
+	if(_parked)
+	{
+		if(!b.parked)
+		{
+			// a sleeping body is woken by the awake kinematic maze it rests on while the player tilts,
+			// so simulation is switched off instead. Velocities are kept so it carries on where it left
+			// off when unparked. It has to be forced as bullet won't change the state of a body
+			// with simulation disabled
+			b.body->forceActivationState(DISABLE_SIMULATION);
+			b.parked=true;
+		}
+	}
+	else if(b.parked)
+	{
+		b.body->forceActivationState(ACTIVE_TAG);
+		b.body->activate(true);
+		b.parked=false;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::setBallsCollide(bool _collide)
+{
+	if(_collide==m_ballsCollide)
+	{
+		return;
+	}
+	m_ballsCollide=_collide;
+	//change the mask in place, removing and adding the balls again would reorder the collision
+	//objects and they have to stay in step with m_bodies. The broadphase only looks for new pairs
+	//when a proxy moves, so each ball's proxy is made again through the new mask, which finds the
+	//balls it already overlaps even if none of them are moving
+	for(unsigned int i=1; i<m_bodies.size(); ++i)
+	{
+		if(m_bodies[i].name=="ball")
+		{
+			m_bodies[i].body->getBroadphaseHandle()->m_collisionFilterMask=ballMask();
+			m_dynamicsWorld->refreshBroadphaseProxy(m_bodies[i].body);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::setSwarm(unsigned int _balls, const MazeSdf *_sdf)
 {
-  m_dynamicsWorld->stepSimulation(_time,_step);
+	delete m_swarm;
+	m_swarm=0;
+	int maze=-1;
+	for(unsigned int i=1; i<m_bodies.size() && maze<0; ++i)
+	{
+		if(m_bodies[i].name=="maze")
+		{
+			maze=i;
+		}
+	}
+	if(_balls==0 || _sdf==0 || maze<0)
+	{
+		return;
+	}
+	btRigidBody *body=m_bodies[maze].body;
+	btTransform transform;
+	body->getMotionState()->getWorldTransform(transform);
+	//the grid covers everywhere the tilted maze can reach, as the axis sweeps do
+	ngl::Vec3 gridMin, gridMax;
+	const btVector3 &origin=transform.getOrigin();
+	mazeBounds(body->getCollisionShape(),ngl::Vec3(origin.x(),origin.y(),origin.z()),gridMin,gridMax);
+	float radius=SdfCollisionAlgorithm::ballRadius(CollisionShape::instance()->getShape("ball"));
+	m_swarm=new BallSwarm(radius,btVector3(gridMin.m_x,gridMin.m_y,gridMin.m_z),btVector3(gridMax.m_x,gridMax.m_y,gridMax.m_z),_sdf);
+	//dropped in from just over the top of the maze and lost at the same height as the player's ball
+	btVector3 aabbMin, aabbMax;
+	body->getCollisionShape()->getAabb(transform,aabbMin,aabbMax);
+	m_swarm->spawn(_balls,btVector3(aabbMin.x(),aabbMax.y()+radius,aabbMin.z()),
+								 btVector3(aabbMax.x(),aabbMax.y()+radius*8,aabbMax.z()),SWARM_KILL_HEIGHT);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::stepSwarm(float _time)
+{
+	btTransform maze;
+	maze.setIdentity();
+	int material=MATERIAL_WOOD;
+	m_swarm->clearObstacles();
+	for(unsigned int i=1; i<m_bodies.size(); ++i)
+	{
+		btRigidBody *body=m_bodies[i].body;
+		if(m_bodies[i].name=="maze")
+		{
+			body->getMotionState()->getWorldTransform(maze);
+			material=body->getUserIndex();
+		}
+		else if(m_bodies[i].name=="ball")
+		{
+			btTransform trans;
+			body->getMotionState()->getWorldTransform(trans);
+			m_swarm->addObstacle(trans.getOrigin(),SdfCollisionAlgorithm::ballRadius(body->getCollisionShape()));
+		}
+	}
+	m_swarm->step(_time,m_dynamicsWorld->getGravity(),maze,material);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::mazeBounds(btCollisionShape *_maze, const ngl::Vec3 &_pos, ngl::Vec3 &o_min, ngl::Vec3 &o_max)
+{
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(btVector3(_pos.m_x,_pos.m_y,_pos.m_z));
+	btVector3 aabbMin, aabbMax;
+	_maze->getAabb(transform,aabbMin,aabbMax);
+	//the maze tilts about its centre, so anything within half the diagonal of its box of the centre
+	//can be inside it. The ground plane is at 0 and balls that fall off come to rest on it
+	btVector3 centre=(aabbMin+aabbMax)*0.5;
+	btScalar reach=(aabbMax-aabbMin).length()*0.5;
+	o_min.set(centre.getX()-reach, std::min(centre.getY()-reach,btScalar(-1.0)), centre.getZ()-reach);
+	o_max.set(centre.getX()+reach, centre.getY()+reach, centre.getZ()+reach);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const char *s_broadphaseNames[BROADPHASE_TYPES]={"dbvt","sweep","sweep32"};
+
+const char *PhysicsWorld::broadphaseName(BroadphaseType _broadphase)
+{
+	return _broadphase<BROADPHASE_TYPES ? s_broadphaseNames[_broadphase] : "unknown";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool PhysicsWorld::broadphaseFromName(const std::string &_name, BroadphaseType &o_broadphase)
+{
+	for(int i=0; i<BROADPHASE_TYPES; ++i)
+	{
+		if(_name==s_broadphaseNames[i])
+		{
+			o_broadphase=BroadphaseType(i);
+			return true;
+		}
+	}
+	return false;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -207,6 +613,27 @@ void * PhysicsWorld::getUserData(unsigned int _index)
 
 //----------------------------------------------------------------------------------------------------------------------
 
+void PhysicsWorld::getAabb(unsigned int _index, ngl::Vec3 &o_min, ngl::Vec3 &o_max) const
+{
+	btCollisionObject* obj = m_dynamicsWorld->getCollisionObjectArray()[_index];
+	btVector3 aabbMin, aabbMax;
+	btBroadphaseProxy *proxy=obj->getBroadphaseHandle();
+	if(proxy!=0)
+	{
+		//updated every step for everything that moves, so this costs nothing
+		aabbMin=proxy->m_aabbMin;
+		aabbMax=proxy->m_aabbMax;
+	}
+	else
+	{
+		obj->getCollisionShape()->getAabb(obj->getWorldTransform(),aabbMin,aabbMax);
+	}
+	o_min.set(aabbMin.getX(),aabbMin.getY(),aabbMin.getZ());
+	o_max.set(aabbMax.getX(),aabbMax.getY(),aabbMax.getZ());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 ngl::Mat4 PhysicsWorld::getTransformMatrix(unsigned int _index)
 {
 	btCollisionObject* obj = m_dynamicsWorld->getCollisionObjectArray()[_index];
@@ -260,8 +687,6 @@ ngl::Vec3 PhysicsWorld::getPosition(unsigned int _index)
 
 //----------------------------------------------------------------------------------------------------------------------
 
-bool collision = false;
-
 void PhysicsWorld::removeBody(unsigned int _index)
 {
 	m_dynamicsWorld->removeRigidBody(m_bodies[_index+1].body);
@@ -278,8 +703,12 @@ void PhysicsWorld::reset()
 
 	}
 	m_bodies.erase(m_bodies.begin()+1,m_bodies.end());
-	//reset collision
-	collision=false;
+	m_stillTicks=0;
+	//party balls stay through a reset, the maze jumping back level mustn't fling them
+	if(m_swarm!=0)
+	{
+		m_swarm->forgetMaze();
+	}
 
 }
 
@@ -287,10 +716,12 @@ void PhysicsWorld::reset()
 
 struct ContactSensorCallBack : public btDynamicsWorld::ContactResultCallback
 {
-	ContactSensorCallBack(btCollisionObject& cube, btCollisionObject& ball) : btDynamicsWorld::ContactResultCallback(), cube(cube), ball(ball) {}
+	ContactSensorCallBack(btCollisionObject& cube, btCollisionObject& ball) : btDynamicsWorld::ContactResultCallback(), cube(cube), ball(ball), collision(false) {}
 
 	btCollisionObject& cube;
 	btCollisionObject& ball;
+	//kept in the callback rather than a global so worlds on different threads can test at once
+	bool collision;
 
 	virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0, int partId0, int index0, const btCollisionObjectWrapper* colObj1, int partId1, int index1)
 	{
@@ -311,7 +742,6 @@ bool PhysicsWorld::contactTest(unsigned int i, unsigned int j)
 {
 	btCollisionObject* cube;
 	btCollisionObject* ball;
-	collision=false;
 
 	cube = m_dynamicsWorld->getCollisionObjectArray()[j];
 	ball = m_dynamicsWorld->getCollisionObjectArray()[i];
@@ -319,7 +749,7 @@ bool PhysicsWorld::contactTest(unsigned int i, unsigned int j)
 	ContactSensorCallBack callback(*cube, *ball);
 	m_dynamicsWorld->contactPairTest(cube, ball, callback);
 
-	return collision;
+	return callback.collision;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -347,17 +777,103 @@ void PhysicsWorld::addCube(std::string _shapeName, const ngl::Vec3 &_pos)
 	rbInfo.m_additionalAngularDampingFactor=4.0;
 	rbInfo.m_additionalDamping=true;
 	btRigidBody* body = new btRigidBody(rbInfo);
+	body->setUserIndex(MATERIAL_GOAL);
 	//set as kinematic object
-	//set custom callback
-	body->setCollisionFlags(body->getCollisionFlags() |btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
+	//the balls carry the custom material flag, so the goal doesn't need it
 	body->setCollisionFlags(body->getCollisionFlags()|btCollisionObject::CF_KINEMATIC_OBJECT);
-	body->setActivationState(DISABLE_DEACTIVATION);
-	m_dynamicsWorld->addRigidBody(body);
+	m_dynamicsWorld->addRigidBody(body, COL_GOAL, COL_BALL);
 	Body b;
 	b.name=_shapeName;
 	b.body=body;
+	b.parked=false;
 	m_bodies.push_back(b);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
+void PhysicsWorld::setBodyMaterial(unsigned int _index, int _material)
+{
+	m_bodies[_index].body->setUserIndex(_material);
+	//contacts already in the manifolds keep the old values until they are replaced, so drop them
+	btBroadphaseProxy *proxy=m_bodies[_index].body->getBroadphaseHandle();
+	if(proxy!=0)
+	{
+		m_overlappingPairCache->getOverlappingPairCache()->cleanProxyFromPairs(proxy,m_dispatcher);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ngl::Vec3 PhysicsWorld::getLinearVelocity(unsigned int _index) const
+{
+	const btVector3 &v=m_bodies[_index].body->getLinearVelocity();
+	return ngl::Vec3(v.getX(),v.getY(),v.getZ());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void PhysicsWorld::saveState(SavedWorld &o_state) const
+{
+	o_state.bodies.resize(m_bodies.size());
+	for(unsigned int i=0; i<m_bodies.size(); ++i)
+	{
+		const btRigidBody *body=m_bodies[i].body;
+		SavedBody &s=o_state.bodies[i];
+		s.name=m_bodies[i].name;
+		s.transform=body->getWorldTransform();
+		s.linearVelocity=body->getLinearVelocity();
+		s.angularVelocity=body->getAngularVelocity();
+		s.activation=body->getActivationState();
+		s.parked=m_bodies[i].parked;
+	}
+	o_state.stillTicks=m_stillTicks;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool PhysicsWorld::restoreState(const SavedWorld &_state)
+{
+	if(_state.bodies.size()!=m_bodies.size())
+	{
+		return false;
+	}
+	for(unsigned int i=0; i<m_bodies.size(); ++i)
+	{
+		if(_state.bodies[i].name!=m_bodies[i].name)
+		{
+			return false;
+		}
+	}
+	for(unsigned int i=0; i<m_bodies.size(); ++i)
+	{
+		btRigidBody *body=m_bodies[i].body;
+		const SavedBody &s=_state.bodies[i];
+		body->setWorldTransform(s.transform);
+		body->setInterpolationWorldTransform(s.transform);
+		//kinematic bodies take their transform from the motion state at the next step
+		if(body->getMotionState())
+		{
+			body->getMotionState()->setWorldTransform(s.transform);
+		}
+		body->setLinearVelocity(s.linearVelocity);
+		body->setAngularVelocity(s.angularVelocity);
+		body->setInterpolationLinearVelocity(s.linearVelocity);
+		body->setInterpolationAngularVelocity(s.angularVelocity);
+		body->clearForces();
+		body->forceActivationState(s.activation);
+		body->setDeactivationTime(0.0);
+		m_bodies[i].parked=s.parked;
+		//cached contacts and warm starting impulses belong to the old positions, without dropping them
+		//a restored world wouldn't step the same as the one that was saved
+		btBroadphaseProxy *proxy=body->getBroadphaseHandle();
+		if(proxy!=0)
+		{
+			m_overlappingPairCache->getOverlappingPairCache()->cleanProxyFromPairs(proxy,m_dispatcher);
+		}
+	}
+	m_solver->reset();
+	m_stillTicks=_state.stillTicks;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,165 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SdfCollision.cpp
+/// @brief bullet shape and collision algorithm for balls against a maze's signed distance field
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "SdfCollision.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeSdfShape::MazeSdfShape(MazeSdf *_sdf, btBvhTriangleMeshShape *_mesh)
+{
+  m_shapeType=CUSTOM_CONCAVE_SHAPE_TYPE;
+  m_sdf=_sdf;
+  m_mesh=_mesh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MazeSdfShape::~MazeSdfShape()
+{
+  delete m_sdf;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeSdfShape::getAabb(const btTransform &_t, btVector3 &o_aabbMin, btVector3 &o_aabbMax) const
+{
+  m_mesh->getAabb(_t,o_aabbMin,o_aabbMax);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeSdfShape::processAllTriangles(btTriangleCallback *_callback, const btVector3 &_aabbMin, const btVector3 &_aabbMax) const
+{
+  m_mesh->processAllTriangles(_callback,_aabbMin,_aabbMax);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeSdfShape::calculateLocalInertia(btScalar , btVector3 &o_inertia) const
+{
+  // only ever static or kinematic
+  o_inertia.setValue(0,0,0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void MazeSdfShape::setLocalScaling(const btVector3 &_scaling)
+{
+  m_mesh->setLocalScaling(_scaling);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const btVector3 &MazeSdfShape::getLocalScaling() const
+{
+  return m_mesh->getLocalScaling();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SdfCollisionAlgorithm::SdfCollisionAlgorithm(btPersistentManifold *_manifold, const btCollisionAlgorithmConstructionInfo &_info,
+                                             const btCollisionObjectWrapper *_body0Wrap,
+                                             const btCollisionObjectWrapper *_body1Wrap, bool _isSwapped) :
+  btActivatingCollisionAlgorithm(_info,_body0Wrap,_body1Wrap)
+{
+  m_manifold=_manifold;
+  m_ownManifold=false;
+  m_isSwapped=_isSwapped;
+  const btCollisionObjectWrapper *ball= _isSwapped ? _body1Wrap : _body0Wrap;
+  m_radius=ballRadius(ball->getCollisionShape());
+  if(m_manifold==0)
+  {
+    m_manifold=m_dispatcher->getNewManifold(_body0Wrap->getCollisionObject(),_body1Wrap->getCollisionObject());
+    m_ownManifold=true;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SdfCollisionAlgorithm::~SdfCollisionAlgorithm()
+{
+  if(m_ownManifold && m_manifold)
+  {
+    m_dispatcher->releaseManifold(m_manifold);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+btScalar SdfCollisionAlgorithm::ballRadius(const btCollisionShape *_shape)
+{
+  if(_shape->getShapeType()==SPHERE_SHAPE_PROXYTYPE)
+  {
+    return static_cast<const btSphereShape *>(_shape)->getRadius();
+  }
+  // a hull of a sphere fills a cube, its margin is in the bounds as it is in bullet's own tests
+  btTransform identity;
+  identity.setIdentity();
+  btVector3 aabbMin, aabbMax;
+  _shape->getAabb(identity,aabbMin,aabbMax);
+  btVector3 extent=aabbMax-aabbMin;
+  return 0.5*btMin(extent.x(),btMin(extent.y(),extent.z()));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void SdfCollisionAlgorithm::processCollision(const btCollisionObjectWrapper *_body0Wrap, const btCollisionObjectWrapper *_body1Wrap,
+                                             const btDispatcherInfo &, btManifoldResult *o_result)
+{
+  if(m_manifold==0)
+  {
+    return;
+  }
+  o_result->setPersistentManifold(m_manifold);
+  const btCollisionObjectWrapper *ballWrap= m_isSwapped ? _body1Wrap : _body0Wrap;
+  const btCollisionObjectWrapper *mazeWrap= m_isSwapped ? _body0Wrap : _body1Wrap;
+  const MazeSdfShape *maze=static_cast<const MazeSdfShape *>(mazeWrap->getCollisionShape());
+
+  const btTransform &mazeTransform=mazeWrap->getWorldTransform();
+  btVector3 centre=ballWrap->getWorldTransform().getOrigin();
+  btScalar distance;
+  btVector3 gradient;
+  if(maze->getSdf()->sample(mazeTransform.invXform(centre),distance,gradient) &&
+     distance-m_radius<m_manifold->getContactBreakingThreshold() && gradient.length2()>SIMD_EPSILON)
+  {
+    // the normal points out of the maze towards the ball
+    btVector3 normal=mazeTransform.getBasis()*gradient.normalized();
+    btScalar depth=distance-m_radius;
+    if(m_isSwapped)
+    {
+      // the ball is B, so the point is on the ball and the normal points back at the maze
+      o_result->addContactPoint(-normal,centre-normal*m_radius,depth);
+    }
+    else
+    {
+      o_result->addContactPoint(normal,centre-normal*distance,depth);
+    }
+  }
+  if(m_ownManifold)
+  {
+    o_result->refreshContactPoints();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+btScalar SdfCollisionAlgorithm::calculateTimeOfImpact(btCollisionObject *, btCollisionObject *, const btDispatcherInfo &,
+                                                      btManifoldResult *)
+{
+  // continuous collision sweeps against the mesh through processAllTriangles instead
+  return btScalar(1.0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void SdfCollisionAlgorithm::getAllContactManifolds(btManifoldArray &o_manifolds)
+{
+  if(m_manifold && m_ownManifold)
+  {
+    o_manifolds.push_back(m_manifold);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
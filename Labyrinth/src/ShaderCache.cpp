@@ -0,0 +1,264 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ShaderCache.cpp
+/// @brief builds shader programs into ngl's ShaderLib, reading the linked binary from disk when it can
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "ShaderCache.h"
+#include <ngl/ShaderLib.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cache file header
+//----------------------------------------------------------------------------------------------------------------------
+const static char PROGRAM_MAGIC[4]={'L','P','R','G'};
+const static uint32_t PROGRAM_VERSION=1;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief biggest binary read back, drivers' binaries for these shaders are tens of KB
+//----------------------------------------------------------------------------------------------------------------------
+const static uint32_t MAX_BINARY=1u<<24;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief FNV-1a over some bytes
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t fnv1a(uint32_t _hash, const char *_data, size_t _size)
+{
+  for(size_t i=0; i<_size; ++i)
+  {
+    _hash^=(unsigned char)_data[i];
+    _hash*=16777619u;
+  }
+  return _hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns a GL string, empty if the driver doesn't give one
+//----------------------------------------------------------------------------------------------------------------------
+static std::string glString(GLenum _name)
+{
+  const GLubyte *text=glGetString(_name);
+  return text ? std::string(reinterpret_cast<const char *>(text)) : std::string();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ShaderCache::ShaderCache(const std::string &_dir)
+{
+  m_dir=_dir;
+  m_driver=glString(GL_VENDOR)+"\n"+glString(GL_RENDERER)+"\n"+glString(GL_VERSION);
+  GLint formats=0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS,&formats);
+  m_binaries=formats>0;
+  m_hits=0;
+  m_misses=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::build(const std::string &_name, const std::string &_vertex, const std::string &_fragment,
+                        const std::vector <std::string> &_attributes, const std::vector <std::string> &_defines)
+{
+  std::string vertex, fragment;
+  if(!readFile(_vertex,vertex) || !readFile(_fragment,fragment))
+  {
+    std::cerr<<"Unable to read the shaders for "<<_name<<"\n";
+    return false;
+  }
+  addDefines(vertex,_defines);
+  addDefines(fragment,_defines);
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->createShaderProgram(_name);
+  GLuint program=(*shader)[_name]->getID();
+
+  uint32_t key=makeKey(vertex,fragment,_attributes);
+  std::string cache=m_dir+_name+".prog";
+  if(m_binaries && load(program,cache,key))
+  {
+    ++m_hits;
+    return true;
+  }
+  ++m_misses;
+  if(!compile(program,_name,vertex,fragment,_attributes))
+  {
+    return false;
+  }
+  if(m_binaries && !save(program,cache,key))
+  {
+    // not fatal, it is just compiled again next time
+    std::cerr<<"Unable to write shader cache "<<cache<<"\n";
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::readFile(const std::string &_file, std::string &o_text)
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  std::stringstream text;
+  text<<file.rdbuf();
+  o_text=text.str();
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ShaderCache::addDefines(std::string &io_source, const std::vector <std::string> &_defines)
+{
+  if(_defines.empty())
+  {
+    return;
+  }
+  size_t insert=0;
+  unsigned int line=1;
+  if(io_source.compare(0,8,"#version")==0)
+  {
+    insert=io_source.find('\n');
+    insert= insert==std::string::npos ? io_source.size() : insert+1;
+    line=2;
+  }
+  std::stringstream defines;
+  for(unsigned int i=0; i<_defines.size(); ++i)
+  {
+    defines<<"#define "<<_defines[i]<<"\n";
+  }
+  defines<<"#line "<<line<<"\n";
+  io_source.insert(insert,defines.str());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+uint32_t ShaderCache::makeKey(const std::string &_vertex, const std::string &_fragment, const std::vector <std::string> &_attributes) const
+{
+  // each part is hashed with its terminating 0 so moving text from one to the next changes the key
+  uint32_t hash=2166136261u;
+  hash=fnv1a(hash,m_driver.c_str(),m_driver.size()+1);
+  hash=fnv1a(hash,_vertex.c_str(),_vertex.size()+1);
+  hash=fnv1a(hash,_fragment.c_str(),_fragment.size()+1);
+  for(unsigned int i=0; i<_attributes.size(); ++i)
+  {
+    hash=fnv1a(hash,_attributes[i].c_str(),_attributes[i].size()+1);
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::load(GLuint _program, const std::string &_file, uint32_t _key) const
+{
+  std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  char magic[4];
+  uint32_t header[4];
+  file.read(magic,sizeof(magic));
+  file.read(reinterpret_cast<char *>(header),sizeof(header));
+  if(!file || memcmp(magic,PROGRAM_MAGIC,sizeof(magic))!=0 || header[0]!=PROGRAM_VERSION || header[1]!=_key ||
+     header[3]==0 || header[3]>MAX_BINARY)
+  {
+    return false;
+  }
+  std::vector <char> binary(header[3]);
+  file.read(&binary[0],binary.size());
+  if(!file)
+  {
+    return false;
+  }
+  // the driver can still turn it down, after an update that kept the version string say
+  glProgramBinary(_program,header[2],&binary[0],binary.size());
+  GLint linked=GL_FALSE;
+  glGetProgramiv(_program,GL_LINK_STATUS,&linked);
+  return linked==GL_TRUE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::save(GLuint _program, const std::string &_file, uint32_t _key) const
+{
+  GLint length=0;
+  glGetProgramiv(_program,GL_PROGRAM_BINARY_LENGTH,&length);
+  if(length<=0)
+  {
+    return false;
+  }
+  std::vector <char> binary(length);
+  GLenum format=0;
+  glGetProgramBinary(_program,length,&length,&format,&binary[0]);
+  if(length<=0)
+  {
+    return false;
+  }
+  std::ofstream file(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+  {
+    return false;
+  }
+  uint32_t header[4]={PROGRAM_VERSION,_key,uint32_t(format),uint32_t(length)};
+  file.write(PROGRAM_MAGIC,sizeof(PROGRAM_MAGIC));
+  file.write(reinterpret_cast<const char *>(header),sizeof(header));
+  file.write(&binary[0],length);
+  return file.good();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::attachShader(GLuint _program, GLenum _type, const std::string &_name, const std::string &_source)
+{
+  GLuint shader=glCreateShader(_type);
+  const char *source=_source.c_str();
+  glShaderSource(shader,1,&source,0);
+  glCompileShader(shader);
+  GLint compiled=GL_FALSE;
+  glGetShaderiv(shader,GL_COMPILE_STATUS,&compiled);
+  if(compiled!=GL_TRUE)
+  {
+    char log[4096];
+    glGetShaderInfoLog(shader,sizeof(log),0,log);
+    std::cerr<<"Unable to compile "<<_name<<(_type==GL_VERTEX_SHADER ? " vertex" : " fragment")<<" shader\n"<<log<<"\n";
+    glDeleteShader(shader);
+    return false;
+  }
+  glAttachShader(_program,shader);
+  // flagged for deletion, it goes when the program does
+  glDeleteShader(shader);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool ShaderCache::compile(GLuint _program, const std::string &_name, const std::string &_vertex, const std::string &_fragment,
+                          const std::vector <std::string> &_attributes) const
+{
+  if(!attachShader(_program,GL_VERTEX_SHADER,_name,_vertex) || !attachShader(_program,GL_FRAGMENT_SHADER,_name,_fragment))
+  {
+    return false;
+  }
+  for(unsigned int i=0; i<_attributes.size(); ++i)
+  {
+    glBindAttribLocation(_program,i,_attributes[i].c_str());
+  }
+  // without the hint some drivers won't hand the binary back, drivers without binaries may not have the call
+  if(m_binaries)
+  {
+    glProgramParameteri(_program,GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+  }
+  glLinkProgram(_program);
+  GLint linked=GL_FALSE;
+  glGetProgramiv(_program,GL_LINK_STATUS,&linked);
+  if(linked!=GL_TRUE)
+  {
+    char log[4096];
+    glGetProgramInfoLog(_program,sizeof(log),0,log);
+    std::cerr<<"Unable to link "<<_name<<"\n"<<log<<"\n";
+    return false;
+  }
+  return true;
+}
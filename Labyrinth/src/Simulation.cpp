@@ -0,0 +1,860 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Simulation.cpp
+/// @brief runs the physics and game rules at a fixed rate, on its own thread or ticked by the caller
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "Simulation.h"
+#include "PhysicsWorld.h"
+#include "CollisionShape.h"
+#include "SdfCollision.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief set in m_ready when the snapshot it points at hasn't been picked up by the renderer
+//----------------------------------------------------------------------------------------------------------------------
+const static int FRESH=4;
+const static int INDEX_MASK=3;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief thickness of the walls in mazev3.obj, steps are split so balls move at most half of the
+/// maze's wall thickness
+//----------------------------------------------------------------------------------------------------------------------
+const static float WALL_THICKNESS=2.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief ticks the autopilot waits on the win / lose screen before starting again, the thread
+/// ticks every 250ms outside of a game so this is about 2 seconds
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int AUTOPILOT_RESTART_TICKS=8;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief cells along each side of a generated maze, about the size of mazev3.obj
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int MAZE_CELLS=7;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief generated mazes with more cells than this along a side are streamed a chunk at a time
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int STREAM_CELLS=16;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief where the maze sits in the world
+//----------------------------------------------------------------------------------------------------------------------
+const static float MAZE_HEIGHT=20.0;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Simulation::Simulation(int _gravityY, float _friction, BroadphaseType _broadphase, bool _mazeSdf, unsigned int _mazeSeed,
+                       unsigned int _mazeCells)
+{
+  CollisionShape *shapes=CollisionShape::instance();
+  shapes->addSphere("ball", "obj/sphere.obj");
+  shapes->addBox("cube", "obj/cubev2.obj");
+  m_chunks=0;
+  m_level=0;
+  m_levelIndex=-1;
+  m_pendingLevel=0;
+  m_pendingLevelIndex=-1;
+  unsigned int cells= _mazeCells>0 ? _mazeCells : MAZE_CELLS;
+  if(_mazeSeed!=0 && cells>STREAM_CELLS)
+  {
+    // only the walls are kept whole, the mesh is built a chunk at a time as it is needed
+    m_maze.generate(_mazeSeed, cells, cells, false);
+    m_chunks=new MazeChunks(&m_maze);
+    shapes->addShape("maze", m_chunks->getShape());
+    if(_mazeSdf)
+    {
+      std::cerr<<"Streamed mazes have no distance field, colliding with the chunks\n";
+    }
+  }
+  else if(_mazeSeed!=0)
+  {
+    m_maze.generate(_mazeSeed, cells, cells);
+    if(_mazeSdf)
+    {
+      shapes->addGeneratedMazeSdf("maze", m_maze);
+    }
+    else
+    {
+      shapes->addGeneratedMaze("maze", m_maze);
+    }
+  }
+  if(m_maze.isValid())
+  {
+    placeStart(m_maze.getStart(),m_maze.getGoal());
+  }
+  else
+  {
+    if(_mazeSdf)
+    {
+      shapes->addMazeSdf("maze", "obj/mazev3.obj");
+    }
+    else
+    {
+      shapes->addMaze("maze", "obj/mazev3.obj");
+    }
+    m_ballStart.set(-15,25,-15);
+    m_cubeStart.set(0,17,0);
+  }
+
+  m_friction=_friction;
+  m_mazeMaterial=MATERIAL_WOOD;
+  MaterialTable::instance()->setDefaults(_friction);
+  ngl::Vec3 worldMin, worldMax;
+  PhysicsWorld::mazeBounds(shapes->getShape("maze"), ngl::Vec3(0,MAZE_HEIGHT,0), worldMin, worldMax);
+  m_physics = new PhysicsWorld(_broadphase, worldMin, worldMax);
+  m_physics->setGravity(0, _gravityY, 0);
+  m_physics->setMaxDisplacement((m_maze.isValid() ? MazeGenerator::getWallThickness() : WALL_THICKNESS)*0.5);
+  m_physics->addGroundPlane(ngl::Vec3(0,0,0), ngl::Vec3(50,0.01,50));
+
+  m_physics->addSphere("ball",m_ballStart, _friction);
+  m_physics->addMaze("maze", ngl::Vec3(0,MAZE_HEIGHT,0), _friction);
+  m_physics->addCube("cube",m_cubeStart);
+  if(m_chunks)
+  {
+    // so the ball has a floor under it at the first step
+    streamChunks();
+  }
+
+  m_up=0.0;
+  m_down=0.0;
+  m_left=0.0;
+  m_right=0.0;
+  m_tickTime=SDL_GetPerformanceCounter();
+  m_inputTime=0;
+  SDL_AtomicSet(&m_state,0);
+  SDL_AtomicSet(&m_party,0);
+  SDL_AtomicSet(&m_countBodies,0);
+  m_publishedState=0;
+  m_tick=0;
+  m_substeps=0;
+  m_totalSubsteps=0;
+  m_wins=0;
+  m_losses=0;
+  memset(m_stepMs,0,sizeof(m_stepMs));
+  m_haveView=false;
+  m_viewChanged=false;
+  m_autopilot.setGrid(&m_navGrid);
+  m_autopilotOn=false;
+  m_idleTicks=0;
+
+  m_commandLock=SDL_CreateMutex();
+  m_commandSignal=SDL_CreateCond();
+  m_thread=0;
+  SDL_AtomicSet(&m_running,0);
+  m_wake=0;
+
+  m_back=0;
+  m_front=1;
+  SDL_AtomicSet(&m_ready,2);
+  // so the renderer has the starting layout before the first tick
+  publish();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Simulation::~Simulation()
+{
+  stop();
+  delete m_physics;
+  // after the world as the maze body uses its shape
+  delete m_chunks;
+  delete m_level;
+  delete m_pendingLevel;
+  SDL_DestroyCond(m_commandSignal);
+  SDL_DestroyMutex(m_commandLock);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::start()
+{
+  SDL_AtomicSet(&m_running,1);
+  m_thread=SDL_CreateThread(threadMain,"simulation",this);
+  if(!m_thread)
+  {
+    std::cerr<<"Unable to create simulation thread "<<SDL_GetError()<<"\n";
+    SDL_AtomicSet(&m_running,0);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::stop()
+{
+  if(!m_thread)
+  {
+    return;
+  }
+  SDL_AtomicSet(&m_running,0);
+  SDL_LockMutex(m_commandLock);
+  SDL_CondSignal(m_commandSignal);
+  SDL_UnlockMutex(m_commandLock);
+  SDL_WaitThread(m_thread,0);
+  m_thread=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int Simulation::threadMain(void *_simulation)
+{
+  static_cast<Simulation *>(_simulation)->run();
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::run()
+{
+  Uint64 frequency=SDL_GetPerformanceFrequency();
+  Uint64 period=frequency/60;
+  Uint64 next=SDL_GetPerformanceCounter();
+  while(SDL_AtomicGet(&m_running))
+  {
+    if(getGameState()!=1)
+    {
+      // nothing moves outside of a game so sleep until there is a command to apply
+      SDL_LockMutex(m_commandLock);
+      if(m_commands.empty() && !m_pendingLevel && SDL_AtomicGet(&m_running))
+      {
+        SDL_CondWaitTimeout(m_commandSignal,m_commandLock,250);
+      }
+      SDL_UnlockMutex(m_commandLock);
+      tick();
+      next=SDL_GetPerformanceCounter()+period;
+      continue;
+    }
+
+    tick();
+    next+=period;
+    Uint64 now=SDL_GetPerformanceCounter();
+    if(now<next)
+    {
+      SDL_Delay((Uint32)((next-now)*1000/frequency));
+    }
+    else if(now-next>period*4)
+    {
+      // we've fallen well behind (a stall or a debugger) so don't try to catch up all at once
+      next=now;
+    }
+    else if(m_governor.getLevel()>=GOVERNOR_CAP_SUBSTEPS)
+    {
+      // steps are over budget, ticking back to back to catch up would only make the next ones later
+      next=now;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::tick()
+{
+  float angleX, angleZ;
+  Uint64 now=SDL_GetPerformanceCounter();
+  applyCommands(now,angleX,angleZ);
+  m_tickTime=now;
+  if(m_autopilotOn)
+  {
+    driveAutopilot(angleX,angleZ);
+  }
+  if(getGameState()==1)
+  {
+    m_physics->tilt(angleX, angleZ);
+
+    m_physics->setSolverIterations(m_governor.getSolverIterations());
+    Uint64 start=SDL_GetPerformanceCounter();
+    if(m_chunks)
+    {
+      streamChunks();
+    }
+    m_substeps=m_physics->step(1.0f/60.0f, m_governor.getMaxSubsteps());
+    Uint64 end=SDL_GetPerformanceCounter();
+    ++m_tick;
+    m_totalSubsteps+=m_substeps;
+    float stepMs=(end-start)*1000.0/SDL_GetPerformanceFrequency();
+    m_stepMs[m_tick%SNAPSHOT_STEP_HISTORY]=stepMs;
+
+    if(m_governor.update(stepMs))
+    {
+      updateParking();
+    }
+    else if(m_governor.sleepOffscreen())
+    {
+      // the view and the balls move so keep checking while we are parking
+      updateParking();
+    }
+
+    if(!lose())
+    {
+      win();
+    }
+  }
+  publish();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::setAutopilot(bool _on)
+{
+  if(_on && !m_navGrid.isValid())
+  {
+    // the goal's bounds in the maze's space, the maze is still level before the game starts
+    btTransform goal;
+    goal.setIdentity();
+    goal.setOrigin(btVector3(m_cubeStart.m_x,m_cubeStart.m_y-MAZE_HEIGHT,m_cubeStart.m_z));
+    btVector3 goalMin, goalMax;
+    CollisionShape::instance()->getShape("cube")->getAabb(goal,goalMin,goalMax);
+    ngl::Vec3 navMin(goalMin.getX(),goalMin.getY(),goalMin.getZ());
+    ngl::Vec3 navMax(goalMax.getX(),goalMax.getY(),goalMax.getZ());
+    bool built;
+    std::vector <ngl::Vec3> triangles;
+    getMazeTriangles(triangles);
+    if(!triangles.empty())
+    {
+      // generated mazes and levels are quick to rasterize and not worth caching
+      built=m_navGrid.build(triangles,navMin,navMax);
+    }
+    else
+    {
+      built=m_navGrid.loadOrBuild("obj/mazev3.obj",navMin,navMax);
+    }
+    if(!built)
+    {
+      std::cerr<<"Autopilot has no nav grid for the maze\n";
+      return false;
+    }
+    if(!m_navGrid.reachable(m_ballStart-ngl::Vec3(0,MAZE_HEIGHT,0)))
+    {
+      std::cerr<<"Autopilot can't find a way from the start to the goal\n";
+    }
+  }
+  m_autopilotOn=_on;
+  m_idleTicks=0;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::driveAutopilot(float &o_angleX, float &o_angleZ)
+{
+  if(getGameState()!=1)
+  {
+    if(++m_idleTicks>=AUTOPILOT_RESTART_TICKS)
+    {
+      SDL_AtomicSet(&m_state,1);
+      m_idleTicks=0;
+    }
+    return;
+  }
+  m_idleTicks=0;
+  // it steers the first ball, any others are along for the ride
+  int ball=-1;
+  int maze=-1;
+  for(unsigned int i=1; i<m_physics->getNumCollisionObjects() && (ball<0 || maze<0); ++i)
+  {
+    std::string name=m_physics->getBodyNameAtIndex(i);
+    if(name=="ball" && ball<0)
+    {
+      ball=i;
+    }
+    else if(name=="maze")
+    {
+      maze=i;
+    }
+  }
+  if(ball<0 || maze<0)
+  {
+    return;
+  }
+  m_autopilot.act(m_physics->getPosition(ball),m_physics->getLinearVelocity(ball),
+                  m_physics->getRotation(maze),m_physics->getPosition(maze),o_angleX,o_angleZ);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::applyParty(unsigned int _balls)
+{
+  const MazeSdf *sdf=0;
+  if(_balls>0 && m_chunks)
+  {
+    std::cerr<<"No party on a streamed maze, it has no distance field\n";
+    SDL_AtomicSet(&m_party,0);
+    return;
+  }
+  if(_balls>0)
+  {
+    btCollisionShape *maze=CollisionShape::instance()->getShape("maze");
+    if(maze->getShapeType()==CUSTOM_CONCAVE_SHAPE_TYPE)
+    {
+      sdf=static_cast<MazeSdfShape *>(maze)->getSdf();
+    }
+    else
+    {
+      if(!m_swarmSdf.isValid())
+      {
+        std::vector <ngl::Vec3> triangles;
+        getMazeTriangles(triangles);
+        if(!triangles.empty())
+        {
+          m_swarmSdf.build(triangles);
+        }
+        else
+        {
+          m_swarmSdf.loadOrBuild("obj/mazev3.obj");
+        }
+      }
+      if(!m_swarmSdf.isValid())
+      {
+        std::cerr<<"No distance field for the party balls\n";
+      }
+      if(m_swarmSdf.isValid())
+      {
+        sdf=&m_swarmSdf;
+      }
+    }
+  }
+  m_physics->setSwarm(_balls,sdf);
+  SDL_AtomicSet(&m_party,sdf!=0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::applyLevel(Level *_level, int _index)
+{
+  // the party balls roll on the old maze's field
+  applyParty(0);
+  const LevelInfo &info=_level->getInfo();
+  // the maze the game started with belongs to CollisionShape unless it was streamed, a level's
+  // shape and the chunks' go with them
+  btCollisionShape *original= m_level==0 && m_chunks==0 ? CollisionShape::instance()->getShape("maze") : 0;
+  CollisionShape::instance()->addShape("maze",_level->getShape());
+  placeStart(info.start,info.goal);
+  m_friction=info.friction;
+  m_mazeMaterial=info.surface;
+  MaterialTable::instance()->setDefaults(info.friction);
+  m_physics->setGravity(0, info.gravity, 0);
+  m_physics->setMaxDisplacement(info.wallThickness*0.5);
+  // takes the old maze body out of the world before its shape goes
+  resetMaze();
+  CollisionShape::deleteMazeShape(original);
+  // the axis sweeps only cover the maze they were sized to, a bigger one would fall outside them
+  ngl::Vec3 worldMin, worldMax;
+  PhysicsWorld::mazeBounds(_level->getShape(), ngl::Vec3(0,MAZE_HEIGHT,0), worldMin, worldMax);
+  m_physics->setBroadphase(info.broadphase, worldMin, worldMax);
+  m_physics->setBallsCollide(info.ballCollisions);
+  delete m_chunks;
+  m_chunks=0;
+  delete m_level;
+  m_level=_level;
+  m_levelIndex=_index;
+
+  // the fields were worked out for the old maze
+  m_swarmSdf=MazeSdf();
+  m_navGrid=NavGrid();
+  if(m_autopilotOn)
+  {
+    setAutopilot(true);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::placeStart(const ngl::Vec3 &_start, const ngl::Vec3 &_goal)
+{
+  // the cube sits in the hole over the goal with its top level with the floor
+  btTransform identity;
+  identity.setIdentity();
+  btVector3 cubeMin, cubeMax;
+  CollisionShape::instance()->getShape("cube")->getAabb(identity,cubeMin,cubeMax);
+  m_ballStart=_start+ngl::Vec3(0,MAZE_HEIGHT,0);
+  m_cubeStart.set(_goal.m_x-0.5*(cubeMin.x()+cubeMax.x()),_goal.m_y+MAZE_HEIGHT-cubeMax.y(),_goal.m_z-0.5*(cubeMin.z()+cubeMax.z()));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::getMazeTriangles(std::vector <ngl::Vec3> &o_triangles) const
+{
+  o_triangles.clear();
+  if(m_level)
+  {
+    m_level->getTriangles(o_triangles);
+  }
+  else if(m_maze.isValid())
+  {
+    m_maze.getTriangles(o_triangles);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::push(const Command &_command)
+{
+  SDL_LockMutex(m_commandLock);
+  m_commands.push_back(_command);
+  SDL_CondSignal(m_commandSignal);
+  SDL_UnlockMutex(m_commandLock);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setTilt(float _up, float _down, float _left, float _right, Uint64 _time)
+{
+  Command c;
+  c.type=0;
+  c.time=_time;
+  c.value[0]=_up;
+  c.value[1]=_down;
+  c.value[2]=_left;
+  c.value[3]=_right;
+  push(c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::addBall(Uint64 _time)
+{
+  Command c;
+  c.type=1;
+  c.time=_time;
+  push(c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setGameState(int _state, Uint64 _time)
+{
+  Command c;
+  c.type=2;
+  c.time=_time;
+  c.value[0]=_state;
+  push(c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setParty(unsigned int _balls)
+{
+  Command c;
+  c.type=3;
+  c.time=0;
+  c.value[0]=_balls;
+  // set here rather than when the command is applied so pressing twice in a tick toggles back
+  SDL_AtomicSet(&m_party,_balls>0);
+  push(c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setView(const ngl::Mat4 &_viewProjection)
+{
+  SDL_LockMutex(m_commandLock);
+  m_pendingView=_viewProjection;
+  m_viewChanged=true;
+  SDL_UnlockMutex(m_commandLock);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setLevel(Level *_level, int _index)
+{
+  SDL_LockMutex(m_commandLock);
+  // one that was never picked up is simply replaced
+  delete m_pendingLevel;
+  m_pendingLevel=_level;
+  m_pendingLevelIndex=_index;
+  SDL_CondSignal(m_commandSignal);
+  SDL_UnlockMutex(m_commandLock);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setBallsCollide(bool _collide)
+{
+  m_physics->setBallsCollide(_collide);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::setMazeSurface(MaterialId _material)
+{
+  m_mazeMaterial=_material;
+  for(unsigned int i=0; i<m_physics->getNumCollisionObjects(); ++i)
+  {
+    if(m_physics->getBodyNameAtIndex(i)=="maze")
+    {
+      m_physics->setBodyMaterial(i,_material);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::applyCommands(Uint64 _tickEnd, float &o_angleX, float &o_angleZ)
+{
+  // swap the lists so we hold the lock for as little time as possible
+  SDL_LockMutex(m_commandLock);
+  m_applying.swap(m_commands);
+  if(m_viewChanged)
+  {
+    m_view=m_pendingView;
+    m_haveView=true;
+    m_viewChanged=false;
+  }
+  Level *level=m_pendingLevel;
+  int levelIndex=m_pendingLevelIndex;
+  m_pendingLevel=0;
+  SDL_UnlockMutex(m_commandLock);
+  if(level)
+  {
+    // before the commands so anything queued after the level was handed over lands in it
+    applyLevel(level,levelIndex);
+  }
+
+  // the tilt speeds are held for part of the tick each, so a key pressed just before the tick
+  // only tilts for the time it was actually down rather than snapping to a whole tick's worth
+  double span=double(_tickEnd-m_tickTime);
+  // fraction of the tick already covered by the previous speeds
+  double done=0.0;
+  o_angleX=0.0;
+  o_angleZ=0.0;
+  for(unsigned int i=0; i<m_applying.size(); ++i)
+  {
+    const Command &c=m_applying[i];
+    if(c.time!=0)
+    {
+      m_inputTime=std::max(m_inputTime,c.time);
+    }
+    switch(c.type)
+    {
+      case 0 :
+      {
+        double at= (c.time>m_tickTime && span>0.0) ? std::min((c.time-m_tickTime)/span,1.0) : 0.0;
+        at=std::max(at,done);
+        o_angleX+=(m_up-m_down)*(at-done);
+        o_angleZ+=(m_right-m_left)*(at-done);
+        done=at;
+        m_up=c.value[0];
+        m_down=c.value[1];
+        m_left=c.value[2];
+        m_right=c.value[3];
+      }
+      break;
+      case 1 :
+        // the governor turns new balls away while the steps are over budget
+        if(m_governor.allowSpawns() && m_physics->canAddBody())
+        {
+          m_physics->addSphere("ball", m_ballStart, m_friction);
+        }
+      break;
+      case 2 : SDL_AtomicSet(&m_state,(int)c.value[0]); break;
+      case 3 : applyParty((unsigned int)c.value[0]); break;
+      default : break;
+    }
+  }
+  m_applying.clear();
+  o_angleX+=(m_up-m_down)*(1.0-done);
+  o_angleZ+=(m_right-m_left)*(1.0-done);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::resetMaze()
+{
+  m_physics->reset();
+  m_physics->addMaze("maze",ngl::Vec3(0,MAZE_HEIGHT,0), m_friction, m_mazeMaterial);
+  m_physics->addSphere("ball", m_ballStart, m_friction);
+  m_physics->addCube("cube",m_cubeStart);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::lose()
+{
+  unsigned int bodies=m_physics->getNumCollisionObjects();
+  for(unsigned int i=1; i<bodies; ++i)
+  {
+    if(m_physics->getBodyNameAtIndex(i)=="ball")
+    {
+      ngl::Vec3 pos = m_physics->getPosition(i);
+      if(pos.m_y < 3)
+      {
+        resetMaze();
+        SDL_AtomicSet(&m_state,2);
+        ++m_losses;
+        return true;
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::win()
+{
+  unsigned int bodies=m_physics->getNumCollisionObjects();
+  for(unsigned int i=1; i<bodies; ++i)
+  {
+    for(unsigned int j=1; j<bodies; ++j)
+    {
+      if(m_physics->getBodyNameAtIndex(i)=="ball" && m_physics->getBodyNameAtIndex(j)=="cube")
+      {
+        if(m_physics->contactTest(i,j))
+        {
+          resetMaze();
+          SDL_AtomicSet(&m_state,3);
+          ++m_wins;
+          return true;
+        }
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns true if a point is in view, with a little slack so a ball half in view keeps moving
+/// @param[in] _viewProjection world to clip space matrix (row vectors, translation in m_m[3])
+/// @param[in] _pos the point
+//----------------------------------------------------------------------------------------------------------------------
+static bool inView(const ngl::Mat4 &_viewProjection, const ngl::Vec3 &_pos)
+{
+  float clip[4];
+  for(int j=0; j<4; ++j)
+  {
+    clip[j]=_pos.m_x*_viewProjection.m_m[0][j]+_pos.m_y*_viewProjection.m_m[1][j]
+           +_pos.m_z*_viewProjection.m_m[2][j]+_viewProjection.m_m[3][j];
+  }
+  float w=clip[3]*1.1f;
+  return clip[3]>0.0 && fabs(clip[0])<=w && fabs(clip[1])<=w;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::updateParking()
+{
+  bool parking=m_governor.sleepOffscreen() && m_haveView;
+  unsigned int bodies=m_physics->getNumCollisionObjects();
+  for(unsigned int i=1; i<bodies; ++i)
+  {
+    if(m_physics->getBodyNameAtIndex(i)=="ball")
+    {
+      m_physics->setParked(i, parking && !inView(m_view,m_physics->getPosition(i)));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::streamChunks()
+{
+  m_ballPositions.clear();
+  int maze=-1;
+  unsigned int bodies=m_physics->getNumCollisionObjects();
+  for(unsigned int i=1; i<bodies; ++i)
+  {
+    std::string name=m_physics->getBodyNameAtIndex(i);
+    if(name=="ball")
+    {
+      ngl::Vec3 pos=m_physics->getPosition(i);
+      m_ballPositions.push_back(btVector3(pos.m_x,pos.m_y,pos.m_z));
+    }
+    else if(name=="maze")
+    {
+      maze=i;
+    }
+  }
+  if(maze<0)
+  {
+    return;
+  }
+  ngl::Vec3 origin=m_physics->getPosition(maze);
+  m_chunks->update(btTransform(m_physics->getRotation(maze),btVector3(origin.m_x,origin.m_y,origin.m_z)),m_ballPositions);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::publish()
+{
+  Snapshot &s=m_snapshots[m_back];
+  s.tick=m_tick;
+  s.state=getGameState();
+  s.substeps=m_substeps;
+  s.totalSubsteps=m_totalSubsteps;
+  if(SDL_AtomicGet(&m_countBodies))
+  {
+    m_physics->countBodies(s.activeBodies,s.sleepingBodies,s.islands);
+    s.contacts=m_physics->getNumContacts();
+    s.broadphasePairs=m_physics->getNumBroadphasePairs();
+    s.manifolds=m_physics->getNumManifolds();
+  }
+  else
+  {
+    s.activeBodies=0;
+    s.sleepingBodies=0;
+    s.islands=0;
+    s.contacts=0;
+    s.broadphasePairs=0;
+    s.manifolds=0;
+  }
+  s.wins=m_wins;
+  s.losses=m_losses;
+  s.inputTime=m_inputTime;
+  s.governorLevel=m_governor.getLevel();
+  memcpy(s.stepMs,m_stepMs,sizeof(m_stepMs));
+  s.mazeChunks= m_chunks ? m_chunks->getNumChunks() : 0;
+  s.residentChunks= m_chunks ? m_chunks->getNumResident() : 0;
+  s.level=m_levelIndex;
+  const BallSwarm *swarm=m_physics->getSwarm();
+  if(swarm!=0)
+  {
+    swarm->getPositions(s.swarm);
+    s.swarmContacts=swarm->getNumContacts();
+  }
+  else
+  {
+    s.swarm.clear();
+    s.swarmContacts=0;
+  }
+
+  // clear keeps the capacity so once the vectors have grown this doesn't allocate
+  s.bodies.clear();
+  unsigned int bodies=m_physics->getNumCollisionObjects();
+  for(unsigned int i=1; i<bodies; ++i)
+  {
+    BodyState b;
+    b.transform=m_physics->getTransformMatrix(i);
+    m_physics->getAabb(i,b.aabbMin,b.aabbMax);
+    std::string name=m_physics->getBodyNameAtIndex(i);
+    b.kind = name=="ball" ? BODY_BALL : name=="maze" ? BODY_MAZE : name=="cube" ? BODY_CUBE : BODY_OTHER;
+    s.bodies.push_back(b);
+  }
+
+  // hand the filled buffer over and take back whichever one the renderer isn't holding
+  int state=s.state;
+  m_back=SDL_AtomicSet(&m_ready,m_back|FRESH) & INDEX_MASK;
+
+  if(state!=m_publishedState)
+  {
+    m_publishedState=state;
+    if(m_wake)
+    {
+      SDL_SemPost(m_wake);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const Snapshot &Simulation::acquire()
+{
+  if(SDL_AtomicGet(&m_ready) & FRESH)
+  {
+    m_front=SDL_AtomicSet(&m_ready,m_front) & INDEX_MASK;
+  }
+  return m_snapshots[m_front];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file StepGovernor.cpp
+/// @brief watches the physics step time and decides how much work to shed when it goes over budget
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "StepGovernor.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief steps over budget before shedding a level (1/6 of a second at 60Hz)
+//----------------------------------------------------------------------------------------------------------------------
+const static int SHED_AFTER=10;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief steps under half the budget before giving a level back (3 seconds at 60Hz)
+//----------------------------------------------------------------------------------------------------------------------
+const static int RESTORE_AFTER=180;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StepGovernor::StepGovernor(float _budget)
+{
+  setBudget(_budget);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void StepGovernor::setBudget(float _budget)
+{
+  m_budget=_budget;
+  m_average=0.0;
+  m_level=GOVERNOR_OFF;
+  m_over=0;
+  m_under=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool StepGovernor::update(float _stepMs)
+{
+  if(m_budget<=0.0)
+  {
+    return false;
+  }
+  // smooth out the odd slow step (a new ball landing) so one spike doesn't shed anything
+  m_average+=(_stepMs-m_average)*0.2f;
+
+  if(m_average>m_budget)
+  {
+    ++m_over;
+    m_under=0;
+  }
+  else if(m_average<m_budget*0.5f)
+  {
+    ++m_under;
+    m_over=0;
+  }
+  else
+  {
+    m_over=0;
+    m_under=0;
+  }
+
+  GovernorLevel level=m_level;
+  if(m_over>=SHED_AFTER && m_level<GOVERNOR_LEVELS-1)
+  {
+    level=GovernorLevel(m_level+1);
+  }
+  else if(m_under>=RESTORE_AFTER && m_level>GOVERNOR_OFF)
+  {
+    level=GovernorLevel(m_level-1);
+  }
+  if(level==m_level)
+  {
+    return false;
+  }
+  m_level=level;
+  m_over=0;
+  m_under=0;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const char *StepGovernor::levelName(int _level)
+{
+  static const char *names[GOVERNOR_LEVELS]={"off","substeps","iterations","sleep","no spawns"};
+  if(_level<0 || _level>=GOVERNOR_LEVELS)
+  {
+    return "unknown";
+  }
+  return names[_level];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
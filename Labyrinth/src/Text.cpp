@@ -43,6 +43,8 @@ unsigned int nearestPowerOfTwo ( unsigned int _num )
 //---------------------------------------------------------------------------
 Text::Text( const std::string &_f, int _size)
 {
+  m_drawCalls=0;
+  m_textureBytes=0;
 	TTF_Init();
 	TTF_Font *font = TTF_OpenFont(_f.c_str(), _size );
 	SDL_Color color = { 0, 0, 0,0 };
@@ -118,6 +120,7 @@ Text::Text( const std::string &_f, int _size)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
     glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, msg->w, msg->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, msg->pixels );
+    m_textureBytes+=msg->w*msg->h*4;
     SDL_FreeSurface(powerOfTwo);
     SDL_FreeSurface(msg);
 
@@ -271,6 +274,7 @@ void Text::renderText( float _x, float _y,  const std::string &text ) const
     f.vao->bind();
     // draw 
     f.vao->draw();
+    ++m_drawCalls;
     // now unbind the vao
     f.vao->unbind();
     // finally move to the next glyph x position by incrementing
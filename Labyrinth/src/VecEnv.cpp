@@ -0,0 +1,265 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file VecEnv.cpp
+/// @brief many independent mazes stepped together across threads for automated players and testers
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "VecEnv.h"
+#include "CollisionShape.h"
+#include <LinearMath/btQuickprof.h>
+#include <iostream>
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief indices of the bodies in each world, added in the same order as Simulation adds them
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int BALL=1;
+const static unsigned int MAZE=2;
+const static unsigned int GOAL=3;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief profile zone hooks that do nothing, installed in place of Bullet's profiler when the
+/// worlds are stepped on more than one thread
+//----------------------------------------------------------------------------------------------------------------------
+static void enterNoProfileZone(const char *)
+{
+}
+static void leaveNoProfileZone()
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+VecEnv::VecEnv(unsigned int _envs, unsigned int _threads, unsigned int _maxEpisodeSteps, int _gravityY, float _friction)
+{
+  CollisionShape *shapes=CollisionShape::instance();
+  if(shapes->getShape("maze")==0)
+  {
+    shapes->addSphere("ball", "obj/sphere.obj");
+    shapes->addMaze("maze", "obj/mazev3.obj");
+    shapes->addBox("cube", "obj/cubev2.obj");
+  }
+  // made here so the worker threads only ever read it
+  MaterialTable::instance()->setDefaults(_friction);
+
+  ngl::Vec3 worldMin, worldMax;
+  PhysicsWorld::mazeBounds(shapes->getShape("maze"), ngl::Vec3(0,20,0), worldMin, worldMax);
+  _envs=std::max(_envs,1u);
+  m_envs.resize(_envs);
+  for(unsigned int i=0; i<_envs; ++i)
+  {
+    PhysicsWorld *world=new PhysicsWorld(BROADPHASE_DBVT, worldMin, worldMax);
+    world->setGravity(0, _gravityY, 0);
+    world->setMaxDisplacement(1.0);
+    world->addGroundPlane(ngl::Vec3(0,0,0), ngl::Vec3(50,0.01,50));
+    world->addSphere("ball",ngl::Vec3(-15,25,-15), _friction);
+    world->addMaze("maze", ngl::Vec3(0,20,0), _friction);
+    world->addCube("cube",ngl::Vec3(0,17,0));
+    m_envs[i].world=world;
+    m_envs[i].episodeSteps=0;
+  }
+  m_envs[0].world->saveState(m_start);
+  m_observations.resize(_envs);
+  m_maxEpisodeSteps=_maxEpisodeSteps;
+  m_actions=0;
+  m_totalSteps=0;
+  m_stepTicks=0;
+
+  if(_threads==0)
+  {
+    _threads=SDL_GetCPUCount();
+  }
+  _threads=std::max(1u,std::min(_threads,_envs));
+#ifndef BT_NO_PROFILE
+  if(_threads>1)
+  {
+    // stock Bullet builds its profile zone tree in globals, so every world's BT_PROFILE would
+    // race on it, it is switched off for the whole process before any worker starts
+    btSetCustomEnterProfileZoneFunc(enterNoProfileZone);
+    btSetCustomLeaveProfileZoneFunc(leaveNoProfileZone);
+  }
+#endif
+  m_done=SDL_CreateSemaphore(0);
+  SDL_AtomicSet(&m_running,1);
+  m_workers.resize(_threads);
+  for(unsigned int i=0; i<_threads; ++i)
+  {
+    Worker &w=m_workers[i];
+    w.owner=this;
+    w.first=i*_envs/_threads;
+    w.last=(i+1)*_envs/_threads;
+    w.go=0;
+    w.thread=0;
+  }
+  // the vector is sized now so the workers can be handed pointers into it
+  for(unsigned int i=1; i<_threads; ++i)
+  {
+    Worker &w=m_workers[i];
+    w.go=SDL_CreateSemaphore(0);
+    w.thread=SDL_CreateThread(workerMain,"vecenv",&w);
+    if(!w.thread)
+    {
+      std::cerr<<"Unable to create environment thread "<<SDL_GetError()<<"\n";
+      // the caller's thread steps this run instead
+      SDL_DestroySemaphore(w.go);
+      w.go=0;
+    }
+  }
+  reset();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+VecEnv::~VecEnv()
+{
+  SDL_AtomicSet(&m_running,0);
+  for(unsigned int i=1; i<m_workers.size(); ++i)
+  {
+    if(m_workers[i].thread)
+    {
+      SDL_SemPost(m_workers[i].go);
+      SDL_WaitThread(m_workers[i].thread,0);
+      SDL_DestroySemaphore(m_workers[i].go);
+    }
+  }
+  SDL_DestroySemaphore(m_done);
+  for(unsigned int i=0; i<m_envs.size(); ++i)
+  {
+    delete m_envs[i].world;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int VecEnv::workerMain(void *_worker)
+{
+  Worker *w=static_cast<Worker *>(_worker);
+  for(;;)
+  {
+    SDL_SemWait(w->go);
+    if(!SDL_AtomicGet(&w->owner->m_running))
+    {
+      break;
+    }
+    w->owner->stepRange(w->first,w->last);
+    SDL_SemPost(w->owner->m_done);
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const EnvObservation *VecEnv::reset()
+{
+  for(unsigned int i=0; i<m_envs.size(); ++i)
+  {
+    resetEnv(i);
+    observe(i,0.0);
+  }
+  return &m_observations[0];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const EnvObservation *VecEnv::step(const EnvAction *_actions)
+{
+  Uint64 start=SDL_GetPerformanceCounter();
+  m_actions=_actions;
+  // the semaphores order the actions before the workers read them and the observations after
+  unsigned int posted=0;
+  for(unsigned int i=1; i<m_workers.size(); ++i)
+  {
+    if(m_workers[i].thread)
+    {
+      SDL_SemPost(m_workers[i].go);
+      ++posted;
+    }
+  }
+  stepRange(m_workers[0].first,m_workers[0].last);
+  for(unsigned int i=1; i<m_workers.size(); ++i)
+  {
+    if(!m_workers[i].thread)
+    {
+      stepRange(m_workers[i].first,m_workers[i].last);
+    }
+  }
+  for(unsigned int i=0; i<posted; ++i)
+  {
+    SDL_SemWait(m_done);
+  }
+  m_actions=0;
+  m_stepTicks+=SDL_GetPerformanceCounter()-start;
+  m_totalSteps+=m_envs.size();
+  return &m_observations[0];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void VecEnv::stepRange(unsigned int _first, unsigned int _last)
+{
+  for(unsigned int i=_first; i<_last; ++i)
+  {
+    Env &e=m_envs[i];
+    e.world->tilt(m_actions[i].tiltX,m_actions[i].tiltZ);
+    e.world->step(1.0f/60.0f,10);
+    ++e.episodeSteps;
+
+    float outcome=0.0;
+    if(e.world->contactTest(BALL,GOAL))
+    {
+      outcome=1.0;
+    }
+    else if(e.world->getPosition(BALL).m_y<3)
+    {
+      outcome=-1.0;
+    }
+    if(outcome!=0.0 || (m_maxEpisodeSteps>0 && e.episodeSteps>=m_maxEpisodeSteps))
+    {
+      resetEnv(i);
+    }
+    observe(i,outcome);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void VecEnv::resetEnv(unsigned int _index)
+{
+  m_envs[_index].world->restoreState(m_start);
+  m_envs[_index].episodeSteps=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void VecEnv::observe(unsigned int _index, float _outcome)
+{
+  PhysicsWorld *world=m_envs[_index].world;
+  EnvObservation &o=m_observations[_index];
+  ngl::Vec3 pos=world->getPosition(BALL);
+  ngl::Vec3 vel=world->getLinearVelocity(BALL);
+  btQuaternion tilt=world->getRotation(MAZE);
+  o.position[0]=pos.m_x;
+  o.position[1]=pos.m_y;
+  o.position[2]=pos.m_z;
+  o.velocity[0]=vel.m_x;
+  o.velocity[1]=vel.m_y;
+  o.velocity[2]=vel.m_z;
+  o.tilt[0]=tilt.x();
+  o.tilt[1]=tilt.y();
+  o.tilt[2]=tilt.z();
+  o.tilt[3]=tilt.w();
+  o.outcome=_outcome;
+  o.episodeSteps=m_envs[_index].episodeSteps;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+double VecEnv::getStepsPerSecond() const
+{
+  if(m_stepTicks==0)
+  {
+    return 0.0;
+  }
+  return m_totalSteps*double(SDL_GetPerformanceFrequency())/m_stepTicks;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -7,8 +7,14 @@
 #include <cstdlib>
 #include <iostream>
 #include "NGLDraw.h"
+#include "Simulation.h"
+#include "MetricsExport.h"
+#include "Benchmark.h"
+#include "HeadlessContext.h"
+#include "LevelPack.h"
 #include <ngl/NGLInit.h>
 #include <stack>
+#include <vector>
 #include <sstream>
 #include <string>
 #include <ngl/NGLInit.h>
@@ -25,7 +31,8 @@ void SDLErrorExit(const std::string &_msg);
 //----------------------------------------------------------------------------------------------------------------------
 
 /// @brief initialize SDL OpenGL context
-SDL_GLContext createOpenGLContext( SDL_Window *window);
+/// @param[in] _samples MSAA samples for the window, 0 when the scene is drawn offscreen and scaled in
+SDL_GLContext createOpenGLContext( SDL_Window *window, int _samples);
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -33,58 +40,464 @@ typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
 
 //----------------------------------------------------------------------------------------------------------------------
 
-int ParseScore(tokenizer::iterator &_firstWord)
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief thrown when a config line ends at its key
+//----------------------------------------------------------------------------------------------------------------------
+struct MissingValue {};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief reads the value of a config line, the word after its key
+/// @param[in,out] io_word the key, left past the value
+/// @param[in] _end the end of the line
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T> T ParseValue(tokenizer::iterator &io_word, const tokenizer::iterator &_end)
 {
-  ++_firstWord;
-  int outPut = boost::lexical_cast<int>(*_firstWord++);
-  std::cout<<outPut<<std::endl;
-  return outPut;
+  ++io_word;
+  if(io_word==_end)
+  {
+    throw MissingValue();
+  }
+  return boost::lexical_cast<T>(*io_word++);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-int ParseGravity(tokenizer::iterator &_firstWord)
+BroadphaseType ParseBroadphase(tokenizer::iterator &io_word, const tokenizer::iterator &_end)
 {
-  ++_firstWord;
-  int outPut = boost::lexical_cast<int>(*_firstWord++);
-  std::cout<<outPut<<std::endl;
+  std::string name = ParseValue<std::string>(io_word,_end);
+  BroadphaseType outPut;
+  if(!PhysicsWorld::broadphaseFromName(name,outPut))
+  {
+    std::cerr<<"unknown broadphase "<<name<<" using dbvt\n";
+    outPut=BROADPHASE_DBVT;
+  }
   return outPut;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-float ParseFriction(tokenizer::iterator &_firstWord)
+MaterialId ParseMazeSurface(tokenizer::iterator &io_word, const tokenizer::iterator &_end)
 {
-  ++_firstWord;
-  float outPut = boost::lexical_cast<float>(*_firstWord++);
-  std::cout<<outPut<<std::endl;
+  std::string name = ParseValue<std::string>(io_word,_end);
+  MaterialId outPut;
+  if(!MaterialTable::materialFromName(name,outPut))
+  {
+    std::cerr<<"unknown surface "<<name<<" using wood\n";
+    outPut=MATERIAL_WOOD;
+  }
   return outPut;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
+/// @brief everything the render loop needs, shared between the main and render threads
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+  SDL_Window *window;
+  // context the render thread should make current, 0 when it is already current
+  SDL_GLContext context;
+  Simulation *simulation;
+  Benchmark *benchmark;
+  // levels to play in turn, 0 to play the maze from the config file
+  LevelPack *levels;
+  bool benchmarking;
+  bool headless;
+  // glFinish after each swap and record input to photon latency
+  bool measureLatency;
+  int width;
+  int height;
+  int exportMetrics;
+  // GPU ms per frame dynamic resolution aims for, 0 for always full resolution
+  float frameBudget;
+  // written by the render thread, read back by main once it has finished
+  int highScore;
+  // events main passes on for the camera and viewport
+  std::vector <SDL_Event> events;
+  SDL_mutex *eventLock;
+  // posted when there are events or the game state changes so the render thread can sleep on static screens
+  SDL_sem *wake;
+  SDL_atomic_t quit;
+}RenderShared;
 
-int main(int argc, char *argv[])
+//----------------------------------------------------------------------------------------------------------------------
+
+void forwardEvent(RenderShared &_shared, const SDL_Event &_event)
+{
+  SDL_LockMutex(_shared.eventLock);
+  _shared.events.push_back(_event);
+  SDL_UnlockMutex(_shared.eventLock);
+  SDL_SemPost(_shared.wake);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void handleRenderEvent(NGLDraw &_ngld, const SDL_Event &_event, SDL_Window *_window)
+{
+  switch (_event.type)
+  {
+    // process the mouse data by passing it to ngl class
+    case SDL_MOUSEMOTION : _ngld.mouseMoveEvent(_event.motion); break;
+    case SDL_MOUSEBUTTONDOWN : _ngld.mousePressEvent(_event.button); break;
+    case SDL_MOUSEBUTTONUP : _ngld.mouseReleaseEvent(_event.button); break;
+    case SDL_MOUSEWHEEL : _ngld.wheelEvent(_event.wheel); break;
+    // if the window is re-sized pass it to the ngl class to change gl viewport
+    case SDL_WINDOWEVENT :
+      int w,h;
+      // get the new window size
+      SDL_GetWindowSize(_window,&w,&h);
+      _ngld.resize(w,h);
+    break;
+    case SDL_KEYDOWN :
+      switch( _event.key.keysym.sym )
+      {
+        case SDLK_w : glPolygonMode(GL_FRONT_AND_BACK,GL_LINE); _ngld.setDirty(); break;
+        case SDLK_s : glPolygonMode(GL_FRONT_AND_BACK,GL_FILL); _ngld.setDirty(); break;
+        case SDLK_h : _ngld.toggleHud(); break;
+        default : break;
+      }
+    break;
+    default : break;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief returns when SDL queued an event on the performance counter, so time it spent waiting in
+/// the queue counts towards its latency. SDL stamps events in SDL_GetTicks milliseconds
+/// @param[in] _event the event
+//----------------------------------------------------------------------------------------------------------------------
+Uint64 eventTime(const SDL_Event &_event)
+{
+  Uint64 now=SDL_GetPerformanceCounter();
+  Uint32 ticks=SDL_GetTicks();
+  if(_event.common.timestamp==0 || _event.common.timestamp>ticks)
+  {
+    return now;
+  }
+  Uint64 age=Uint64(ticks-_event.common.timestamp)*SDL_GetPerformanceFrequency()/1000;
+  return age<now ? now-age : now;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief move on to a level of the pack, the level after it is prepared in the background while
+/// this one is played so the next move doesn't wait on the disk
+/// @param[in] _level the level's place in the pack
+/// @returns false if the level couldn't be loaded, the one being played carries on
+//----------------------------------------------------------------------------------------------------------------------
+bool playLevel(NGLDraw &_ngld, Simulation &_simulation, LevelPack &_levels, unsigned int _level)
 {
+  Level *level=_levels.take(_level);
+  if(!level)
+  {
+    std::cerr<<"Unable to load level "<<_levels.getInfo(_level).name<<"\n";
+    return false;
+  }
+  _ngld.setLevel(*level);
+  // the simulation owns it from here
+  _simulation.setLevel(level,_level);
+  _levels.prefetch((_level+1)%_levels.size());
+  std::cout<<"Level "<<_level+1<<" "<<_levels.getInfo(_level).name<<"\n";
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the render loop, owns the GL context and NGLDraw. Runs on its own thread in a game and
+/// on the main thread for benchmarks where it also ticks the simulation once a frame
+/// @param[in] _shared the RenderShared for the run
+//----------------------------------------------------------------------------------------------------------------------
+int renderLoop(void *_shared)
+{
+  RenderShared *shared=static_cast<RenderShared *>(_shared);
+  if(shared->context)
+  {
+    // the context was created on the main thread, take it over
+    SDL_GL_MakeCurrent(shared->window,shared->context);
+  }
+  Simulation *simulation=shared->simulation;
+  Benchmark *benchmark=shared->benchmark;
+  bool benchmarking=shared->benchmarking;
+
   //initialize variables
   float rotateUp =0.0;
   float rotateDown =0.0;
   float rotateLeft =0.0;
   float rotateRight=0.0;
   int score=0;
-  int highScore=1000;
   int lastTime=0;
   int currentTime=0;
   int diffTime=0;
   int accumulator=0;
   int second=0;
   int pauseTime=0;
+  unsigned long wins=0;
+  Uint64 lastInputTime=0;
+
+  // a generated maze is drawn from the same arrays it collides with
+  NGLDraw ngld(simulation->getMaze().isValid() ? &simulation->getMaze() : 0);
+  if(shared->headless)
+  {
+    // there is no default framebuffer so everything goes to the offscreen target
+    if(!ngld.createOffscreen(shared->width,shared->height))
+    {
+      SDLErrorExit("Problem creating offscreen framebuffer");
+    }
+  }
+  ngld.resize(shared->width,shared->height);
+  ngld.setFrameBudget(shared->frameBudget);
+  LevelPack *levels=shared->levels;
+  unsigned int level=0;
+  if(levels)
+  {
+    playLevel(ngld,*simulation,*levels,level);
+  }
+  unsigned int frame=0;
+  // publish counters for labyrinthstat if asked for in the config file
+  MetricsExport metrics;
+  if(shared->exportMetrics)
+  {
+    metrics.open();
+  }
+  std::vector <SDL_Event> events;
+  bool quit=false;
+  Uint64 frameStart=SDL_GetPerformanceCounter();
+  while(!quit)
+  {
+    float physicsMs=0.0;
+    if(benchmarking)
+    {
+      // the script drives a benchmark so only let the window be closed
+      SDL_Event event;
+      while ( SDL_PollEvent(&event) )
+      {
+        if(event.type==SDL_QUIT)
+        {
+          quit=true;
+        }
+      }
+      unsigned int balls=benchmark->apply(frame,rotateUp,rotateDown,rotateLeft,rotateRight);
+      simulation->setTilt(rotateUp,rotateDown,rotateLeft,rotateRight);
+      for(unsigned int i=0; i<balls; ++i)
+      {
+        simulation->addBall();
+      }
+      // tick in lockstep with the frames so runs are repeatable
+      Uint64 tickStart=SDL_GetPerformanceCounter();
+      simulation->tick();
+      physicsMs=(SDL_GetPerformanceCounter()-tickStart)*1000.0/SDL_GetPerformanceFrequency();
+    }
+    else
+    {
+      // the menu and result screens are static, so rather than redrawing them every vsync
+      // sleep until main passes on some input or the simulation changes state
+      if(ngld.getGameState()!=1 && !ngld.needsRedraw())
+      {
+        SDL_SemWaitTimeout(shared->wake,500);
+        frameStart=SDL_GetPerformanceCounter();
+        pauseTime = SDL_GetTicks();
+      }
+      quit=SDL_AtomicGet(&shared->quit);
+      // take everything queued so a burst of mouse motion only costs one redraw
+      SDL_LockMutex(shared->eventLock);
+      events.swap(shared->events);
+      SDL_UnlockMutex(shared->eventLock);
+      for(unsigned int i=0; i<events.size(); ++i)
+      {
+        handleRenderEvent(ngld,events[i],shared->window);
+      }
+      events.clear();
+    }
+
+    const Snapshot &snapshot=simulation->acquire();
+    if(snapshot.state!=ngld.getGameState())
+    {
+      ngld.setGameState(snapshot.state);
+    }
+    if(snapshot.wins!=wins)
+    {
+      wins=snapshot.wins;
+      if(score < shared->highScore)
+      {
+        shared->highScore = score;
+      }
+      if(levels)
+      {
+        level=(level+1)%levels->size();
+        playLevel(ngld,*simulation,*levels,level);
+      }
+    }
+
+    if(ngld.getGameState()!=1 && !ngld.needsRedraw())
+    {
+      metrics.publish(ngld.getPerfStats(),ngld.getGameState());
+      continue;
+    }
+
+    Uint64 drawStart=SDL_GetPerformanceCounter();
+    ngld.draw(snapshot);
+    Uint64 drawEnd=SDL_GetPerformanceCounter();
+    if(!benchmarking)
+    {
+      // lets the step governor put balls out of view to sleep
+      simulation->setView(ngld.getViewProjection());
+    }
+    simulation->setCountBodies(ngld.getShowHud() || shared->exportMetrics);
+
+    //timer, left out of benchmarks as it would make their frames differ from run to run
+    if(ngld.getGameState()==1 && !benchmarking)
+    {
+      currentTime = SDL_GetTicks();
+      diffTime = currentTime - lastTime;
+
+      accumulator += diffTime;
+      if(accumulator > 1)
+      {
+        accumulator -= 1;
+        second = currentTime;
+      }
+
+      lastTime = currentTime;
+
+      score = (second - pauseTime - score)/1000;
+
+      std::stringstream ss1;
+      ss1<<score;
+      std::string s1= "Time = " + ss1.str();
+      ngld.text(s1);
+      lastTime = currentTime;
+
+    }
+
+    if(ngld.getGameState()==0 || ngld.getGameState()==2 || ngld.getGameState()==3)
+    {
+      pauseTime = SDL_GetTicks();
+
+    }
+    // ticks spent this frame on benchmark readbacks, kept out of the frame time
+    Uint64 untimed=0;
+    if(benchmarking)
+    {
+      // captured before the swap, after it the contents of a window's back buffer are undefined
+      Uint64 captureStart=SDL_GetPerformanceCounter();
+      std::string capture;
+      if(benchmark->captureFile(frame,capture))
+      {
+        ngld.writeFrame(capture);
+      }
+      if(benchmark->wantsHash(frame))
+      {
+        benchmark->recordHash(frame,ngld.frameHash());
+      }
+      untimed=SDL_GetPerformanceCounter()-captureStart;
+    }
+    // swap the buffers, headless we wait for the frame to finish so it is in the timing
+    if(shared->headless)
+    {
+      glFinish();
+    }
+    else
+    {
+      SDL_GL_SwapWindow(shared->window);
+    }
+    //frame time is measured swap to swap so includes waiting for vsync
+    Uint64 frameEnd=SDL_GetPerformanceCounter();
+    ngld.getPerfStats().frameTime.addSample((frameEnd-frameStart-untimed)*1000.0/SDL_GetPerformanceFrequency());
+    frameStart=frameEnd;
+    if(shared->measureLatency && snapshot.inputTime>lastInputTime)
+    {
+      // wait for the swap to actually complete so we time to the photons not to the driver queue
+      glFinish();
+      Uint64 shown=SDL_GetPerformanceCounter();
+      ngld.getPerfStats().inputLatency.addSample((shown-snapshot.inputTime)*1000.0/SDL_GetPerformanceFrequency());
+      lastInputTime=snapshot.inputTime;
+      // the wait is the measurement's, not the next frame's
+      frameStart=shown;
+    }
+    ++ngld.getPerfStats().frames;
+    metrics.publish(ngld.getPerfStats(),ngld.getGameState());
+
+    if(benchmarking)
+    {
+      PerfStats &stats=ngld.getPerfStats();
+      float drawMs=(drawEnd-drawStart)*1000.0/SDL_GetPerformanceFrequency();
+      benchmark->record(stats.frameTime.getLast(),physicsMs,drawMs);
+      // winning or losing resets the maze, carry straight on playing
+      if(snapshot.state!=1)
+      {
+        simulation->setGameState(1);
+      }
+      if(++frame>=benchmark->getFrames())
+      {
+        quit=true;
+      }
+    }
+  }
+  if(shared->measureLatency)
+  {
+    const PerfHistogram &latency=ngld.getPerfStats().inputLatency;
+    std::cout<<"Input to photon latency over the last "<<latency.getCount()<<" inputs : p50 "<<latency.percentile(50)
+             <<" ms  p95 "<<latency.percentile(95)<<" ms  p99 "<<latency.percentile(99)<<" ms\n";
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  //initialize variables
+  float rotateUp =0.0;
+  float rotateDown =0.0;
+  float rotateLeft =0.0;
+  float rotateRight=0.0;
+  int highScore=1000;
   int gravityY=0;
   float friction =0.0;
+  int exportMetrics=0;
+  float frameBudget=0.0;
+  float stepBudget=0.0;
+  int ballCollisions=1;
+  BroadphaseType broadphase=BROADPHASE_DBVT;
+  MaterialId mazeSurface=MATERIAL_WOOD;
+  int autopilot=0;
+  int mazeSdf=0;
+  int partyBalls=0;
+  int mazeSeed=0;
+  int mazeCells=0;
+  std::string levelPack="none";
 
   //read in config file
   if (argc <=1)
   {
-    std::cout <<"Usage FileRead [filename] \n";
+    std::cout <<"Usage FileRead [filename] [--benchmark script] [--headless] [--latency]\n";
+    exit(EXIT_FAILURE);
+  }
+  // optional scripted benchmark run, this skips the menu and doesn't write back the config
+  // benchmarks can also run headless (no window, render offscreen through EGL)
+  bool benchmarking=false;
+  bool headless=false;
+  bool measureLatency=false;
+  Benchmark benchmark;
+  for(int arg=2; arg<argc; ++arg)
+  {
+    if(std::string(argv[arg])=="--benchmark" && arg+1<argc)
+    {
+      if(!benchmark.load(argv[++arg]))
+      {
+        exit(EXIT_FAILURE);
+      }
+      benchmarking=true;
+    }
+    else if(std::string(argv[arg])=="--headless")
+    {
+      headless=true;
+    }
+    else if(std::string(argv[arg])=="--latency")
+    {
+      measureLatency=true;
+    }
+  }
+  if(headless && !benchmarking)
+  {
+    std::cerr<<"--headless needs a --benchmark script to drive the game\n";
     exit(EXIT_FAILURE);
   }
   std::fstream fileIn;
@@ -108,176 +521,345 @@ int main(int argc, char *argv[])
       tokenizer tokens(lineBuffer, sep);
       tokenizer::iterator firstWord = tokens.begin();
 
-      if(*firstWord == "HighScore")
+      if(firstWord==tokens.end())
       {
-        highScore = ParseScore(firstWord);
+        continue;
       }
-      else if(*firstWord == "Gravity")
+      try
       {
-        gravityY = ParseGravity(firstWord);
+        if(*firstWord == "HighScore")
+        {
+          highScore = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "Gravity")
+        {
+          gravityY = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "Friction")
+        {
+          friction = ParseValue<float>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "Metrics")
+        {
+          exportMetrics = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "FrameBudget")
+        {
+          frameBudget = ParseValue<float>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "StepBudget")
+        {
+          stepBudget = ParseValue<float>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "BallCollisions")
+        {
+          ballCollisions = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "Broadphase")
+        {
+          broadphase = ParseBroadphase(firstWord,tokens.end());
+        }
+        else if(*firstWord == "MazeSurface")
+        {
+          mazeSurface = ParseMazeSurface(firstWord,tokens.end());
+        }
+        else if(*firstWord == "Autopilot")
+        {
+          autopilot = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "MazeSdf")
+        {
+          mazeSdf = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "PartyBalls")
+        {
+          partyBalls = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "MazeSeed")
+        {
+          mazeSeed = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "MazeCells")
+        {
+          mazeCells = ParseValue<int>(firstWord,tokens.end());
+        }
+        else if(*firstWord == "LevelPack")
+        {
+          levelPack = ParseValue<std::string>(firstWord,tokens.end());
+        }
+        else
+        {
+          std::cerr<<"unknown token"<<*firstWord<<std::endl;
+        }
       }
-      else if(*firstWord == "Friction")
+      catch(MissingValue &)
       {
-        friction = ParseFriction(firstWord);
+        std::cerr<<"missing value in config line : "<<lineBuffer<<"\n";
+        exit(EXIT_FAILURE);
       }
-      else
+      catch(boost::bad_lexical_cast &)
       {
-        std::cerr<<"unknown token"<<*firstWord<<std::endl;
+        std::cerr<<"bad value in config line : "<<lineBuffer<<"\n";
+        exit(EXIT_FAILURE);
       }
      }
   }
   fileIn.close();
+  // benchmarks compare frames and timings between runs so they always draw at full resolution
+  float renderBudget= benchmarking ? 0.0 : frameBudget;
 
-  // Initialize SDL's Video subsystem
-  if (SDL_Init(SDL_INIT_VIDEO) < 0 )
+  SDL_Window *window=0;
+  SDL_GLContext glContext=0;
+  SDL_Rect rect;
+  HeadlessContext headlessContext;
+  // Initialize SDL's Video subsystem, benchmarks on machines with no display fall back to headless
+  if (!headless && SDL_Init(SDL_INIT_VIDEO) < 0 )
   {
-    // Or die on error
-    SDLErrorExit("Unable to initialize SDL");
+    if(!benchmarking)
+    {
+      // Or die on error
+      SDLErrorExit("Unable to initialize SDL");
+    }
+    std::cerr<<"No video ("<<SDL_GetError()<<") running the benchmark headless\n";
+    headless=true;
   }
 
-  // now get the size of the display and create a window we need to init the video
-  SDL_Rect rect;
-  SDL_GetDisplayBounds(0,&rect);
-  // now create our window
-  SDL_Window *window=SDL_CreateWindow("Labyrinth",
-                                      SDL_WINDOWPOS_CENTERED,
-                                      SDL_WINDOWPOS_CENTERED,
-                                      rect.w/2,
-                                      rect.h/2,
-                                      SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
-                                     );
-  // check to see if that worked or exit
-  if (!window)
+  if(headless)
   {
-    SDLErrorExit("Unable to create window");
+    SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+    if(!headlessContext.create())
+    {
+      SDLErrorExit("Problem creating headless OpenGL context");
+    }
+    rect.x=0;
+    rect.y=0;
+    rect.w=benchmark.getWidth();
+    rect.h=benchmark.getHeight();
+    benchmark.setRenderer(headlessContext.getRenderer());
+  }
+  else
+  {
+    // now get the size of the display and create a window we need to init the video
+    SDL_GetDisplayBounds(0,&rect);
+    // now create our window
+    window=SDL_CreateWindow("Labyrinth",
+                            SDL_WINDOWPOS_CENTERED,
+                            SDL_WINDOWPOS_CENTERED,
+                            rect.w/2,
+                            rect.h/2,
+                            SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
+                           );
+    // check to see if that worked or exit
+    if (!window)
+    {
+      SDLErrorExit("Unable to create window");
+    }
+    // Create our opengl context and attach it to our window
+    glContext=createOpenGLContext(window, renderBudget>0.0 ? 0 : 4);
+    if(!glContext)
+    {
+      SDLErrorExit("Problem creating OpenGL context");
+    }
+    // make this our current GL context (we can have more than one window but in this case not)
+    SDL_GL_MakeCurrent(window, glContext);
+    /* This makes our buffer swap syncronized with the monitor's vertical refresh */
+    /* benchmarks run unsynchronised so we measure the engine not the display */
+    SDL_GL_SetSwapInterval(benchmarking ? 0 : 1);
   }
-  // Create our opengl context and attach it to our window
-   SDL_GLContext glContext=createOpenGLContext(window);
-   if(!glContext)
-   {
-     SDLErrorExit("Problem creating OpenGL context");
-   }
-   // make this our current GL context (we can have more than one window but in this case not)
-   SDL_GL_MakeCurrent(window, glContext);
-  /* This makes our buffer swap syncronized with the monitor's vertical refresh */
-  SDL_GL_SetSwapInterval(1);
   // we need to initialise the NGL lib which will load all of the OpenGL functions, this must
   // be done once we have a valid GL context but before we call any GL commands. If we dont do
   // this everything will crash
   ngl::NGLInit::instance();
-  // now clear the screen and swap whilst NGL inits (which may take time)
-  glClear(GL_COLOR_BUFFER_BIT);
-  SDL_GL_SwapWindow(window);
+  if(!headless)
+  {
+    // now clear the screen and swap whilst NGL inits (which may take time)
+    glClear(GL_COLOR_BUFFER_BIT);
+    SDL_GL_SwapWindow(window);
+  }
+
+  // the physics and game rules, created before NGLDraw as it loads the collision shapes
+  Simulation simulation(gravityY, friction, broadphase, mazeSdf!=0, mazeSeed, mazeCells>0 ? mazeCells : 0);
+  simulation.setBallsCollide(ballCollisions!=0);
+  simulation.setMazeSurface(mazeSurface);
+  // unattended soak runs, the game plays itself and starts again after each win or loss
+  if(autopilot)
+  {
+    simulation.setAutopilot(true);
+  }
+  if(benchmarking)
+  {
+    simulation.setGameState(1);
+  }
+  else
+  {
+    // benchmarks must do the same work every run so only games shed physics work
+    simulation.setStepBudget(stepBudget);
+  }
+
+  // a level pack takes over from the maze above once the game starts, benchmarks keep to the
+  // config file's maze so their runs compare
+  LevelPack levels;
+  bool playPack=false;
+  if(levelPack!="none" && !benchmarking)
+  {
+    LevelInfo defaults;
+    defaults.seed=0;
+    defaults.cells=0;
+    defaults.gravity=gravityY;
+    defaults.friction=friction;
+    defaults.surface=mazeSurface;
+    defaults.ballCollisions=ballCollisions!=0;
+    defaults.broadphase=broadphase;
+    // generated walls are as thick as mazev3.obj's
+    defaults.wallThickness=MazeGenerator::getWallThickness();
+    playPack=levels.load(levelPack,defaults);
+    if(!playPack)
+    {
+      std::cerr<<"Unable to load level pack "<<levelPack<<" playing the config file's maze\n";
+    }
+  }
+
+  RenderShared shared;
+  shared.window=window;
+  shared.context=0;
+  shared.simulation=&simulation;
+  shared.benchmark=&benchmark;
+  shared.levels= playPack ? &levels : 0;
+  shared.benchmarking=benchmarking;
+  shared.headless=headless;
+  shared.measureLatency=measureLatency && !benchmarking;
+  shared.width=rect.w;
+  shared.height=rect.h;
+  shared.exportMetrics=exportMetrics;
+  shared.frameBudget=renderBudget;
+  shared.highScore=highScore;
+  shared.eventLock=SDL_CreateMutex();
+  shared.wake=SDL_CreateSemaphore(0);
+  SDL_AtomicSet(&shared.quit,0);
+
+  if(benchmarking)
+  {
+    // benchmarks tick the simulation from the render loop so everything stays on this thread
+    renderLoop(&shared);
+    bool pass=benchmark.writeReport() && benchmark.compareBaseline();
+    SDL_Quit();
+    return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // the simulation runs at a fixed rate on its own thread and the render thread takes over the
+  // GL context, so a slow swap doesn't hold up physics and a physics spike doesn't drop a frame.
+  // This thread is left doing nothing but input, it wakes as soon as an event arrives and stamps
+  // it with when SDL queued it so the simulation can apply it at the right point within a tick
+  simulation.setWake(shared.wake);
+  if(!simulation.start())
+  {
+    SDLErrorExit("Unable to start the simulation");
+  }
+  SDL_GL_MakeCurrent(window,0);
+  shared.context=glContext;
+  SDL_Thread *renderThread=SDL_CreateThread(renderLoop,"render",&shared);
+  if(!renderThread)
+  {
+    SDLErrorExit("Unable to create render thread");
+  }
 
   bool quit=false;
 
   SDL_Event event;
 
-  NGLDraw ngld;
-  ngld.setPhysics(gravityY, friction);
-  ngld.resize(rect.w,rect.h);
-  ngld.setGameState(0);
-  while(!quit)
+  while(!quit && SDL_WaitEvent(&event))
   {
-    while ( SDL_PollEvent(&event) )
+    Uint64 sampled=eventTime(event);
+    switch (event.type)
     {
-      switch (event.type)
+      // this is the window x being clicked.
+      case SDL_QUIT : quit = true; break;
+      // the camera and viewport belong to the render thread
+      case SDL_MOUSEMOTION :
+      case SDL_MOUSEBUTTONDOWN :
+      case SDL_MOUSEBUTTONUP :
+      case SDL_MOUSEWHEEL :
+      case SDL_WINDOWEVENT : forwardEvent(shared,event); break;
+
+      // now we look for a keydown event
+      case SDL_KEYDOWN:
       {
-        // this is the window x being clicked.
-        case SDL_QUIT : quit = true; break;
-        // process the mouse data by passing it to ngl class
-        case SDL_MOUSEMOTION : ngld.mouseMoveEvent(event.motion); break;
-        case SDL_MOUSEBUTTONDOWN : ngld.mousePressEvent(event.button); break;
-        case SDL_MOUSEBUTTONUP : ngld.mouseReleaseEvent(event.button); break;
-        case SDL_MOUSEWHEEL : ngld.wheelEvent(event.wheel);
-        // if the window is re-sized pass it to the ngl class to change gl viewport
-        // note this is slow as the context is re-create by SDL each time
-        case SDL_WINDOWEVENT :
-          int w,h;
-          // get the new window size
-          SDL_GetWindowSize(window,&w,&h);
-          ngld.resize(w,h);
-        break;
+        // only real presses change the tilt, key repeats would just restamp it
+        bool tilt=!event.key.repeat;
+        switch( event.key.keysym.sym )
+        {
+          //set keys for game states
+          case SDLK_ESCAPE :  quit = true; tilt=false; break;
+          // polygon mode and the HUD are render state
+          case SDLK_w :
+          case SDLK_s :
+          case SDLK_h : forwardEvent(shared,event); tilt=false; break;
+          case SDLK_b :
+          if(simulation.getGameState()==1)
+          {
+            simulation.addBall(sampled);
+          }
+          tilt=false;
+          break;
+          case SDLK_UP :
+          if(simulation.getGameState()==1)
+          {
+            rotateUp= 0.003;
+          }
+          break;
+          case SDLK_RIGHT :
+          if(simulation.getGameState()==1)
+          {
+            rotateRight=0.003;
+          }
+          break;
+          case SDLK_DOWN :
+          if(simulation.getGameState()==1)
+          {
+            rotateDown= 0.003;
+          }
+          break;
+          case SDLK_LEFT :
+          if(simulation.getGameState()==1)
+          {
+            rotateLeft=0.003;
+          }
+          break;
 
-        // now we look for a keydown event
-        case SDL_KEYDOWN:
-        {       
-          switch( event.key.keysym.sym )
+          // start from the menu or play again after winning or losing
+          case SDLK_a :
+          if(simulation.getGameState()!=1)
           {
-            //set keys for game states
-            case SDLK_ESCAPE :  quit = true; break;
-            case SDLK_w : glPolygonMode(GL_FRONT_AND_BACK,GL_LINE); break;
-            case SDLK_s : glPolygonMode(GL_FRONT_AND_BACK,GL_FILL); break;
-            case SDLK_b :
-            if(ngld.getGameState()==1)
-            {
-              ngld.createball(friction);
-            }
-            break;
-            case SDLK_UP :
-            if(ngld.getGameState()==1)
-            {
-              rotateUp= 0.003;
-            }
-            break;
-            case SDLK_RIGHT :
-            if(ngld.getGameState()==1)
-            {
-              rotateRight=0.003;
-            }
-            break;
-            case SDLK_DOWN :
-            if(ngld.getGameState()==1)
-            {
-              rotateDown= 0.003;
-            }
-            break;
-            case SDLK_LEFT :
-            if(ngld.getGameState()==1)
-            {
-              rotateLeft=0.003;
-            }
-            break;
-
-            case SDLK_a :
-            {
-              if(ngld.getGameState()==0)
-              {
-                ngld.setGameState(1);
-                break;
-              }
-              else if(ngld.getGameState()==1)
-              {
-                break;
-              }
-              else if(ngld.getGameState()==2)
-              {
-                ngld.setGameState(1);
-                break;
-              }
-              else if(ngld.getGameState()==3)
-              {
-                ngld.setGameState(1);
-                break;
-              }
-              break;
-            }
-            break;
-
-            SDL_SetWindowFullscreen(window,SDL_FALSE);
-            glViewport(0,0,rect.w,rect.h);
-            break;
-
-            case SDLK_g : SDL_SetWindowFullscreen(window,SDL_FALSE); break;
-            default : break;
+            simulation.setGameState(1,sampled);
+          }
+          tilt=false;
+          break;
 
+          // party mode fills the maze with the number of balls from the config file
+          case SDLK_p :
+          if(partyBalls>0)
+          {
+            // asks the simulation as a new level turns the party off
+            simulation.setParty(simulation.getParty() ? 0 : partyBalls);
           }
+          tilt=false;
           break;
-        } // end of keydown
+
+          case SDLK_g : SDL_SetWindowFullscreen(window,SDL_FALSE); tilt=false; break;
+          default : tilt=false; break;
+
+        }
+        if(tilt)
+        {
+          simulation.setTilt(rotateUp,rotateDown,rotateLeft,rotateRight,sampled);
+        }
+        break;
+      } // end of keydown
 
       //keyup event
       case SDL_KEYUP:
       {
+        bool tilt=true;
         switch( event.key.keysym.sym )
         {
 
@@ -285,70 +867,26 @@ int main(int argc, char *argv[])
           case SDLK_RIGHT : rotateRight=0.0; break;
           case SDLK_DOWN : rotateDown=0.0; break;
           case SDLK_LEFT : rotateLeft=0.0; break;
-          break;
-          default : break;
+          default : tilt=false; break;
         }
-        break;
-      } // end of keyup
-
-        default : break;
-      } // end of event switch
-    } // end of poll events
-
-    //movement for maze rotation
-    ngld.rotateMazeXUP(rotateUp);
-    ngld.rotateMazeXDOWN(rotateDown);
-    ngld.rotateMazeZLEFT(rotateLeft);
-    ngld.rotateMazeZRIGHT(rotateRight);
-
-    ngld.draw();
-
-    //timer
-    if(ngld.getGameState()==1)
-    {
-      if(ngld.lose(friction) ==1)
-      {
-        score = score ;
-      }
-      if(ngld.win(friction) ==1)
-      {
-        score = score ;
-        if(score < highScore)
+        if(tilt)
         {
-          highScore = score;
+          simulation.setTilt(rotateUp,rotateDown,rotateLeft,rotateRight,sampled);
         }
-      }
-      currentTime = SDL_GetTicks();
-      diffTime = currentTime - lastTime;
-
-      accumulator += diffTime;
-      if(accumulator > 1)
-      {
-        accumulator -= 1;
-        second = currentTime;
-      }
-
-      lastTime = currentTime;
-
-      score = (second - pauseTime - score)/1000;
-
-      std::stringstream ss1;
-      ss1<<score;
-      std::string s1= "Time = " + ss1.str();
-      ngld.text(s1);
-      lastTime = currentTime;
-
-    }
-
-    if(ngld.getGameState()==0 || ngld.getGameState()==2 || ngld.getGameState()==3)
-    {
-      pauseTime = SDL_GetTicks();
+        break;
+      } // end of keyup
 
-    }
-    // swap the buffers
-    SDL_GL_SwapWindow(window);
+      default : break;
+    } // end of event switch
+  } // end of wait events
 
-  }
+  SDL_AtomicSet(&shared.quit,1);
+  SDL_SemPost(shared.wake);
+  SDL_WaitThread(renderThread,0);
+  simulation.stop();
+  highScore=shared.highScore;
+  SDL_DestroySemaphore(shared.wake);
+  SDL_DestroyMutex(shared.eventLock);
 
   //write back into config file highscore etc
   if (argc <=1)
@@ -368,6 +906,18 @@ int main(int argc, char *argv[])
   fileOut<<"HighScore "<<highScore<<std::endl;
   fileOut<<"Gravity "<<gravityY<<std::endl;
   fileOut<<"Friction "<<friction<<std::endl;
+  fileOut<<"Metrics "<<exportMetrics<<std::endl;
+  fileOut<<"FrameBudget "<<frameBudget<<std::endl;
+  fileOut<<"StepBudget "<<stepBudget<<std::endl;
+  fileOut<<"BallCollisions "<<ballCollisions<<std::endl;
+  fileOut<<"Broadphase "<<PhysicsWorld::broadphaseName(broadphase)<<std::endl;
+  fileOut<<"MazeSurface "<<MaterialTable::materialName(mazeSurface)<<std::endl;
+  fileOut<<"Autopilot "<<autopilot<<std::endl;
+  fileOut<<"MazeSdf "<<mazeSdf<<std::endl;
+  fileOut<<"PartyBalls "<<partyBalls<<std::endl;
+  fileOut<<"MazeSeed "<<mazeSeed<<std::endl;
+  fileOut<<"MazeCells "<<mazeCells<<std::endl;
+  fileOut<<"LevelPack "<<levelPack<<std::endl;
 
   fileOut.close();
 
@@ -376,7 +926,7 @@ int main(int argc, char *argv[])
 
 //----------------------------------------------------------------------------------------------------------------------
 
-SDL_GLContext createOpenGLContext(SDL_Window *window)
+SDL_GLContext createOpenGLContext(SDL_Window *window, int _samples)
 {
   // Request an opengl 3.2 context first we setup our attributes, if you need any
   // more just add them here before the call to create the context
@@ -390,9 +940,10 @@ SDL_GLContext createOpenGLContext(SDL_Window *window)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
   #endif
-  // set multi sampling else we get really bad graphics that alias
-  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES,4);
+  // set multi sampling else we get really bad graphics that alias, with dynamic resolution the
+  // scene has its own multisampled target and we can't blit into a multisampled window
+  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, _samples>0 ? 1 : 0);
+  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES,_samples);
   // Turn on double buffering with a 24bit Z buffer.
   // You may need to change this to 16 or 32 for your system
   // on mac up to 32 will work but under linux centos build only 16
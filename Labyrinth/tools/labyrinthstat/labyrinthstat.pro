@@ -0,0 +1,11 @@
+TARGET=labyrinthstat
+OBJECTS_DIR=obj
+CONFIG-=app_bundle
+CONFIG-=qt
+CONFIG+=console
+SOURCES+= main.cpp
+# share the segment layout with the game
+INCLUDEPATH+=../../include
+HEADERS+=../../include/MetricsLayout.h
+DESTDIR=./
+linux-*:LIBS+=-lrt
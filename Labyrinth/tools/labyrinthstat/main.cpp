@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file main.cpp
+/// @brief labyrinthstat, prints the counters the game publishes in shared memory (see MetricsLayout.h)
+//----------------------------------------------------------------------------------------------------------------------
+
+#include "MetricsLayout.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief copies to try before giving up on the sequence lock, tens of ms. A write takes a few
+/// hundred ns so even a game descheduled mid write is back well before this, only one that died
+/// mid write keeps the sequence odd for longer
+//----------------------------------------------------------------------------------------------------------------------
+const static unsigned int READ_TRIES=1000000;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief take a consistent copy of the segment using the sequence lock
+/// @param[in] _segment the mapped segment
+/// @param[out] o_copy the copy
+/// @returns false if the sequence never settled, the segment is stale
+//----------------------------------------------------------------------------------------------------------------------
+bool readSegment(const MetricsSegment *_segment, MetricsSegment &o_copy)
+{
+  for(unsigned int i=0; i<READ_TRIES; ++i)
+  {
+    uint32_t before=_segment->sequence;
+    __sync_synchronize();
+    memcpy(&o_copy,(const void *)_segment,sizeof(MetricsSegment));
+    __sync_synchronize();
+    uint32_t after=_segment->sequence;
+    if(before==after && (before&1)==0)
+    {
+      return true;
+    }
+    // the game is mid write, it only takes a few hundred ns so spin
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief percentile from the cumulative step histogram (upper bucket edge in ms)
+/// @param[in] _m the metrics
+/// @param[in] _p percentile 0-100
+//----------------------------------------------------------------------------------------------------------------------
+float stepPercentile(const MetricsSegment &_m, float _p)
+{
+  uint64_t total=0;
+  for(unsigned int i=0; i<METRICS_STEP_BUCKETS; ++i)
+  {
+    total+=_m.stepHistogram[i];
+  }
+  if(total==0)
+  {
+    return 0.0;
+  }
+  uint64_t rank=(uint64_t)(_p/100.0*total+0.999);
+  uint64_t sum=0;
+  for(unsigned int i=0; i<METRICS_STEP_BUCKETS; ++i)
+  {
+    sum+=_m.stepHistogram[i];
+    if(sum>=rank)
+    {
+      return (i+1)*METRICS_STEP_BUCKET_US/1000.0;
+    }
+  }
+  return METRICS_STEP_BUCKETS*METRICS_STEP_BUCKET_US/1000.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void printSegment(const MetricsSegment &_m)
+{
+  static const char *assetNames[METRICS_ASSET_CATEGORIES]={"meshes","textures","fonts","collision"};
+  std::cout<<"pid           "<<_m.pid<<"\n";
+  std::cout<<"state         "<<_m.state<<"\n";
+  std::cout<<"frames        "<<_m.frames<<"\n";
+  std::cout<<"physics steps "<<_m.physicsSteps<<"\n";
+  std::cout<<"substeps      "<<_m.substeps<<"\n";
+  std::cout<<"bodies        "<<_m.bodies<<"\n";
+  std::cout<<"contacts      "<<_m.contacts<<"\n";
+  std::cout<<"step ms       p50 "<<stepPercentile(_m,50)<<" p95 "<<stepPercentile(_m,95)
+           <<" p99 "<<stepPercentile(_m,99)<<"\n";
+  for(unsigned int i=0; i<METRICS_ASSET_CATEGORIES; ++i)
+  {
+    std::cout<<"memory        "<<assetNames[i]<<" "<<_m.assetBytes[i]/1024<<" KiB\n";
+  }
+  std::cout<<"wins          "<<_m.wins<<"\n";
+  std::cout<<"losses        "<<_m.losses<<"\n";
+  std::cout<<"governor      "<<_m.governorLevel<<"\n";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  // optional refresh interval in seconds, 0 prints once
+  int interval=0;
+  if(argc>1)
+  {
+    interval=atoi(argv[1]);
+  }
+
+  int fd=shm_open(METRICS_SEGMENT_NAME,O_RDONLY,0);
+  if(fd<0)
+  {
+    std::cerr<<"No metrics segment "<<METRICS_SEGMENT_NAME<<", is the game running with Metrics 1 ?\n";
+    exit(EXIT_FAILURE);
+  }
+  // an older game's segment is smaller than ours, reading past its end would fault
+  struct stat info;
+  if(fstat(fd,&info)!=0 || info.st_size<(off_t)sizeof(MetricsSegment))
+  {
+    std::cerr<<"Metrics segment is too small, the game is older than version "<<METRICS_VERSION<<"\n";
+    close(fd);
+    exit(EXIT_FAILURE);
+  }
+  void *mem=mmap(0,sizeof(MetricsSegment),PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(mem==MAP_FAILED)
+  {
+    std::cerr<<"Could not map "<<METRICS_SEGMENT_NAME<<"\n";
+    exit(EXIT_FAILURE);
+  }
+  const MetricsSegment *segment=static_cast<const MetricsSegment *>(mem);
+  if(segment->magic!=METRICS_MAGIC)
+  {
+    std::cerr<<METRICS_SEGMENT_NAME<<" is not a metrics segment\n";
+    exit(EXIT_FAILURE);
+  }
+  // fields are only ever added at the end, so a newer game's segment starts with everything we know
+  if(segment->version<METRICS_VERSION || segment->size<sizeof(MetricsSegment))
+  {
+    std::cerr<<"Metrics segment has version "<<segment->version<<" expected "<<METRICS_VERSION<<" or later\n";
+    exit(EXIT_FAILURE);
+  }
+
+  MetricsSegment copy;
+  do
+  {
+    if(readSegment(segment,copy))
+    {
+      printSegment(copy);
+    }
+    else
+    {
+      std::cerr<<"Metrics segment is stale, the game stopped in the middle of writing it\n";
+      if(interval==0)
+      {
+        munmap(mem,sizeof(MetricsSegment));
+        return EXIT_FAILURE;
+      }
+    }
+    if(interval>0)
+    {
+      std::cout<<"\n";
+      sleep(interval);
+    }
+  } while(interval>0);
+
+  munmap(mem,sizeof(MetricsSegment));
+  return EXIT_SUCCESS;
+}